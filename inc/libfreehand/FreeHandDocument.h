@@ -28,13 +28,105 @@
 
 namespace libfreehand
 {
+struct FreeHandParseOptionsImpl;
+class FreeHandRecordGraph;
+
+class FreeHandParseOptions
+{
+public:
+  FHAPI FreeHandParseOptions();
+  FHAPI FreeHandParseOptions(const FreeHandParseOptions &other);
+  FHAPI ~FreeHandParseOptions();
+  FHAPI FreeHandParseOptions &operator=(const FreeHandParseOptions &other);
+
+  /* Limits memory used for the content of FreeHand 9-11 documents, which is
+   * compressed. With size 0 (the default), all of it is inflated at once.
+   */
+  FHAPI void setInflateWindowSize(unsigned long size);
+  FHAPI unsigned long getInflateWindowSize() const;
+
+  /* Keeps inflated content of FreeHand 9-11 documents in directory dir, so
+   * it does not need to be inflated again when the same document is parsed
+   * next time. The directory must exist. The least recently used data are
+   * removed when the cache grows beyond the cache size (256 MiB by default).
+   * No cache is used if dir is null or empty (the default).
+   */
+  FHAPI void setInflateCacheDir(const char *dir);
+  FHAPI const char *getInflateCacheDir() const;
+  FHAPI void setInflateCacheSize(unsigned long size);
+  FHAPI unsigned long getInflateCacheSize() const;
+
+  /* Inflates content of FreeHand 9-11 documents in a separate thread, so
+   * the records can be parsed while the rest is still being inflated.
+   * This has no effect if libfreehand was built without thread support.
+   */
+  FHAPI void setInflateInBackground(bool background);
+  FHAPI bool getInflateInBackground() const;
+
+  /* Decodes only the records that are needed to draw the document, when
+   * they are first needed. Records nothing refers to, like unused swatches
+   * and symbols, are never decoded. Finding the records takes a pass over
+   * them, which is kept in the inflate cache if there is one.
+   */
+  FHAPI void setLazyDecoding(bool lazy);
+  FHAPI bool getLazyDecoding() const;
+
+  /* Decodes the records of large documents in up to threads threads at
+   * once; 0 means one for each processor core. The default is 1. This has
+   * no effect if libfreehand was built without thread support, with an
+   * inflate window size or with lazy decoding.
+   */
+  FHAPI void setDecodeThreads(unsigned threads);
+  FHAPI unsigned getDecodeThreads() const;
+
+  enum Content
+  {
+    CONTENT_ALL,
+    CONTENT_NO_IMAGES,
+    CONTENT_PAGES
+  };
+
+  /* Decodes only the records that are needed for content. With
+   * CONTENT_NO_IMAGES, the data of images, which often make up most of a
+   * document, are skipped and the images are left out of the drawing.
+   * CONTENT_PAGES gives just the pages, with nothing on them. The default
+   * is CONTENT_ALL.
+   */
+  FHAPI void setContent(Content content);
+  FHAPI Content getContent() const;
+
+  /* Goes on with the records after a damaged one, where they can be found,
+   * instead of giving up on the rest of the document. The number of records
+   * that were left out can be had from FreeHandDocument::parse. The default
+   * is false.
+   */
+  FHAPI void setSkipDamagedRecords(bool skip);
+  FHAPI bool getSkipDamagedRecords() const;
+
+private:
+  FreeHandParseOptionsImpl *m_impl;
+};
+
 class FreeHandDocument
 {
 public:
+  enum SniffResult
+  {
+    SNIFF_UNSUPPORTED,
+    SNIFF_SUPPORTED,
+    SNIFF_NEED_MORE_DATA
+  };
 
   static FHAPI bool isSupported(librevenge::RVNGInputStream *input);
 
+  static FHAPI SniffResult sniff(const unsigned char *data, unsigned long size, int *version = nullptr, unsigned long *agdOffset = nullptr);
+
   static FHAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter);
+  static FHAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, const FreeHandParseOptions &options);
+  static FHAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, const FreeHandParseOptions &options, unsigned long *skippedRecords);
+
+  static FHAPI bool parseRecordGraph(librevenge::RVNGInputStream *input, FreeHandRecordGraph &graph);
+  static FHAPI bool parseRecordGraph(librevenge::RVNGInputStream *input, FreeHandRecordGraph &graph, const FreeHandParseOptions &options);
 };
 
 } // namespace libfreehand
@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FREEHANDMAPPEDSTREAM_H__
+#define __FREEHANDMAPPEDSTREAM_H__
+
+#include <librevenge/librevenge.h>
+
+#include "FreeHandDocument.h"
+
+namespace libfreehand
+{
+struct FreeHandMappedStreamImpl;
+
+/* A file stream that maps the file to memory, where the system can do
+ * that. read() returns pointers into the mapping, so parsing a document
+ * from it does not copy the file content. Elsewhere, the file is read to
+ * memory at once.
+ */
+class FreeHandMappedStream : public librevenge::RVNGInputStream
+{
+public:
+  FHAPI explicit FreeHandMappedStream(const char *filename);
+  FHAPI virtual ~FreeHandMappedStream();
+
+  // Returns false if the file could not be opened.
+  FHAPI bool isOpen() const;
+
+  FHAPI virtual bool isStructured();
+  FHAPI virtual unsigned subStreamCount();
+  FHAPI virtual const char *subStreamName(unsigned id);
+  FHAPI virtual bool existsSubStream(const char *name);
+  FHAPI virtual librevenge::RVNGInputStream *getSubStreamByName(const char *name);
+  FHAPI virtual librevenge::RVNGInputStream *getSubStreamById(unsigned id);
+
+  FHAPI virtual const unsigned char *read(unsigned long numBytes, unsigned long &numBytesRead);
+  FHAPI virtual int seek(long offset, librevenge::RVNG_SEEK_TYPE seekType);
+  FHAPI virtual long tell();
+  FHAPI virtual bool isEnd();
+
+private:
+  FreeHandMappedStream(const FreeHandMappedStream &);
+  FreeHandMappedStream &operator=(const FreeHandMappedStream &);
+
+  FreeHandMappedStreamImpl *m_impl;
+};
+
+} // namespace libfreehand
+
+#endif /* __FREEHANDMAPPEDSTREAM_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,66 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FREEHANDRECORDGRAPH_H__
+#define __FREEHANDRECORDGRAPH_H__
+
+#include "FreeHandDocument.h"
+
+namespace libfreehand
+{
+class FHRecordGraph;
+
+/* The records of a document and which records each of them refers to,
+ * e.g. a group to the list of its elements or a graphic style to its
+ * fill. Records are numbered from 1, as in the document; record 0 stands
+ * for the end of the document, which refers to the pages and everything
+ * on them. It is filled by FreeHandDocument::parseRecordGraph.
+ */
+class FreeHandRecordGraph
+{
+public:
+  FHAPI FreeHandRecordGraph();
+  FHAPI FreeHandRecordGraph(const FreeHandRecordGraph &other);
+  FHAPI ~FreeHandRecordGraph();
+  FHAPI FreeHandRecordGraph &operator=(const FreeHandRecordGraph &other);
+
+  // The number of records, not counting record 0
+  FHAPI unsigned getRecordCount() const;
+
+  // The type of a record, e.g. "Group", or null if it is not known
+  FHAPI const char *getRecordType(unsigned record) const;
+
+  // How many bytes the record takes in the document, once inflated
+  FHAPI unsigned long getRecordSize(unsigned record) const;
+
+  /* The records a record refers to, in the order they are read. count
+   * receives their number. A record may be referred to more than once.
+   */
+  FHAPI const unsigned *getReferences(unsigned record, unsigned &count) const;
+
+  // Whether the record can be reached from record 0, i.e. may be drawn
+  FHAPI bool isReachable(unsigned record) const;
+
+  /* All references at once: those of record r are getReferenceTargets()
+   * from index getReferenceOffsets()[r] up to getReferenceOffsets()[r + 1],
+   * for r from 0 to getRecordCount().
+   */
+  FHAPI const unsigned *getReferenceOffsets() const;
+  FHAPI const unsigned *getReferenceTargets() const;
+
+private:
+  friend class FreeHandDocument;
+
+  FHRecordGraph *m_impl;
+};
+
+} // namespace libfreehand
+
+#endif /* __FREEHANDRECORDGRAPH_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
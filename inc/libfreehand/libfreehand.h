@@ -11,6 +11,8 @@
 #define __LIBFREEHAND_H__
 
 #include "FreeHandDocument.h"
+#include "FreeHandMappedStream.h"
+#include "FreeHandRecordGraph.h"
 
 #endif
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,181 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+#include <librevenge/librevenge.h>
+
+#include "FHInflater.h"
+#include "FHInternalStream.h"
+
+namespace
+{
+
+int printUsage()
+{
+  printf("`fhinflatebench' measures how fast the content of FreeHand 9-11\n");
+  printf("documents is inflated, using synthetic data.\n");
+  printf("\n");
+  printf("Usage: fhinflatebench [OPTION] [SIZE]\n");
+  printf("\n");
+  printf("SIZE is the size of the inflated data in MiB (32 by default).\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("\t--background          inflate in a background thread too\n");
+  printf("\t--help                show this help message\n");
+  printf("\t--window SIZE         inflate through a window of SIZE bytes too\n");
+  return -1;
+}
+
+void putU16(std::vector<unsigned char> &data, unsigned value)
+{
+  data.push_back((unsigned char)(value >> 8));
+  data.push_back((unsigned char)value);
+}
+
+void putU32(std::vector<unsigned char> &data, unsigned value)
+{
+  putU16(data, value >> 16);
+  putU16(data, value & 0xffff);
+}
+
+// Something that looks like the records of a FreeHand 11 document: mostly
+// record ids, small counts and coordinates of path points.
+std::vector<unsigned char> createContent(unsigned long size)
+{
+  std::vector<unsigned char> data;
+  data.reserve(size + 1024);
+  unsigned seed = 1;
+  unsigned recordId = 1;
+  while (data.size() < size)
+  {
+    seed = seed * 1103515245 + 12345;
+    // an attribute holder and a path
+    putU16(data, recordId++);
+    putU16(data, 0);
+    putU16(data, recordId++);
+    putU16(data, 0);
+    const unsigned points = 4 + ((seed >> 16) & 0xf);
+    putU16(data, points);
+    for (unsigned i = 0; i < points; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      data.push_back(0x1b);
+      data.push_back(0);
+      for (unsigned j = 0; j < 3; ++j)
+      {
+        putU32(data, (300 + ((seed >> (8 + j)) & 0xff)) << 16);
+        putU32(data, (400 + ((seed >> (12 + j)) & 0xff)) << 16);
+      }
+    }
+  }
+  data.resize(size);
+  return data;
+}
+
+double toMBps(unsigned long bytes, std::chrono::steady_clock::duration time)
+{
+  const double seconds = std::chrono::duration<double>(time).count();
+  return seconds > 0 ? bytes / seconds / (1024 * 1024) : 0;
+}
+
+// Reads the data through FHInternalStream, with some work on them to
+// stand in for the parser.
+std::chrono::steady_clock::duration readStream(const std::vector<unsigned char> &compressed, unsigned long compressedSize, unsigned long window, bool background)
+{
+  std::chrono::steady_clock::duration best = std::chrono::steady_clock::duration::max();
+  for (int i = 0; i < 5; ++i)
+  {
+    librevenge::RVNGBinaryData binData(&compressed[0], compressedSize);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    libfreehand::FHInternalStreamOptions options;
+    options.m_compressed = true;
+    options.m_borrow = true;
+    options.m_window = window;
+    options.m_background = background;
+    libfreehand::FHInternalStream strm(binData.getDataStream(), compressedSize, options);
+    unsigned sum = 0;
+    while (!strm.isEnd())
+      sum = sum * 31 + strm.readU32();
+    const std::chrono::steady_clock::duration time = std::chrono::steady_clock::now() - start;
+    if (sum == 1)
+      printf("%u\n", sum);
+    if (time < best)
+      best = time;
+  }
+  return best;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long size = 32;
+  unsigned long window = 0;
+  bool background = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--background"))
+      background = true;
+    else if (!strcmp(argv[i], "--window") && i + 1 < argc)
+      window = strtoul(argv[++i], nullptr, 10);
+    else if (argv[i][0] != '-')
+      size = strtoul(argv[i], nullptr, 10);
+    else
+      return printUsage();
+  }
+  if (!size)
+    return printUsage();
+  size *= 1024 * 1024;
+
+  const std::vector<unsigned char> content = createContent(size);
+  std::vector<unsigned char> compressed(compressBound(size));
+  uLongf compressedSize = compressed.size();
+  if (compress(&compressed[0], &compressedSize, &content[0], size) != Z_OK)
+  {
+    fprintf(stderr, "Cannot compress the data\n");
+    return 1;
+  }
+  printf("%lu bytes compressed to %lu\n", size, (unsigned long)compressedSize);
+
+  const int rounds = 5;
+  std::chrono::steady_clock::duration best = std::chrono::steady_clock::duration::max();
+  for (int i = 0; i < rounds; ++i)
+  {
+    std::vector<unsigned char> out;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    libfreehand::FHInflater::inflateAll(&compressed[0], compressedSize, out);
+    const std::chrono::steady_clock::duration time = std::chrono::steady_clock::now() - start;
+    if (out != content)
+    {
+      fprintf(stderr, "Inflated data differ\n");
+      return 1;
+    }
+    if (time < best)
+      best = time;
+  }
+  printf("inflate all: %.1f MB/s\n", toMBps(size, best));
+
+  printf("read all: %.1f MB/s\n", toMBps(size, readStream(compressed, compressedSize, 0, false)));
+  if (window)
+    printf("read through a window: %.1f MB/s\n", toMBps(size, readStream(compressed, compressedSize, window, false)));
+  if (background)
+    printf("read, inflating in background: %.1f MB/s\n", toMBps(size, readStream(compressed, compressedSize, window, true)));
+
+  return 0;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
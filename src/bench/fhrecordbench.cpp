@@ -0,0 +1,216 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-generators/RVNGDummyDrawingGenerator.h>
+
+#include "FHParser.h"
+#include "FHRecordIndex.h"
+
+namespace
+{
+
+int printUsage()
+{
+  printf("`fhrecordbench' measures how fast FHParser goes through records.\n");
+  printf("\n");
+  printf("Usage: fhrecordbench [OPTION] [COUNT]\n");
+  printf("\n");
+  printf("COUNT is the number of records in thousands (1000 by default).\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("\t--help                show this help message\n");
+  printf("\t--index               only build the record index\n");
+  printf("\t--shapes              use paths, groups and transformations\n");
+  printf("\t--points N            give the paths N points (4 by default)\n");
+  return -1;
+}
+
+void putU16(std::vector<unsigned char> &data, unsigned value)
+{
+  data.push_back((unsigned char)(value >> 8));
+  data.push_back((unsigned char)value);
+}
+
+void putU32(std::vector<unsigned char> &data, unsigned value)
+{
+  putU16(data, value >> 16);
+  putU16(data, value & 0xffff);
+}
+
+struct RecordType
+{
+  const char *m_name;
+  unsigned m_size;
+  // the start of the record, the rest is zeros
+  const unsigned char *m_head;
+  unsigned m_headSize;
+};
+
+// Records that are cheap to read, so the time goes to finding their readers
+const RecordType RECORD_TYPES[] =
+{
+  { "AGDSelection", 8, nullptr, 0 },
+  { "BendFilter", 10, nullptr, 0 },
+  { "Brush", 4, nullptr, 0 },
+  { "Collector", 4, nullptr, 0 },
+  { "DateTime", 14, nullptr, 0 }
+};
+
+// a closed path with 4 points
+const unsigned char PATH_HEAD[] =
+{
+  0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 4
+};
+
+// The same path with count points
+std::vector<unsigned char> createPathHead(unsigned count)
+{
+  std::vector<unsigned char> head(PATH_HEAD, PATH_HEAD + sizeof(PATH_HEAD));
+  head[0] = head[20] = (unsigned char)(count >> 8);
+  head[1] = head[21] = (unsigned char)count;
+  return head;
+}
+
+// Records that make up drawings, so the time goes to reading them
+const RecordType SHAPE_RECORD_TYPES[] =
+{
+  { "Path", 22 + 4 * 27, PATH_HEAD, sizeof(PATH_HEAD) },
+  { "Group", 16, nullptr, 0 },
+  { "Xform", 52, nullptr, 0 }
+};
+
+const unsigned RECORD_TYPE_COUNT = sizeof(RECORD_TYPES) / sizeof(RECORD_TYPES[0]);
+const unsigned SHAPE_RECORD_TYPE_COUNT = sizeof(SHAPE_RECORD_TYPES) / sizeof(SHAPE_RECORD_TYPES[0]);
+
+// The dictionary of a real document has entries for about 200 types
+const unsigned DICTIONARY_SIZE = 200;
+
+unsigned getRecordTypeId(unsigned type)
+{
+  return 0x1000 + 37 * type;
+}
+
+// An uncompressed (FreeHand 8) document with count records of types
+std::vector<unsigned char> createDocument(unsigned long count, const RecordType *types, unsigned typeCount)
+{
+  std::vector<unsigned char> data;
+  data.push_back('A');
+  data.push_back('G');
+  data.push_back('D');
+  data.push_back('3');
+  putU32(data, 0);
+  putU32(data, 0); // the length, filled in below
+
+  std::vector<unsigned short> records;
+  records.reserve(count);
+  for (unsigned long i = 0; i < count; ++i)
+  {
+    const unsigned type = (unsigned)((i * 7 + (i >> 4)) % typeCount);
+    records.push_back((unsigned short)getRecordTypeId(type));
+    data.insert(data.end(), types[type].m_head, types[type].m_head + types[type].m_headSize);
+    data.insert(data.end(), types[type].m_size - types[type].m_headSize, 0);
+  }
+  // FHTail
+  data.insert(data.end(), 0x40, 0);
+
+  const unsigned length = (unsigned)data.size();
+  for (unsigned i = 0; i < 4; ++i)
+    data[8 + i] = (unsigned char)(length >> (8 * (3 - i)));
+
+  putU16(data, DICTIONARY_SIZE);
+  putU16(data, 0);
+  for (unsigned type = 0; type < DICTIONARY_SIZE; ++type)
+  {
+    putU16(data, getRecordTypeId(type));
+    putU16(data, 0);
+    const std::string name = type < typeCount ? std::string(types[type].m_name) : "Unused" + std::to_string(type);
+    data.insert(data.end(), name.begin(), name.end());
+    data.insert(data.end(), 3, 0);
+  }
+
+  putU32(data, (unsigned)records.size());
+  for (std::vector<unsigned short>::const_iterator it = records.begin(); it != records.end(); ++it)
+    putU16(data, *it);
+
+  return data;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long count = 1000;
+  bool indexOnly = false;
+  bool shapes = false;
+  unsigned long points = 4;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--index"))
+      indexOnly = true;
+    else if (!strcmp(argv[i], "--shapes"))
+      shapes = true;
+    else if (!strcmp(argv[i], "--points") && i + 1 < argc)
+      points = strtoul(argv[++i], nullptr, 10);
+    else if (argv[i][0] != '-')
+      count = strtoul(argv[i], nullptr, 10);
+    else
+      return printUsage();
+  }
+  if (!count || !points || points > 0xffff)
+    return printUsage();
+  count *= 1000;
+
+  const std::vector<unsigned char> pathHead = createPathHead((unsigned)points);
+  RecordType shapeTypes[SHAPE_RECORD_TYPE_COUNT];
+  std::copy(SHAPE_RECORD_TYPES, SHAPE_RECORD_TYPES + SHAPE_RECORD_TYPE_COUNT, shapeTypes);
+  shapeTypes[0].m_size = (unsigned)(pathHead.size() + points * 27);
+  shapeTypes[0].m_head = &pathHead[0];
+
+  const std::vector<unsigned char> document = shapes
+                                              ? createDocument(count, shapeTypes, SHAPE_RECORD_TYPE_COUNT)
+                                              : createDocument(count, RECORD_TYPES, RECORD_TYPE_COUNT);
+
+  std::chrono::steady_clock::duration best = std::chrono::steady_clock::duration::max();
+  for (int i = 0; i < 5; ++i)
+  {
+    librevenge::RVNGBinaryData binData(&document[0], document.size());
+    librevenge::RVNGDummyDrawingGenerator generator;
+    libfreehand::FHParser parser;
+    libfreehand::FHRecordIndex index;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool ok = indexOnly
+                    ? parser.buildRecordIndex(binData.getDataStream(), index)
+                    : parser.parse(binData.getDataStream(), &generator);
+    if (!ok)
+    {
+      fprintf(stderr, "Cannot parse the document\n");
+      return 1;
+    }
+    const std::chrono::steady_clock::duration time = std::chrono::steady_clock::now() - start;
+    if (time < best)
+      best = time;
+  }
+
+  const double seconds = std::chrono::duration<double>(best).count();
+  printf("%lu records: %.2f M records/s, %.1f ms\n", count, seconds > 0 ? count / seconds / 1e6 : 0, seconds * 1e3);
+
+  return 0;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -12,6 +12,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <librevenge-stream/librevenge-stream.h>
@@ -37,7 +38,11 @@ int printUsage()
   printf("\n");
   printf("Options:\n");
   printf("\t--callgraph           display the call graph nesting level\n");
+  printf("\t--cache-dir DIR       keep inflated data in directory DIR\n");
   printf("\t--help                show this help message\n");
+  printf("\t--lazy                decode only the records that are drawn\n");
+  printf("\t--skip-damaged        leave out damaged records instead of failing\n");
+  printf("\t--threads N           decode the records in N threads (0: one per core)\n");
   printf("\t--version             show version information\n");
   printf("\n");
   printf("Report bugs to <https://bugs.documentfoundation.org/>.\n");
@@ -56,6 +61,7 @@ int main(int argc, char *argv[])
 {
   bool printIndentLevel = false;
   char *file = nullptr;
+  libfreehand::FreeHandParseOptions options;
 
   if (argc < 2)
     return printUsage();
@@ -66,6 +72,14 @@ int main(int argc, char *argv[])
       printIndentLevel = true;
     else if (!strcmp(argv[i], "--version"))
       return printVersion();
+    else if (!strcmp(argv[i], "--cache-dir") && i + 1 < argc)
+      options.setInflateCacheDir(argv[++i]);
+    else if (!strcmp(argv[i], "--lazy"))
+      options.setLazyDecoding(true);
+    else if (!strcmp(argv[i], "--skip-damaged"))
+      options.setSkipDamagedRecords(true);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      options.setDecodeThreads((unsigned)strtoul(argv[++i], nullptr, 10));
     else if (!file && strncmp(argv[i], "--", 2))
       file = argv[i];
     else
@@ -75,7 +89,7 @@ int main(int argc, char *argv[])
   if (!file)
     return printUsage();
 
-  librevenge::RVNGFileStream input(file);
+  libfreehand::FreeHandMappedStream input(file);
 
   if (!libfreehand::FreeHandDocument::isSupported(&input))
   {
@@ -84,7 +98,10 @@ int main(int argc, char *argv[])
   }
 
   librevenge::RVNGRawDrawingGenerator painter(printIndentLevel);
-  libfreehand::FreeHandDocument::parse(&input, &painter);
+  unsigned long skippedRecords = 0;
+  libfreehand::FreeHandDocument::parse(&input, &painter, options, &skippedRecords);
+  if (skippedRecords)
+    fprintf(stderr, "WARNING: %lu damaged records were left out\n", skippedRecords);
 
   return 0;
 }
@@ -14,6 +14,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <librevenge-stream/librevenge-stream.h>
 #include <librevenge/librevenge.h>
@@ -33,7 +34,11 @@ int printUsage()
   printf("Usage: fh2svg [OPTION] INPUT\n");
   printf("\n");
   printf("Options:\n");
+  printf("\t--cache-dir DIR       keep inflated data in directory DIR\n");
   printf("\t--help                show this help message\n");
+  printf("\t--lazy                decode only the records that are drawn\n");
+  printf("\t--skip-damaged        leave out damaged records instead of failing\n");
+  printf("\t--threads N           decode the records in N threads (0: one per core)\n");
   printf("\t--version             show version information\n");
   printf("\n");
   printf("Report bugs to <https://bugs.documentfoundation.org/>.\n");
@@ -54,11 +59,20 @@ int main(int argc, char *argv[])
     return printUsage();
 
   char *file = nullptr;
+  libfreehand::FreeHandParseOptions options;
 
   for (int i = 1; i < argc; i++)
   {
     if (!strcmp(argv[i], "--version"))
       return printVersion();
+    else if (!strcmp(argv[i], "--cache-dir") && i + 1 < argc)
+      options.setInflateCacheDir(argv[++i]);
+    else if (!strcmp(argv[i], "--lazy"))
+      options.setLazyDecoding(true);
+    else if (!strcmp(argv[i], "--skip-damaged"))
+      options.setSkipDamagedRecords(true);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      options.setDecodeThreads((unsigned)strtoul(argv[++i], nullptr, 10));
     else if (!file && strncmp(argv[i], "--", 2))
       file = argv[i];
     else
@@ -68,7 +82,7 @@ int main(int argc, char *argv[])
   if (!file)
     return printUsage();
 
-  librevenge::RVNGFileStream input(file);
+  libfreehand::FreeHandMappedStream input(file);
 
   if (!libfreehand::FreeHandDocument::isSupported(&input))
   {
@@ -78,11 +92,14 @@ int main(int argc, char *argv[])
 
   librevenge::RVNGStringVector output;
   librevenge::RVNGSVGDrawingGenerator generator(output, "");
-  if (!libfreehand::FreeHandDocument::parse(&input, &generator))
+  unsigned long skippedRecords = 0;
+  if (!libfreehand::FreeHandDocument::parse(&input, &generator, options, &skippedRecords))
   {
     std::cerr << "ERROR: SVG Generation failed!" << std::endl;
     return 1;
   }
+  if (skippedRecords)
+    std::cerr << "WARNING: " << skippedRecords << " damaged records were left out" << std::endl;
   if (output.empty() || output[0].empty())
   {
     std::cerr << "ERROR: No SVG document generated!" << std::endl;
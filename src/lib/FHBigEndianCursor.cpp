@@ -0,0 +1,178 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "FHBigEndianCursor.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FH_SSE2 1
+#include <emmintrin.h>
+#ifdef __AVX2__
+#define FH_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define FH_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* The kernels below convert whole runs of values. They are chosen at
+ * compile time; each has a scalar loop for the rest of the run.
+ */
+
+namespace
+{
+
+const double FIXED_SCALE = 1. / 65536.;
+
+void convertU16(const unsigned char *data, unsigned long count, uint16_t *out)
+{
+  unsigned long i = 0;
+#if defined(FH_AVX2)
+  for (; i + 16 <= count; i += 16)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 2 * i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+  }
+#endif
+#if defined(FH_SSE2)
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+  }
+#elif defined(FH_NEON)
+  for (; i + 8 <= count; i += 8)
+    vst1q_u16(out + i, vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(data + 2 * i))));
+#endif
+  for (; i < count; ++i)
+    out[i] = (uint16_t)(((unsigned)data[2 * i] << 8) | data[2 * i + 1]);
+}
+
+void convertFixed(const unsigned char *data, unsigned long count, double *out)
+{
+  unsigned long i = 0;
+#if defined(FH_AVX2)
+  const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  const __m256d scale4 = _mm256_set1_pd(FIXED_SCALE);
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 4 * i)), swap32);
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), scale4));
+    _mm256_storeu_pd(out + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), scale4));
+  }
+#endif
+#if defined(FH_SSE2)
+  const __m128d scale = _mm_set1_pd(FIXED_SCALE);
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 4 * i));
+    // swap the bytes in the words, then the words
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), scale));
+  }
+#elif defined(FH_NEON)
+  const float64x2_t scale = vdupq_n_f64(FIXED_SCALE);
+  for (; i + 4 <= count; i += 4)
+  {
+    const int32x4_t v = vreinterpretq_s32_u8(vrev32q_u8(vld1q_u8(data + 4 * i)));
+    vst1q_f64(out + i, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), scale));
+    vst1q_f64(out + i + 2, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(v))), scale));
+  }
+#endif
+  for (; i < count; ++i)
+  {
+    const uint32_t value = ((uint32_t)data[4 * i] << 24) | ((uint32_t)data[4 * i + 1] << 16)
+                           | ((uint32_t)data[4 * i + 2] << 8) | (uint32_t)data[4 * i + 3];
+    out[i] = (double)(int32_t)value * FIXED_SCALE;
+  }
+}
+
+// Converts record ids up to the first escaped (i.e., 4 byte) one and
+// returns their number.
+unsigned long convertShortRecordIds(const unsigned char *data, unsigned long count, unsigned *out)
+{
+  unsigned long i = 0;
+#if defined(FH_SSE2)
+  const __m128i escape = _mm_set1_epi16(-1);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, escape)))
+      break;
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi16(v, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 4), _mm_unpackhi_epi16(v, zero));
+  }
+#elif defined(FH_NEON)
+  for (; i + 8 <= count; i += 8)
+  {
+    const uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(data + 2 * i)));
+    if (vmaxvq_u16(vceqq_u16(v, vdupq_n_u16(0xffff))))
+      break;
+    vst1q_u32(out + i, vmovl_u16(vget_low_u16(v)));
+    vst1q_u32(out + i + 4, vmovl_u16(vget_high_u16(v)));
+  }
+#endif
+  for (; i < count; ++i)
+  {
+    const unsigned value = ((unsigned)data[2 * i] << 8) | data[2 * i + 1];
+    if (value == 0xffff)
+      break;
+    out[i] = value;
+  }
+  return i;
+}
+
+}
+
+void libfreehand::FHBigEndianCursor::readU16Array(uint16_t *out, unsigned long count)
+{
+  const unsigned long available = std::min(count, getRemaining() / 2);
+  convertU16(m_pos, available, out);
+  m_pos += 2 * available;
+  if (available < count)
+  {
+    require(2);
+    std::fill(out + available, out + count, 0);
+  }
+}
+
+void libfreehand::FHBigEndianCursor::readS32FixedArray(double *out, unsigned long count)
+{
+  const unsigned long available = std::min(count, getRemaining() / 4);
+  convertFixed(m_pos, available, out);
+  m_pos += 4 * available;
+  if (available < count)
+  {
+    require(4);
+    std::fill(out + available, out + count, 0.);
+  }
+}
+
+void libfreehand::FHBigEndianCursor::readRecordIdArray(unsigned *out, unsigned long count)
+{
+  unsigned long done = 0;
+  while (done < count)
+  {
+    const unsigned long converted = convertShortRecordIds(m_pos, std::min(count - done, getRemaining() / 2), out + done);
+    m_pos += 2 * converted;
+    done += converted;
+    // an escaped id, or the end of data
+    if (done < count)
+      out[done++] = readRecordId();
+  }
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
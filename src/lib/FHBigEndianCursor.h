@@ -0,0 +1,176 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FHBIGENDIANCURSOR_H__
+#define __FHBIGENDIANCURSOR_H__
+
+#include "libfreehand_utils.h"
+
+namespace libfreehand
+{
+
+/* Reads big-endian values from a contiguous block of memory.
+ *
+ * If there is not enough data left for a value, 0 is returned, the rest of
+ * the data is skipped and the cursor remembers the failure until
+ * clearFailure() is called.
+ */
+class FHBigEndianCursor
+{
+public:
+  FHBigEndianCursor()
+    : m_begin(nullptr), m_end(nullptr), m_pos(nullptr), m_failed(false)
+  {
+  }
+
+  FHBigEndianCursor(const unsigned char *data, unsigned long size)
+    : m_begin(data), m_end(data + size), m_pos(data), m_failed(false)
+  {
+  }
+
+  // Moves to another block, keeping the failure state.
+  void setData(const unsigned char *data, unsigned long size)
+  {
+    m_begin = data;
+    m_end = data + size;
+    m_pos = data;
+  }
+
+  bool hasFailed() const
+  {
+    return m_failed;
+  }
+
+  void clearFailure()
+  {
+    m_failed = false;
+  }
+
+  unsigned long getSize() const
+  {
+    return (unsigned long)(m_end - m_begin);
+  }
+
+  unsigned long getRemaining() const
+  {
+    return (unsigned long)(m_end - m_pos);
+  }
+
+  bool isEnd() const
+  {
+    return m_pos == m_end;
+  }
+
+  unsigned long tell() const
+  {
+    return (unsigned long)(m_pos - m_begin);
+  }
+
+  const unsigned char *getCurrent() const
+  {
+    return m_pos;
+  }
+
+  // Moves to pos, or to the end if pos is beyond it.
+  void seek(unsigned long pos)
+  {
+    m_pos = pos < getSize() ? m_begin + pos : m_end;
+  }
+
+  void skip(unsigned long length)
+  {
+    if (require(length))
+      m_pos += length;
+  }
+
+  uint8_t readU8()
+  {
+    if (!require(1))
+      return 0;
+    return *m_pos++;
+  }
+
+  uint16_t readU16()
+  {
+    if (!require(2))
+      return 0;
+    const uint16_t value = (uint16_t)(((unsigned)m_pos[0] << 8) | m_pos[1]);
+    m_pos += 2;
+    return value;
+  }
+
+  uint32_t readU32()
+  {
+    if (!require(4))
+      return 0;
+    const uint32_t value = ((uint32_t)m_pos[0] << 24) | ((uint32_t)m_pos[1] << 16)
+                           | ((uint32_t)m_pos[2] << 8) | (uint32_t)m_pos[3];
+    m_pos += 4;
+    return value;
+  }
+
+  int8_t readS8()
+  {
+    return (int8_t)readU8();
+  }
+
+  int16_t readS16()
+  {
+    return (int16_t)readU16();
+  }
+
+  int32_t readS32()
+  {
+    return (int32_t)readU32();
+  }
+
+  // A 16.16 fixed point number
+  double readCoordinate()
+  {
+    return (double)readS32() / 65536.;
+  }
+
+  unsigned readRecordId()
+  {
+    unsigned recid = readU16();
+    if (recid == 0xffff)
+      recid = 0x1ff00 - readU16();
+    return recid;
+  }
+
+  /* Read count values at once, with the same result as reading them
+   * one by one.
+   */
+  void readU16Array(uint16_t *out, unsigned long count);
+  void readS32FixedArray(double *out, unsigned long count);
+  void readRecordIdArray(unsigned *out, unsigned long count);
+
+private:
+  bool require(unsigned long length)
+  {
+    if (getRemaining() < length)
+    {
+      FH_DEBUG_MSG(("FHBigEndianCursor: %lu bytes needed, but only %lu left\n", length, getRemaining()));
+      m_pos = m_end;
+      m_failed = true;
+      return false;
+    }
+    return true;
+  }
+
+  const unsigned char *m_begin;
+  const unsigned char *m_end;
+  const unsigned char *m_pos;
+  bool m_failed;
+};
+
+} // namespace libfreehand
+
+#endif /* __FHBIGENDIANCURSOR_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <string.h>
 #include <librevenge/librevenge.h>
 #include "FHCollector.h"
@@ -233,6 +234,17 @@ private:
   const unsigned m_id;
 };
 
+// Moves records from source to target, which has none with the same ids
+template<typename T>
+void mergeRecords(std::map<unsigned, T> &target, std::map<unsigned, T> &source)
+{
+  if (target.empty())
+    target.swap(source);
+  else
+    target.insert(std::make_move_iterator(source.begin()), std::make_move_iterator(source.end()));
+  source.clear();
+}
+
 }
 
 libfreehand::FHCollector::FHCollector() :
@@ -245,7 +257,8 @@ libfreehand::FHCollector::FHCollector() :
   m_tints(), m_lensFills(), m_radialFills(), m_newBlends(), m_filterAttributeHolders(), m_opacityFilters(),
   m_shadowFilters(), m_glowFilters(), m_tileFills(), m_symbolClasses(), m_symbolInstances(), m_patternFills(),
   m_linePatterns(), m_arrowPaths(),
-  m_strokeId(0), m_fillId(0), m_contentId(0), m_textBoxNumberId(0), m_visitedObjects()
+  m_strokeId(0), m_fillId(0), m_contentId(0), m_textBoxNumberId(0), m_visitedObjects(),
+  m_recordDecoder(nullptr), m_documentData(nullptr), m_documentSize(0)
 {
 }
 
@@ -285,6 +298,117 @@ void libfreehand::FHCollector::collectXform(unsigned recordId,
   m_transforms[recordId] = FHTransform(m11, m21, m12, m22, m13, m23);
 }
 
+void libfreehand::FHCollector::setRecordDecoder(FHRecordDecoder *decoder)
+{
+  m_recordDecoder = decoder;
+}
+
+void libfreehand::FHCollector::setDocumentData(const unsigned char *data, unsigned long size)
+{
+  m_documentData = data;
+  m_documentSize = size;
+}
+
+void libfreehand::FHCollector::merge(FHCollector &other)
+{
+  mergeRecords(m_transforms, other.m_transforms);
+  mergeRecords(m_paths, other.m_paths);
+  mergeRecords(m_strings, other.m_strings);
+  mergeRecords(m_lists, other.m_lists);
+  mergeRecords(m_layers, other.m_layers);
+  mergeRecords(m_groups, other.m_groups);
+  mergeRecords(m_clipGroups, other.m_clipGroups);
+  mergeRecords(m_compositePaths, other.m_compositePaths);
+  mergeRecords(m_pathTexts, other.m_pathTexts);
+  mergeRecords(m_tStrings, other.m_tStrings);
+  mergeRecords(m_fonts, other.m_fonts);
+  mergeRecords(m_tEffects, other.m_tEffects);
+  mergeRecords(m_paragraphs, other.m_paragraphs);
+  mergeRecords(m_tabs, other.m_tabs);
+  mergeRecords(m_textBloks, other.m_textBloks);
+  mergeRecords(m_textObjects, other.m_textObjects);
+  mergeRecords(m_charProperties, other.m_charProperties);
+  mergeRecords(m_paragraphProperties, other.m_paragraphProperties);
+  mergeRecords(m_rgbColors, other.m_rgbColors);
+  mergeRecords(m_basicFills, other.m_basicFills);
+  mergeRecords(m_propertyLists, other.m_propertyLists);
+  mergeRecords(m_basicLines, other.m_basicLines);
+  mergeRecords(m_customProcs, other.m_customProcs);
+  mergeRecords(m_patternLines, other.m_patternLines);
+  mergeRecords(m_displayTexts, other.m_displayTexts);
+  mergeRecords(m_graphicStyles, other.m_graphicStyles);
+  mergeRecords(m_attributeHolders, other.m_attributeHolders);
+  mergeRecords(m_data, other.m_data);
+  mergeRecords(m_dataLists, other.m_dataLists);
+  mergeRecords(m_images, other.m_images);
+  mergeRecords(m_multiColorLists, other.m_multiColorLists);
+  mergeRecords(m_linearFills, other.m_linearFills);
+  mergeRecords(m_tints, other.m_tints);
+  mergeRecords(m_lensFills, other.m_lensFills);
+  mergeRecords(m_radialFills, other.m_radialFills);
+  mergeRecords(m_newBlends, other.m_newBlends);
+  mergeRecords(m_filterAttributeHolders, other.m_filterAttributeHolders);
+  mergeRecords(m_opacityFilters, other.m_opacityFilters);
+  mergeRecords(m_shadowFilters, other.m_shadowFilters);
+  mergeRecords(m_glowFilters, other.m_glowFilters);
+  mergeRecords(m_tileFills, other.m_tileFills);
+  mergeRecords(m_symbolClasses, other.m_symbolClasses);
+  mergeRecords(m_symbolInstances, other.m_symbolInstances);
+  mergeRecords(m_patternFills, other.m_patternFills);
+  mergeRecords(m_linePatterns, other.m_linePatterns);
+  mergeRecords(m_arrowPaths, other.m_arrowPaths);
+}
+
+void libfreehand::FHCollector::removeRecord(unsigned recordId)
+{
+  m_transforms.erase(recordId);
+  m_paths.erase(recordId);
+  m_strings.erase(recordId);
+  m_lists.erase(recordId);
+  m_layers.erase(recordId);
+  m_groups.erase(recordId);
+  m_clipGroups.erase(recordId);
+  m_compositePaths.erase(recordId);
+  m_pathTexts.erase(recordId);
+  m_tStrings.erase(recordId);
+  m_fonts.erase(recordId);
+  m_tEffects.erase(recordId);
+  m_paragraphs.erase(recordId);
+  m_tabs.erase(recordId);
+  m_textBloks.erase(recordId);
+  m_textObjects.erase(recordId);
+  m_charProperties.erase(recordId);
+  m_paragraphProperties.erase(recordId);
+  m_rgbColors.erase(recordId);
+  m_basicFills.erase(recordId);
+  m_propertyLists.erase(recordId);
+  m_basicLines.erase(recordId);
+  m_customProcs.erase(recordId);
+  m_patternLines.erase(recordId);
+  m_displayTexts.erase(recordId);
+  m_graphicStyles.erase(recordId);
+  m_attributeHolders.erase(recordId);
+  m_data.erase(recordId);
+  m_dataLists.erase(recordId);
+  m_images.erase(recordId);
+  m_multiColorLists.erase(recordId);
+  m_linearFills.erase(recordId);
+  m_tints.erase(recordId);
+  m_lensFills.erase(recordId);
+  m_radialFills.erase(recordId);
+  m_newBlends.erase(recordId);
+  m_filterAttributeHolders.erase(recordId);
+  m_opacityFilters.erase(recordId);
+  m_shadowFilters.erase(recordId);
+  m_glowFilters.erase(recordId);
+  m_tileFills.erase(recordId);
+  m_symbolClasses.erase(recordId);
+  m_symbolInstances.erase(recordId);
+  m_patternFills.erase(recordId);
+  m_linePatterns.erase(recordId);
+  m_arrowPaths.erase(recordId);
+}
+
 void libfreehand::FHCollector::collectFHTail(unsigned /* recordId */, const FHTail &fhTail)
 {
   m_fhTail = fhTail;
@@ -451,7 +575,7 @@ void libfreehand::FHCollector::collectFilterAttributeHolder(unsigned recordId, c
   m_filterAttributeHolders[recordId] = filterAttributeHolder;
 }
 
-void libfreehand::FHCollector::collectData(unsigned recordId, const librevenge::RVNGBinaryData &data)
+void libfreehand::FHCollector::collectData(unsigned recordId, const FHData &data)
 {
   m_data[recordId] = data;
 }
@@ -1320,6 +1444,7 @@ void libfreehand::FHCollector::_outputLayer(unsigned layerId, librevenge::RVNGDr
   if (!painter)
     return;
 
+  _decodeRecord(layerId);
   std::map<unsigned, FHLayer>::const_iterator layerIter = m_layers.find(layerId);
   if (layerIter == m_layers.end())
   {
@@ -1539,6 +1664,7 @@ void libfreehand::FHCollector::_outputParagraph(const libfreehand::FHParagraph *
   if (!painter || !paragraph)
     return;
   bool paragraphOpened=false;
+  _decodeRecord(paragraph->m_textBlokId);
   std::map<unsigned, std::vector<unsigned short> >::const_iterator iter = m_textBloks.find(paragraph->m_textBlokId);
   if (iter != m_textBloks.end())
   {
@@ -1575,12 +1701,14 @@ void libfreehand::FHCollector::_outputParagraph(const libfreehand::FHParagraph *
 
 void libfreehand::FHCollector::_appendCharacterProperties(librevenge::RVNGPropertyList &propList, unsigned charPropsId)
 {
+  _decodeRecord(charPropsId);
   std::map<unsigned, FHCharProperties>::const_iterator iter = m_charProperties.find(charPropsId);
   if (iter == m_charProperties.end())
     return;
   const FHCharProperties &charProps = iter->second;
   if (charProps.m_fontNameId)
   {
+    _decodeRecord(charProps.m_fontNameId);
     std::map<unsigned, librevenge::RVNGString>::const_iterator iterString = m_strings.find(charProps.m_fontNameId);
     if (iterString != m_strings.end())
       propList.insert("style:font-name", iterString->second);
@@ -1590,6 +1718,7 @@ void libfreehand::FHCollector::_appendCharacterProperties(librevenge::RVNGProper
     _appendFontProperties(propList, charProps.m_fontId);
   if (charProps.m_textColorId)
   {
+    _decodeRecord(charProps.m_textColorId);
     std::map<unsigned, FHBasicFill>::const_iterator iterBasicFill = m_basicFills.find(charProps.m_textColorId);
     if (iterBasicFill != m_basicFills.end() && iterBasicFill->second.m_colorId)
     {
@@ -1601,6 +1730,7 @@ void libfreehand::FHCollector::_appendCharacterProperties(librevenge::RVNGProper
   FHTEffect const *eff=_findTEffect(charProps.m_tEffectId);
   if (eff && eff->m_nameId)
   {
+    _decodeRecord(eff->m_nameId);
     std::map<unsigned, librevenge::RVNGString>::const_iterator iterString = m_strings.find(eff->m_nameId);
     if (iterString != m_strings.end())
     {
@@ -1659,6 +1789,7 @@ void libfreehand::FHCollector::_appendCharacterProperties(librevenge::RVNGProper
 {
   if (charProps.m_fontNameId)
   {
+    _decodeRecord(charProps.m_fontNameId);
     std::map<unsigned, librevenge::RVNGString>::const_iterator iterString = m_strings.find(charProps.m_fontNameId);
     if (iterString != m_strings.end())
       propList.insert("style:font-name", iterString->second);
@@ -1688,6 +1819,7 @@ void libfreehand::FHCollector::_appendCharacterProperties(librevenge::RVNGProper
   FHTEffect const *eff=_findTEffect(charProps.m_textEffsId);
   if (eff && eff->m_shortNameId)
   {
+    _decodeRecord(eff->m_shortNameId);
     std::map<unsigned, librevenge::RVNGString>::const_iterator iterString = m_strings.find(eff->m_shortNameId);
     if (iterString != m_strings.end())
     {
@@ -1746,6 +1878,7 @@ void libfreehand::FHCollector::_appendParagraphProperties(librevenge::RVNGProper
 
 void libfreehand::FHCollector::_appendParagraphProperties(librevenge::RVNGPropertyList &propList, unsigned paragraphPropsId)
 {
+  _decodeRecord(paragraphPropsId);
   std::map<unsigned, FHParagraphProperties>::const_iterator iter = m_paragraphProperties.find(paragraphPropsId);
   if (iter == m_paragraphProperties.end())
     return;
@@ -1755,6 +1888,7 @@ void libfreehand::FHCollector::_appendParagraphProperties(librevenge::RVNGProper
     switch (it.first)
     {
     case FH_PARA_TAB_TABLE_ID:
+      _decodeRecord(it.second);
       if (m_tabs.find(it.second)!=m_tabs.end())
       {
         std::vector<FHTab> const &tabs=m_tabs.find(it.second)->second;
@@ -2176,6 +2310,7 @@ void libfreehand::FHCollector::_outputTextRun(const std::vector<unsigned short>
 
 const std::vector<unsigned> *libfreehand::FHCollector::_findListElements(unsigned id)
 {
+  _decodeRecord(id);
   std::map<unsigned, FHList>::const_iterator iter = m_lists.find(id);
   if (iter != m_lists.end())
     return &(iter->second.m_elements);
@@ -2185,12 +2320,14 @@ const std::vector<unsigned> *libfreehand::FHCollector::_findListElements(unsigne
 
 void libfreehand::FHCollector::_appendFontProperties(librevenge::RVNGPropertyList &propList, unsigned agdFontId)
 {
+  _decodeRecord(agdFontId);
   std::map<unsigned, FHAGDFont>::const_iterator iter = m_fonts.find(agdFontId);
   if (iter == m_fonts.end())
     return;
   const FHAGDFont &font = iter->second;
   if (font.m_fontNameId)
   {
+    _decodeRecord(font.m_fontNameId);
     std::map<unsigned, librevenge::RVNGString>::const_iterator iterString = m_strings.find(font.m_fontNameId);
     if (iterString != m_strings.end())
       propList.insert("style:font-name", iterString->second);
@@ -2696,6 +2833,7 @@ const libfreehand::FHPath *libfreehand::FHCollector::_findPath(unsigned id)
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHPath>::const_iterator iter = m_paths.find(id);
   if (iter != m_paths.end())
     return &(iter->second);
@@ -2706,6 +2844,7 @@ const libfreehand::FHNewBlend *libfreehand::FHCollector::_findNewBlend(unsigned
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHNewBlend>::const_iterator iter = m_newBlends.find(id);
   if (iter != m_newBlends.end())
     return &(iter->second);
@@ -2716,6 +2855,7 @@ const libfreehand::FHGroup *libfreehand::FHCollector::_findGroup(unsigned id)
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHGroup>::const_iterator iter = m_groups.find(id);
   if (iter != m_groups.end())
     return &(iter->second);
@@ -2726,6 +2866,7 @@ const libfreehand::FHGroup *libfreehand::FHCollector::_findClipGroup(unsigned id
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHGroup>::const_iterator iter = m_clipGroups.find(id);
   if (iter != m_clipGroups.end())
     return &(iter->second);
@@ -2736,6 +2877,7 @@ const libfreehand::FHCompositePath *libfreehand::FHCollector::_findCompositePath
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHCompositePath>::const_iterator iter = m_compositePaths.find(id);
   if (iter != m_compositePaths.end())
     return &(iter->second);
@@ -2746,6 +2888,7 @@ const libfreehand::FHPathText *libfreehand::FHCollector::_findPathText(unsigned
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHPathText>::const_iterator iter = m_pathTexts.find(id);
   if (iter != m_pathTexts.end())
     return &(iter->second);
@@ -2756,6 +2899,7 @@ const libfreehand::FHTextObject *libfreehand::FHCollector::_findTextObject(unsig
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHTextObject>::const_iterator iter = m_textObjects.find(id);
   if (iter != m_textObjects.end())
     return &(iter->second);
@@ -2766,6 +2910,7 @@ const libfreehand::FHTransform *libfreehand::FHCollector::_findTransform(unsigne
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHTransform>::const_iterator iter = m_transforms.find(id);
   if (iter != m_transforms.end())
     return &(iter->second);
@@ -2776,6 +2921,7 @@ const libfreehand::FHTEffect *libfreehand::FHCollector::_findTEffect(unsigned id
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHTEffect>::const_iterator iter = m_tEffects.find(id);
   if (iter != m_tEffects.end())
     return &(iter->second);
@@ -2786,6 +2932,7 @@ const libfreehand::FHParagraph *libfreehand::FHCollector::_findParagraph(unsigne
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHParagraph>::const_iterator iter = m_paragraphs.find(id);
   if (iter != m_paragraphs.end())
     return &(iter->second);
@@ -2796,6 +2943,7 @@ const std::vector<libfreehand::FHTab> *libfreehand::FHCollector::_findTabTable(u
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, std::vector<libfreehand::FHTab> >::const_iterator iter = m_tabs.find(id);
   if (iter != m_tabs.end())
     return &(iter->second);
@@ -2806,6 +2954,7 @@ const std::vector<unsigned> *libfreehand::FHCollector::_findTStringElements(unsi
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, std::vector<unsigned> >::const_iterator iter = m_tStrings.find(id);
   if (iter != m_tStrings.end())
     return &(iter->second);
@@ -2816,6 +2965,7 @@ const libfreehand::FHPropList *libfreehand::FHCollector::_findPropList(unsigned
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHPropList>::const_iterator iter = m_propertyLists.find(id);
   if (iter != m_propertyLists.end())
     return &(iter->second);
@@ -2826,6 +2976,7 @@ const libfreehand::FHGraphicStyle *libfreehand::FHCollector::_findGraphicStyle(u
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHGraphicStyle>::const_iterator iter = m_graphicStyles.find(id);
   if (iter != m_graphicStyles.end())
     return &(iter->second);
@@ -2836,6 +2987,7 @@ const libfreehand::FHBasicFill *libfreehand::FHCollector::_findBasicFill(unsigne
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHBasicFill>::const_iterator iter = m_basicFills.find(id);
   if (iter != m_basicFills.end())
     return &(iter->second);
@@ -2846,6 +2998,7 @@ const libfreehand::FHLinearFill *libfreehand::FHCollector::_findLinearFill(unsig
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHLinearFill>::const_iterator iter = m_linearFills.find(id);
   if (iter != m_linearFills.end())
     return &(iter->second);
@@ -2856,6 +3009,7 @@ const libfreehand::FHLensFill *libfreehand::FHCollector::_findLensFill(unsigned
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHLensFill>::const_iterator iter = m_lensFills.find(id);
   if (iter != m_lensFills.end())
     return &(iter->second);
@@ -2866,6 +3020,7 @@ const libfreehand::FHRadialFill *libfreehand::FHCollector::_findRadialFill(unsig
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHRadialFill>::const_iterator iter = m_radialFills.find(id);
   if (iter != m_radialFills.end())
     return &(iter->second);
@@ -2876,6 +3031,7 @@ const libfreehand::FHTileFill *libfreehand::FHCollector::_findTileFill(unsigned
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHTileFill>::const_iterator iter = m_tileFills.find(id);
   if (iter != m_tileFills.end())
     return &(iter->second);
@@ -2886,6 +3042,7 @@ const libfreehand::FHPatternFill *libfreehand::FHCollector::_findPatternFill(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHPatternFill>::const_iterator iter = m_patternFills.find(id);
   if (iter != m_patternFills.end())
     return &(iter->second);
@@ -2896,6 +3053,7 @@ const libfreehand::FHLinePattern *libfreehand::FHCollector::_findLinePattern(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHLinePattern>::const_iterator iter = m_linePatterns.find(id);
   if (iter != m_linePatterns.end())
     return &(iter->second);
@@ -2906,6 +3064,7 @@ const libfreehand::FHPath *libfreehand::FHCollector::_findArrowPath(unsigned id)
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHPath>::const_iterator iter = m_arrowPaths.find(id);
   if (iter != m_arrowPaths.end())
     return &(iter->second);
@@ -2916,6 +3075,7 @@ const libfreehand::FHBasicLine *libfreehand::FHCollector::_findBasicLine(unsigne
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHBasicLine>::const_iterator iter = m_basicLines.find(id);
   if (iter != m_basicLines.end())
     return &(iter->second);
@@ -2926,6 +3086,7 @@ const libfreehand::FHCustomProc *libfreehand::FHCollector::_findCustomProc(unsig
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHCustomProc>::const_iterator iter = m_customProcs.find(id);
   if (iter != m_customProcs.end())
     return &(iter->second);
@@ -2936,6 +3097,7 @@ const libfreehand::FHPatternLine *libfreehand::FHCollector::_findPatternLine(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHPatternLine>::const_iterator iter = m_patternLines.find(id);
   if (iter != m_patternLines.end())
     return &(iter->second);
@@ -2946,6 +3108,7 @@ const libfreehand::FHRGBColor *libfreehand::FHCollector::_findRGBColor(unsigned
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHRGBColor>::const_iterator iter = m_rgbColors.find(id);
   if (iter != m_rgbColors.end())
     return &(iter->second);
@@ -2956,6 +3119,7 @@ const libfreehand::FHTintColor *libfreehand::FHCollector::_findTintColor(unsigne
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHTintColor>::const_iterator iter = m_tints.find(id);
   if (iter != m_tints.end())
     return &(iter->second);
@@ -2966,6 +3130,7 @@ const libfreehand::FHDisplayText *libfreehand::FHCollector::_findDisplayText(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHDisplayText>::const_iterator iter = m_displayTexts.find(id);
   if (iter != m_displayTexts.end())
     return &(iter->second);
@@ -2976,17 +3141,19 @@ const libfreehand::FHImageImport *libfreehand::FHCollector::_findImageImport(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHImageImport>::const_iterator iter = m_images.find(id);
   if (iter != m_images.end())
     return &(iter->second);
   return nullptr;
 }
 
-const librevenge::RVNGBinaryData *libfreehand::FHCollector::_findData(unsigned id)
+const libfreehand::FHData *libfreehand::FHCollector::_findData(unsigned id)
 {
   if (!id)
     return nullptr;
-  std::map<unsigned, librevenge::RVNGBinaryData>::const_iterator iter = m_data.find(id);
+  _decodeRecord(id);
+  std::map<unsigned, FHData>::const_iterator iter = m_data.find(id);
   if (iter != m_data.end())
     return &(iter->second);
   return nullptr;
@@ -2996,6 +3163,7 @@ const libfreehand::FHSymbolClass *libfreehand::FHCollector::_findSymbolClass(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHSymbolClass>::const_iterator iter = m_symbolClasses.find(id);
   if (iter != m_symbolClasses.end())
     return &(iter->second);
@@ -3006,6 +3174,7 @@ const libfreehand::FHSymbolInstance *libfreehand::FHCollector::_findSymbolInstan
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHSymbolInstance>::const_iterator iter = m_symbolInstances.find(id);
   if (iter != m_symbolInstances.end())
     return &(iter->second);
@@ -3016,6 +3185,7 @@ const libfreehand::FHFilterAttributeHolder *libfreehand::FHCollector::_findFilte
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FHFilterAttributeHolder>::const_iterator iter = m_filterAttributeHolders.find(id);
   if (iter != m_filterAttributeHolders.end())
     return &(iter->second);
@@ -3026,6 +3196,7 @@ const std::vector<libfreehand::FHColorStop> *libfreehand::FHCollector::_findMult
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, std::vector<libfreehand::FHColorStop> >::const_iterator iter = m_multiColorLists.find(id);
   if (iter != m_multiColorLists.end())
     return &(iter->second);
@@ -3036,6 +3207,7 @@ const double *libfreehand::FHCollector::_findOpacityFilter(unsigned id)
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, double>::const_iterator iter = m_opacityFilters.find(id);
   if (iter != m_opacityFilters.end())
     return &(iter->second);
@@ -3046,6 +3218,7 @@ const libfreehand::FWShadowFilter *libfreehand::FHCollector::_findFWShadowFilter
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FWShadowFilter>::const_iterator iter = m_shadowFilters.find(id);
   if (iter != m_shadowFilters.end())
     return &(iter->second);
@@ -3056,6 +3229,7 @@ const libfreehand::FWGlowFilter *libfreehand::FHCollector::_findFWGlowFilter(uns
 {
   if (!id)
     return nullptr;
+  _decodeRecord(id);
   std::map<unsigned, FWGlowFilter>::const_iterator iter = m_glowFilters.find(id);
   if (iter != m_glowFilters.end())
     return &(iter->second);
@@ -3067,6 +3241,7 @@ unsigned libfreehand::FHCollector::_findStrokeId(const libfreehand::FHGraphicSty
   unsigned listId = graphicStyle.m_attrId;
   if (!listId)
     return 0;
+  _decodeRecord(listId);
   std::map<unsigned, FHList>::const_iterator iter = m_lists.find(listId);
   if (iter == m_lists.end())
     return 0;
@@ -3085,6 +3260,7 @@ unsigned libfreehand::FHCollector::_findFillId(const libfreehand::FHGraphicStyle
   unsigned listId = graphicStyle.m_attrId;
   if (!listId)
     return 0;
+  _decodeRecord(listId);
   std::map<unsigned, FHList>::const_iterator iter = m_lists.find(listId);
   if (iter == m_lists.end())
     return 0;
@@ -3106,6 +3282,7 @@ const libfreehand::FHFilterAttributeHolder *libfreehand::FHCollector::_findFilte
   unsigned listId = graphicStyle.m_attrId;
   if (!listId)
     return nullptr;
+  _decodeRecord(listId);
   std::map<unsigned, FHList>::const_iterator iter = m_lists.find(listId);
   if (iter == m_lists.end())
     return nullptr;
@@ -3124,6 +3301,7 @@ unsigned libfreehand::FHCollector::_findValueFromAttribute(unsigned id)
 {
   if (!id)
     return 0;
+  _decodeRecord(id);
   std::map<unsigned, FHAttributeHolder>::const_iterator iter = m_attributeHolders.find(id);
   if (iter == m_attributeHolders.end())
     return 0;
@@ -3137,16 +3315,45 @@ unsigned libfreehand::FHCollector::_findValueFromAttribute(unsigned id)
 
 librevenge::RVNGBinaryData libfreehand::FHCollector::getImageData(unsigned id)
 {
+  _decodeRecord(id);
   std::map<unsigned, FHDataList>::const_iterator iter = m_dataLists.find(id);
   librevenge::RVNGBinaryData data;
   if (iter == m_dataLists.end())
     return data;
+  // Parts that follow each other in the document are copied in one piece
+  const unsigned char *start = nullptr;
+  unsigned long length = 0;
   for (unsigned int element : iter->second.m_elements)
   {
-    const librevenge::RVNGBinaryData *pData = _findData(element);
-    if (pData)
-      data.append(*pData);
+    const FHData *pData = _findData(element);
+    if (!pData)
+      continue;
+    const unsigned char *part = nullptr;
+    unsigned long partLength = 0;
+    if (!pData->m_copy.empty())
+    {
+      part = &pData->m_copy[0];
+      partLength = pData->m_copy.size();
+    }
+    else if (m_documentData && pData->m_offset <= m_documentSize && pData->m_length <= m_documentSize - pData->m_offset)
+    {
+      part = m_documentData + pData->m_offset;
+      partLength = pData->m_length;
+    }
+    if (!partLength)
+      continue;
+    if (start && part == start + length)
+    {
+      length += partLength;
+      continue;
+    }
+    if (length)
+      data.append(start, length);
+    start = part;
+    length = partLength;
   }
+  if (length)
+    data.append(start, length);
   return data;
 }
 
@@ -22,6 +22,14 @@
 namespace libfreehand
 {
 
+// Decodes records that have not been collected yet, when they are needed
+class FHRecordDecoder
+{
+public:
+  virtual ~FHRecordDecoder() {}
+  virtual void decodeRecord(unsigned recordId) = 0;
+};
+
 class FHCollector
 {
 public:
@@ -56,7 +64,7 @@ public:
   void collectGraphicStyle(unsigned recordId, const FHGraphicStyle &graphicStyle);
   void collectAttributeHolder(unsigned recordId, const FHAttributeHolder &attributeHolder);
   void collectFilterAttributeHolder(unsigned recordId, const FHFilterAttributeHolder &filterAttributeHolder);
-  void collectData(unsigned recordId, const librevenge::RVNGBinaryData &data);
+  void collectData(unsigned recordId, const FHData &data);
   void collectDataList(unsigned recordId, const FHDataList &list);
   void collectImage(unsigned recordId, const FHImageImport &image);
   void collectMultiColorList(unsigned recordId, const std::vector<FHColorStop> &colorStops);
@@ -86,10 +94,26 @@ public:
 
   void outputDrawing(librevenge::RVNGDrawingInterface *painter);
 
+  void setRecordDecoder(FHRecordDecoder *decoder);
+  /* The inflated document, which the collected data are parts of. It must
+   * stay valid until the drawing is output.
+   */
+  void setDocumentData(const unsigned char *data, unsigned long size);
+  // Takes over the records collected by other, e.g. in another thread
+  void merge(FHCollector &other);
+  // Forgets what was collected from a record, e.g. a damaged one
+  void removeRecord(unsigned recordId);
+
 private:
   FHCollector(const FHCollector &);
   FHCollector &operator=(const FHCollector &);
 
+  void _decodeRecord(unsigned id)
+  {
+    if (m_recordDecoder && id)
+      m_recordDecoder->decodeRecord(id);
+  }
+
   void _normalizePath(FHPath &path);
   void _normalizePoint(double &x, double &y);
 
@@ -182,7 +206,7 @@ private:
   const FWShadowFilter *_findFWShadowFilter(unsigned id);
   const FWGlowFilter *_findFWGlowFilter(unsigned id);
   const FHFilterAttributeHolder *_findFilterAttributeHolder(unsigned id);
-  const librevenge::RVNGBinaryData *_findData(unsigned id);
+  const FHData *_findData(unsigned id);
   librevenge::RVNGString getColorString(unsigned id, double tint=1);
   unsigned _findFillId(const FHGraphicStyle &graphicStyle);
   unsigned _findStrokeId(const FHGraphicStyle &graphicStyle);
@@ -229,7 +253,7 @@ private:
   std::map<unsigned, FHDisplayText> m_displayTexts;
   std::map<unsigned, FHGraphicStyle> m_graphicStyles;
   std::map<unsigned, FHAttributeHolder> m_attributeHolders;
-  std::map<unsigned, librevenge::RVNGBinaryData> m_data;
+  std::map<unsigned, FHData> m_data;
   std::map<unsigned, FHDataList> m_dataLists;
   std::map<unsigned, FHImageImport> m_images;
   std::map<unsigned, std::vector<FHColorStop> > m_multiColorLists;
@@ -254,6 +278,9 @@ private:
   unsigned m_contentId;
   unsigned m_textBoxNumberId;
   std::deque<unsigned> m_visitedObjects;
+  FHRecordDecoder *m_recordDecoder;
+  const unsigned char *m_documentData;
+  unsigned long m_documentSize;
 };
 
 } // namespace libfreehand
@@ -0,0 +1,308 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "FHInflateCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace
+{
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+void sipRound(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3)
+{
+  v0 += v1;
+  v1 = ROTL(v1, 13);
+  v1 ^= v0;
+  v0 = ROTL(v0, 32);
+  v2 += v3;
+  v3 = ROTL(v3, 16);
+  v3 ^= v2;
+  v0 += v3;
+  v3 = ROTL(v3, 21);
+  v3 ^= v0;
+  v2 += v1;
+  v1 = ROTL(v1, 17);
+  v1 ^= v2;
+  v2 = ROTL(v2, 32);
+}
+
+uint64_t readU64LE(const unsigned char *data)
+{
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i)
+    value = (value << 8) | data[i];
+  return value;
+}
+
+// SipHash-2-4 with 128 bit output
+void sipHash128(const uint64_t key[2], const unsigned char *data, unsigned long size, uint64_t hash[2])
+{
+  uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+  uint64_t v1 = 0x646f72616e646f6dULL ^ key[1] ^ 0xee;
+  uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+  uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+
+  unsigned long i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    const uint64_t m = readU64LE(data + i);
+    v3 ^= m;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+  uint64_t last = (uint64_t)size << 56;
+  for (unsigned j = 0; i + j < size; ++j)
+    last |= (uint64_t)data[i + j] << (8 * j);
+  v3 ^= last;
+  sipRound(v0, v1, v2, v3);
+  sipRound(v0, v1, v2, v3);
+  v0 ^= last;
+
+  v2 ^= 0xee;
+  for (int r = 0; r < 4; ++r)
+    sipRound(v0, v1, v2, v3);
+  hash[0] = v0 ^ v1 ^ v2 ^ v3;
+  v1 ^= 0xdd;
+  for (int r = 0; r < 4; ++r)
+    sipRound(v0, v1, v2, v3);
+  hash[1] = v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef ROTL
+
+const unsigned ENTRY_NAME_LENGTH = 32;
+
+#ifdef HAVE_SYS_MMAN_H
+
+bool isEntryName(const char *name)
+{
+  unsigned i = 0;
+  for (; name[i]; ++i)
+  {
+    if (i == ENTRY_NAME_LENGTH || !((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f')))
+      return false;
+  }
+  return i == ENTRY_NAME_LENGTH;
+}
+
+#endif
+
+}
+
+libfreehand::FHInflateCacheEntry::FHInflateCacheEntry(void *data, unsigned long size)
+  : m_data(data), m_size(size)
+{
+}
+
+libfreehand::FHInflateCacheEntry::~FHInflateCacheEntry()
+{
+#ifdef HAVE_SYS_MMAN_H
+  munmap(m_data, m_size);
+#endif
+}
+
+libfreehand::FHInflateCache::FHInflateCache(const std::string &dir, unsigned long maxSize)
+  : m_dir(dir), m_maxSize(maxSize), m_key(), m_valid(false)
+{
+  m_valid = readKey();
+}
+
+std::string libfreehand::FHInflateCache::getEntryName(const unsigned char *compressed, unsigned long size) const
+{
+  if (!m_valid)
+    return std::string();
+
+  uint64_t hash[2];
+  sipHash128(m_key, compressed, size, hash);
+  char name[ENTRY_NAME_LENGTH + 1];
+  std::snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)hash[0], (unsigned long long)hash[1]);
+  return name;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+
+bool libfreehand::FHInflateCache::readKey()
+{
+  const std::string keyPath = m_dir + "/key";
+  unsigned char key[16];
+
+  std::FILE *file = std::fopen(keyPath.c_str(), "rb");
+  if (!file)
+  {
+    // Create the key. Another process might be doing the same, so write it
+    // to a temporary file and link it in place only if there is no key yet.
+    std::string tmpPath = m_dir + "/tmp-XXXXXX";
+    const int fd = mkstemp(&tmpPath[0]);
+    if (fd < 0)
+      return false;
+    std::random_device random;
+    for (unsigned i = 0; i < sizeof(key); i += 4)
+    {
+      const unsigned value = random();
+      for (unsigned j = 0; j < 4; ++j)
+        key[i + j] = (unsigned char)(value >> (8 * j));
+    }
+    const bool written = write(fd, key, sizeof(key)) == (ssize_t)sizeof(key);
+    close(fd);
+    if (written)
+      (void)link(tmpPath.c_str(), keyPath.c_str());
+    unlink(tmpPath.c_str());
+    file = std::fopen(keyPath.c_str(), "rb");
+    if (!file)
+      return false;
+  }
+
+  const bool valid = std::fread(key, 1, sizeof(key), file) == sizeof(key);
+  std::fclose(file);
+  if (!valid)
+    return false;
+  m_key[0] = readU64LE(key);
+  m_key[1] = readU64LE(key + 8);
+  return true;
+}
+
+std::unique_ptr<libfreehand::FHInflateCacheEntry> libfreehand::FHInflateCache::find(const std::string &name)
+{
+  if (name.empty())
+    return std::unique_ptr<FHInflateCacheEntry>();
+
+  const std::string path = m_dir + "/" + name;
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return std::unique_ptr<FHInflateCacheEntry>();
+
+  std::unique_ptr<FHInflateCacheEntry> entry;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0)
+  {
+    void *const data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      entry.reset(new FHInflateCacheEntry(data, (unsigned long)info.st_size));
+      // mark it as recently used
+      (void)utime(path.c_str(), nullptr);
+      FH_DEBUG_MSG(("FHInflateCache::find - found %s\n", name.c_str()));
+    }
+  }
+  close(fd);
+  return entry;
+}
+
+void libfreehand::FHInflateCache::store(const std::string &name, const unsigned char *data, unsigned long size)
+{
+  if (name.empty() || !size || size > m_maxSize)
+    return;
+
+  std::string tmpPath = m_dir + "/tmp-XXXXXX";
+  const int fd = mkstemp(&tmpPath[0]);
+  if (fd < 0)
+    return;
+  unsigned long written = 0;
+  while (written < size)
+  {
+    const ssize_t n = write(fd, data + written, size - written);
+    if (n <= 0)
+      break;
+    written += (unsigned long)n;
+  }
+  close(fd);
+
+  // readers never see a partial entry
+  if (written != size || rename(tmpPath.c_str(), (m_dir + "/" + name).c_str()) != 0)
+  {
+    unlink(tmpPath.c_str());
+    return;
+  }
+  FH_DEBUG_MSG(("FHInflateCache::store - stored %s\n", name.c_str()));
+
+  evict();
+}
+
+void libfreehand::FHInflateCache::evict()
+{
+  DIR *const dir = opendir(m_dir.c_str());
+  if (!dir)
+    return;
+
+  struct Entry
+  {
+    std::string m_path;
+    time_t m_time;
+    unsigned long m_size;
+  };
+  std::vector<Entry> entries;
+  unsigned long total = 0;
+  while (const struct dirent *const dirEntry = readdir(dir))
+  {
+    if (!isEntryName(dirEntry->d_name))
+      continue;
+    Entry entry;
+    entry.m_path = m_dir + "/" + dirEntry->d_name;
+    struct stat info;
+    if (stat(entry.m_path.c_str(), &info) != 0)
+      continue;
+    entry.m_time = info.st_mtime;
+    entry.m_size = (unsigned long)info.st_size;
+    total += entry.m_size;
+    entries.push_back(entry);
+  }
+  closedir(dir);
+
+  if (total <= m_maxSize)
+    return;
+
+  std::sort(entries.begin(), entries.end(), [](const Entry &left, const Entry &right)
+  {
+    return left.m_time < right.m_time;
+  });
+  for (std::vector<Entry>::const_iterator it = entries.begin(); it != entries.end() && total > m_maxSize; ++it)
+  {
+    if (unlink(it->m_path.c_str()) == 0)
+      total -= it->m_size;
+  }
+}
+
+#else
+
+bool libfreehand::FHInflateCache::readKey()
+{
+  return false;
+}
+
+std::unique_ptr<libfreehand::FHInflateCacheEntry> libfreehand::FHInflateCache::find(const std::string &)
+{
+  return std::unique_ptr<FHInflateCacheEntry>();
+}
+
+void libfreehand::FHInflateCache::store(const std::string &, const unsigned char *, unsigned long)
+{
+}
+
+void libfreehand::FHInflateCache::evict()
+{
+}
+
+#endif
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
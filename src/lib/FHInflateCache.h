@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FHINFLATECACHE_H__
+#define __FHINFLATECACHE_H__
+
+#include <memory>
+#include <string>
+
+#include "libfreehand_utils.h"
+
+namespace libfreehand
+{
+
+// Inflated data from the cache, mapped to memory
+class FHInflateCacheEntry
+{
+public:
+  FHInflateCacheEntry(void *data, unsigned long size);
+  ~FHInflateCacheEntry();
+
+  const unsigned char *getData() const
+  {
+    return static_cast<const unsigned char *>(m_data);
+  }
+  unsigned long getSize() const
+  {
+    return m_size;
+  }
+
+private:
+  FHInflateCacheEntry(const FHInflateCacheEntry &);
+  FHInflateCacheEntry &operator=(const FHInflateCacheEntry &);
+
+  void *m_data;
+  unsigned long m_size;
+};
+
+/* An on-disk cache of inflated data, keyed by a hash of the compressed
+ * data. The hash is keyed by a secret, random key stored in the cache
+ * directory, so nobody can make up compressed data that hit a given entry.
+ * If the cache grows beyond maxSize bytes, the least recently used entries
+ * are removed.
+ *
+ * The cache is only available on systems with mmap; elsewhere it never
+ * finds anything.
+ */
+class FHInflateCache
+{
+public:
+  FHInflateCache(const std::string &dir, unsigned long maxSize);
+
+  // Returns the name of the entry for the compressed data, or an empty string.
+  std::string getEntryName(const unsigned char *compressed, unsigned long size) const;
+  std::unique_ptr<FHInflateCacheEntry> find(const std::string &name);
+  void store(const std::string &name, const unsigned char *data, unsigned long size);
+
+private:
+  bool readKey();
+  void evict();
+
+  std::string m_dir;
+  unsigned long m_maxSize;
+  uint64_t m_key[2];
+  bool m_valid;
+};
+
+} // namespace libfreehand
+
+#endif /* __FHINFLATECACHE_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,317 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "FHInflater.h"
+
+#include <algorithm>
+#include "libfreehand_utils.h"
+
+#ifdef HAVE_PTHREAD
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#ifdef HAVE_ZLIB_NG
+#include <zlib-ng.h>
+#define FH_ZLIB(name) ::zng_ ## name
+typedef zng_stream FHZStream;
+#else
+#include <zlib.h>
+#define FH_ZLIB(name) ::name
+typedef z_stream FHZStream;
+#endif
+
+namespace
+{
+
+// The largest piece zlib can take at once
+const unsigned long MAX_ZLIB_BLOCK = 1UL << 30;
+
+// What FreeHand documents typically compress to
+const unsigned long COMPRESSION_RATIO = 4;
+
+const unsigned long MIN_OUTPUT_SIZE = 16384;
+
+// The ring between the inflating thread and the reader
+const unsigned long PIPELINE_CHUNK_SIZE = 65536;
+const unsigned PIPELINE_CHUNKS = 16;
+
+}
+
+namespace libfreehand
+{
+
+struct FHInflaterState
+{
+  FHInflaterState()
+    : m_stream(), m_valid(false), m_finished(false), m_damaged(false)
+  {
+  }
+
+  unsigned long inflate(unsigned char *out, unsigned long size);
+
+  FHZStream m_stream;
+  bool m_valid;
+  bool m_finished;
+  bool m_damaged;
+};
+
+unsigned long FHInflaterState::inflate(unsigned char *out, unsigned long size)
+{
+  unsigned long written = 0;
+  while (!m_finished && written < size)
+  {
+    const unsigned long block = std::min(size - written, MAX_ZLIB_BLOCK);
+    m_stream.avail_out = (unsigned)block;
+    m_stream.next_out = out + written;
+    const int ret = FH_ZLIB(inflate)(&m_stream, Z_NO_FLUSH);
+    written += block - m_stream.avail_out;
+    switch (ret)
+    {
+    case Z_NEED_DICT:
+    case Z_DATA_ERROR:
+    case Z_MEM_ERROR:
+      m_damaged = true;
+      m_finished = true;
+      break;
+    case Z_STREAM_END:
+      m_finished = true;
+      break;
+    default:
+      // no progress is possible: the data are truncated
+      if (m_stream.avail_out != 0)
+        m_finished = true;
+      break;
+    }
+  }
+  return written;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* The inflating thread writes to a ring of chunks, the reader takes them
+ * in order. Only the chunks counted by m_count belong to the reader.
+ */
+struct FHInflaterPipeline
+{
+  explicit FHInflaterPipeline(FHInflaterState &state)
+    : m_state(state), m_chunks(PIPELINE_CHUNKS, std::vector<unsigned char>(PIPELINE_CHUNK_SIZE)),
+      m_sizes(PIPELINE_CHUNKS, 0), m_head(0), m_count(0), m_offset(0), m_done(false), m_damaged(false), m_stop(false),
+      m_mutex(), m_produced(), m_consumed(), m_thread()
+  {
+    m_thread = std::thread(&FHInflaterPipeline::run, this);
+  }
+
+  ~FHInflaterPipeline()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_consumed.notify_one();
+    m_thread.join();
+  }
+
+  void run();
+  unsigned long read(unsigned char *out, unsigned long size, bool &finished, bool &damaged);
+
+  FHInflaterState &m_state;
+  std::vector<std::vector<unsigned char> > m_chunks;
+  std::vector<unsigned long> m_sizes;
+  unsigned m_head;
+  unsigned m_count;
+  unsigned long m_offset;
+  bool m_done;
+  bool m_damaged;
+  bool m_stop;
+  std::mutex m_mutex;
+  std::condition_variable m_produced;
+  std::condition_variable m_consumed;
+  std::thread m_thread;
+
+private:
+  FHInflaterPipeline(const FHInflaterPipeline &);
+  FHInflaterPipeline &operator=(const FHInflaterPipeline &);
+};
+
+void FHInflaterPipeline::run()
+{
+  for (;;)
+  {
+    unsigned slot = 0;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_consumed.wait(lock, [this] { return m_stop || m_count < PIPELINE_CHUNKS; });
+      if (m_stop)
+        return;
+      slot = (m_head + m_count) % PIPELINE_CHUNKS;
+    }
+
+    const unsigned long size = m_state.inflate(&m_chunks[slot][0], PIPELINE_CHUNK_SIZE);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_sizes[slot] = size;
+      ++m_count;
+      m_done = m_state.m_finished;
+      m_damaged = m_state.m_damaged;
+    }
+    m_produced.notify_one();
+    if (m_state.m_finished)
+      return;
+  }
+}
+
+unsigned long FHInflaterPipeline::read(unsigned char *out, unsigned long size, bool &finished, bool &damaged)
+{
+  unsigned long written = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (written < size)
+  {
+    m_produced.wait(lock, [this] { return m_done || m_count > 0; });
+    if (m_damaged)
+    {
+      // the data are useless, so there is no point in reading the rest
+      finished = true;
+      damaged = true;
+      m_count = 0;
+      break;
+    }
+    if (m_count == 0)
+    {
+      finished = true;
+      break;
+    }
+
+    const unsigned head = m_head;
+    const unsigned long length = std::min(m_sizes[head] - m_offset, size - written);
+    lock.unlock();
+    std::copy(&m_chunks[head][0] + m_offset, &m_chunks[head][0] + m_offset + length, out + written);
+    lock.lock();
+    written += length;
+    m_offset += length;
+    if (m_offset == m_sizes[head])
+    {
+      m_head = (m_head + 1) % PIPELINE_CHUNKS;
+      --m_count;
+      m_offset = 0;
+      m_consumed.notify_one();
+    }
+  }
+  if (m_done && m_count == 0)
+    finished = true;
+  return written;
+}
+
+#else
+
+struct FHInflaterPipeline
+{
+};
+
+#endif
+
+}
+
+libfreehand::FHInflater::FHInflater(const unsigned char *data, unsigned long size, bool background)
+  : m_state(new FHInflaterState()), m_pipeline(), m_finished(false), m_damaged(false), m_totalOut(0)
+{
+  FHZStream &strm = m_state->m_stream;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  if (FH_ZLIB(inflateInit)(&strm) != Z_OK || size > MAX_ZLIB_BLOCK)
+  {
+    m_finished = true;
+    m_damaged = true;
+    return;
+  }
+  m_state->m_valid = true;
+  strm.avail_in = (unsigned)size;
+  strm.next_in = const_cast<unsigned char *>(data);
+
+#ifdef HAVE_PTHREAD
+  if (background)
+    m_pipeline.reset(new FHInflaterPipeline(*m_state));
+#else
+  (void)background;
+#endif
+}
+
+libfreehand::FHInflater::~FHInflater()
+{
+  // stop the thread before the state goes away
+  m_pipeline.reset();
+  if (m_state->m_valid)
+    (void)FH_ZLIB(inflateEnd)(&m_state->m_stream);
+}
+
+unsigned long libfreehand::FHInflater::inflate(unsigned char *out, unsigned long size)
+{
+  if (m_finished)
+    return 0;
+
+  unsigned long written = 0;
+#ifdef HAVE_PTHREAD
+  if (m_pipeline)
+    written = m_pipeline->read(out, size, m_finished, m_damaged);
+  else
+#endif
+  {
+    written = m_state->inflate(out, size);
+    m_finished = m_state->m_finished;
+    m_damaged = m_state->m_damaged;
+  }
+  m_totalOut += written;
+  return written;
+}
+
+bool libfreehand::FHInflater::isFinished() const
+{
+  return m_finished;
+}
+
+bool libfreehand::FHInflater::isDamaged() const
+{
+  return m_damaged;
+}
+
+unsigned long libfreehand::FHInflater::getTotalOut() const
+{
+  return m_totalOut;
+}
+
+bool libfreehand::FHInflater::inflateAll(const unsigned char *data, unsigned long size, std::vector<unsigned char> &out)
+{
+  FHInflater inflater(data, size);
+
+  // Guess the size, so the output need not be reallocated often.
+  out.resize(std::max(size * COMPRESSION_RATIO, MIN_OUTPUT_SIZE));
+  unsigned long total = 0;
+  for (;;)
+  {
+    total += inflater.inflate(&out[total], out.size() - total);
+    if (inflater.isFinished())
+      break;
+    out.resize(out.size() * 2);
+  }
+
+  if (inflater.isDamaged())
+  {
+    out.clear();
+    return false;
+  }
+  out.resize(total);
+  return true;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FHINFLATER_H__
+#define __FHINFLATER_H__
+
+#include <memory>
+#include <vector>
+
+namespace libfreehand
+{
+
+struct FHInflaterPipeline;
+struct FHInflaterState;
+
+/* Inflates zlib compressed data. It uses zlib-ng instead of zlib if
+ * configure found it.
+ *
+ * If background is set (and threads are available), the data are
+ * inflated ahead in a separate thread, which stops when it gets too far
+ * ahead of the reader.
+ */
+class FHInflater
+{
+public:
+  FHInflater(const unsigned char *data, unsigned long size, bool background=false);
+  ~FHInflater();
+
+  /* Inflates at most size bytes to out and returns the number of bytes
+   * written. Less than size means that there is nothing more to inflate.
+   */
+  unsigned long inflate(unsigned char *out, unsigned long size);
+  bool isFinished() const;
+  // The data are damaged (and not just truncated).
+  bool isDamaged() const;
+  unsigned long getTotalOut() const;
+
+  /* Inflates all of data to out. On error, out is left empty and false is
+   * returned. Truncated data are not an error.
+   */
+  static bool inflateAll(const unsigned char *data, unsigned long size, std::vector<unsigned char> &out);
+
+private:
+  FHInflater(const FHInflater &);
+  FHInflater &operator=(const FHInflater &);
+
+  std::unique_ptr<FHInflaterState> m_state;
+  std::unique_ptr<FHInflaterPipeline> m_pipeline;
+  bool m_finished;
+  bool m_damaged;
+  unsigned long m_totalOut;
+};
+
+} // namespace libfreehand
+
+#endif /* __FHINFLATER_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -8,86 +8,273 @@
  */
 
 
-#include <zlib.h>
+#include <algorithm>
+#include <limits>
 #include "FHInternalStream.h"
+#include "FHInflateCache.h"
+#include "FHInflater.h"
 #include "libfreehand_utils.h"
-#include <string.h>  // for memcpy
 
 
 #define CHUNK 16384
 
-libfreehand::FHInternalStream::FHInternalStream(librevenge::RVNGInputStream *input, unsigned long size, bool compressed) :
+namespace
+{
+
+// window size for data inflated in the background, but kept whole
+const unsigned long KEEP_ALL = std::numeric_limits<unsigned long>::max();
+
+}
+
+libfreehand::FHInternalStream::FHInternalStream(librevenge::RVNGInputStream *input, unsigned long size, const FHInternalStreamOptions &options) :
   librevenge::RVNGInputStream(),
-  m_offset(0),
-  m_buffer()
+  m_cursor(),
+  m_buffer(),
+  m_cacheEntry(),
+  m_cacheEntryName(),
+  m_windowed(false),
+  m_inflater(),
+  m_compressed(nullptr),
+  m_compressedSize(0),
+  m_compressedBuffer(),
+  m_window(0),
+  m_base(0),
+  m_totalSize(-1),
+  m_pending(-1),
+  m_damaged(false)
 {
   if (!size)
     return;
 
-  if (!compressed)
+  if (!options.m_compressed)
   {
     unsigned long tmpNumBytesRead = 0;
     const unsigned char *tmpBuffer = input->read(size, tmpNumBytesRead);
 
-    if (size != tmpNumBytesRead)
-      return;
-
-    m_buffer = std::vector<unsigned char>(size);
-    memcpy(&m_buffer[0], tmpBuffer, size);
+    if (options.m_borrow && tmpBuffer && size == tmpNumBytesRead)
+      m_cursor.setData(tmpBuffer, size);
+    else
+      copyFrom(input, tmpBuffer, tmpNumBytesRead, size);
   }
   else
   {
-    int ret;
-    unsigned have;
-    z_stream strm;
-    unsigned char out[CHUNK];
-
-    /* allocate inflate state */
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = 0;
-    strm.next_in = Z_NULL;
-    ret = inflateInit(&strm);
-    if (ret != Z_OK)
-      return;
-
     unsigned long tmpNumBytesRead = 0;
     const unsigned char *tmpBuffer = input->read(size, tmpNumBytesRead);
-
     if (size != tmpNumBytesRead)
+      return;
+
+    FHInflateCache *const cache = options.m_cache;
+    if (cache)
+    {
+      m_cacheEntryName = cache->getEntryName(tmpBuffer, size);
+      m_cacheEntry = cache->find(m_cacheEntryName);
+      if (m_cacheEntry)
+      {
+        m_cursor.setData(m_cacheEntry->getData(), m_cacheEntry->getSize());
+        return;
+      }
+    }
+
+    const unsigned long window = options.m_window;
+    if (!window && !options.m_background)
     {
-      (void)inflateEnd(&strm);
+      inflateAll(tmpBuffer, size);
+      if (cache && !m_buffer.empty())
+        cache->store(m_cacheEntryName, &m_buffer[0], m_buffer.size());
       return;
     }
 
-    strm.avail_in = (uInt)tmpNumBytesRead;
-    strm.next_in = (Bytef *)tmpBuffer;
+    if (!options.m_borrow)
+    {
+      m_compressedBuffer.assign(tmpBuffer, tmpBuffer + size);
+      tmpBuffer = &m_compressedBuffer[0];
+    }
+    m_inflater.reset(new FHInflater(tmpBuffer, size, options.m_background));
+    m_windowed = true;
+    m_compressed = tmpBuffer;
+    m_compressedSize = size;
+    m_window = window ? std::max(window, (unsigned long)(4 * CHUNK)) : KEEP_ALL;
+  }
+}
+
+libfreehand::FHInternalStream::FHInternalStream(const unsigned char *data, unsigned long size) :
+  librevenge::RVNGInputStream(),
+  m_cursor(data, size),
+  m_buffer(),
+  m_cacheEntry(),
+  m_cacheEntryName(),
+  m_windowed(false),
+  m_inflater(),
+  m_compressed(nullptr),
+  m_compressedSize(0),
+  m_compressedBuffer(),
+  m_window(0),
+  m_base(0),
+  m_totalSize(-1),
+  m_pending(-1),
+  m_damaged(false)
+{
+}
+
+libfreehand::FHInternalStream::~FHInternalStream()
+{
+}
 
-    do
+void libfreehand::FHInternalStream::inflateAll(const unsigned char *data, unsigned long size)
+{
+  m_damaged = !FHInflater::inflateAll(data, size, m_buffer);
+  if (!m_buffer.empty())
+    m_cursor.setData(&m_buffer[0], m_buffer.size());
+}
+
+void libfreehand::FHInternalStream::fill(unsigned long end)
+{
+  const unsigned long offset = tell();
+  // Data before this are kept, so short seeks back are cheap.
+  const unsigned long history = m_window / 4;
+
+  unsigned long size = m_buffer.size();
+  while (m_inflater && m_base + size < end)
+  {
+    if (size + CHUNK > m_window)
     {
-      strm.avail_out = CHUNK;
-      strm.next_out = out;
-      ret = inflate(&strm, Z_NO_FLUSH);
-      switch (ret)
+      const unsigned long keep = offset > history ? offset - history : 0;
+      if (keep > m_base)
       {
-      case Z_NEED_DICT:
-      case Z_DATA_ERROR:
-      case Z_MEM_ERROR:
-        (void)inflateEnd(&strm);
-        m_buffer.clear();
-        return;
+        const unsigned long drop = std::min(keep - m_base, size);
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + drop);
+        m_base += drop;
+        size -= drop;
       }
+    }
 
-      have = CHUNK - strm.avail_out;
+    m_buffer.resize(size + CHUNK);
+    size += m_inflater->inflate(&m_buffer[size], CHUNK);
+    m_buffer.resize(size);
+    if (m_inflater->isDamaged())
+    {
+      setDamaged();
+      size = 0;
+    }
+    else if (m_inflater->isFinished())
+    {
+      m_inflater.reset();
+      m_totalSize = long(m_base + size);
+    }
+  }
 
-      for (unsigned long i=0; i<have; i++)
-        m_buffer.push_back(out[i]);
+  m_cursor.setData(m_buffer.empty() ? nullptr : &m_buffer[0], size);
+  moveTo(offset);
+}
 
-    }
-    while (strm.avail_out == 0);
-    (void)inflateEnd(&strm);
+void libfreehand::FHInternalStream::moveTo(unsigned long offset)
+{
+  if (offset <= m_base + m_cursor.getSize())
+  {
+    m_pending = -1;
+    m_cursor.seek(offset - m_base);
   }
+  else
+  {
+    m_pending = long(offset);
+    m_cursor.seek(m_cursor.getSize());
+  }
+}
+
+void libfreehand::FHInternalStream::materialize()
+{
+  FH_DEBUG_MSG(("FHInternalStream::materialize - window starts at 0x%lx\n", m_base));
+  m_inflater.reset();
+  m_windowed = false;
+  m_cursor.setData(nullptr, 0);
+  m_base = 0;
+  m_pending = -1;
+  m_buffer.clear();
+  inflateAll(m_compressed, m_compressedSize);
+  m_compressedBuffer.clear();
+  m_compressedBuffer.shrink_to_fit();
+}
+
+void libfreehand::FHInternalStream::setDamaged()
+{
+  FH_DEBUG_MSG(("FHInternalStream::setDamaged - the compressed data are damaged\n"));
+  // Drop what was inflated before the error, as inflateAll does
+  m_inflater.reset();
+  m_damaged = true;
+  m_buffer.clear();
+  m_base = 0;
+  m_totalSize = 0;
+  m_cursor.setData(nullptr, 0);
+}
+
+const unsigned char *libfreehand::FHInternalStream::getData(unsigned long &size)
+{
+  size = 0;
+  if (m_windowed)
+  {
+    if (m_window != KEEP_ALL)
+      return nullptr;
+    getSize();
+  }
+  size = m_cursor.getSize();
+  return size ? m_cursor.getCurrent() - m_cursor.tell() : nullptr;
+}
+
+bool libfreehand::FHInternalStream::keepsAllData() const
+{
+  return !m_windowed || m_window == KEEP_ALL;
+}
+
+bool libfreehand::FHInternalStream::isDamaged()
+{
+  if (m_windowed && !m_damaged)
+    getSize();
+  return m_damaged;
+}
+
+unsigned long libfreehand::FHInternalStream::getSize()
+{
+  if (!m_windowed)
+    return m_cursor.getSize();
+
+  if (m_totalSize < 0 && m_window == KEEP_ALL)
+    fill(KEEP_ALL);
+  else if (m_totalSize < 0)
+  {
+    // Inflate the data once more just to learn their size. That is
+    // cheaper than keeping them.
+    FHInflater inflater(m_compressed, m_compressedSize);
+    std::vector<unsigned char> out(CHUNK);
+    while (!inflater.isFinished())
+      inflater.inflate(&out[0], CHUNK);
+    if (inflater.isDamaged())
+      setDamaged();
+    else
+      m_totalSize = long(inflater.getTotalOut());
+  }
+  return (unsigned long)m_totalSize;
+}
+
+void libfreehand::FHInternalStream::copyFrom(librevenge::RVNGInputStream *input, const unsigned char *data, unsigned long numBytes, unsigned long size)
+{
+  // The parent stream could not hand out the whole block at once, so
+  // gather it piecewise.
+  m_buffer.reserve(size);
+  while (data && numBytes)
+  {
+    m_buffer.insert(m_buffer.end(), data, data + numBytes);
+    if (m_buffer.size() >= size)
+      break;
+    data = input->read(size - m_buffer.size(), numBytes);
+  }
+
+  if (m_buffer.size() != size)
+  {
+    m_buffer.clear();
+    return;
+  }
+
+  m_cursor.setData(&m_buffer[0], size);
 }
 
 const unsigned char *libfreehand::FHInternalStream::read(unsigned long numBytes, unsigned long &numBytesRead)
@@ -97,57 +284,79 @@ const unsigned char *libfreehand::FHInternalStream::read(unsigned long numBytes,
   if (numBytes == 0)
     return nullptr;
 
-  unsigned numBytesToRead;
-
-  if ((m_offset+numBytes) < m_buffer.size())
-    numBytesToRead = numBytes;
-  else
-    numBytesToRead = m_buffer.size() - m_offset;
-
-  numBytesRead = numBytesToRead; // about as paranoid as we can be..
+  if (m_windowed && m_cursor.getRemaining() < numBytes)
+    fill(tell() + numBytes);
 
+  const unsigned long numBytesToRead = std::min(numBytes, m_cursor.getRemaining());
   if (numBytesToRead == 0)
     return nullptr;
 
-  long oldOffset = m_offset;
-  m_offset += numBytesToRead;
-
-  return &m_buffer[oldOffset];
+  numBytesRead = numBytesToRead;
+  const unsigned char *const data = m_cursor.getCurrent();
+  m_cursor.skip(numBytesToRead);
+  return data;
 }
 
 int libfreehand::FHInternalStream::seek(long offset, librevenge::RVNG_SEEK_TYPE seekType)
 {
+  long newOffset = tell();
   if (seekType == librevenge::RVNG_SEEK_CUR)
-    m_offset += offset;
+    newOffset += offset;
   else if (seekType == librevenge::RVNG_SEEK_SET)
-    m_offset = offset;
+    newOffset = offset;
   else if (seekType == librevenge::RVNG_SEEK_END)
-    m_offset = long(static_cast<unsigned long>(m_buffer.size())) + offset;
+    newOffset = long(getSize()) + offset;
 
-  if (m_offset < 0)
+  if (m_windowed && newOffset < long(m_base))
+    materialize();
+
+  if (newOffset < 0)
   {
-    m_offset = 0;
+    moveTo(0);
     return 1;
   }
-  if ((long)m_offset > (long)m_buffer.size())
+
+  if (m_windowed && (unsigned long)newOffset > m_base + m_cursor.getSize())
   {
-    m_offset = m_buffer.size();
+    // The data in between are only inflated when something is read, unless
+    // we need them to find out whether the offset is valid.
+    moveTo((unsigned long)newOffset);
+    if (m_totalSize < 0)
+      fill((unsigned long)newOffset);
+    const long size = m_totalSize < 0 ? long(m_base + m_cursor.getSize()) : m_totalSize;
+    if (newOffset > size)
+    {
+      moveTo((unsigned long)size);
+      return 1;
+    }
+    return 0;
+  }
+
+  if ((unsigned long)newOffset > m_base + m_cursor.getSize())
+  {
+    moveTo(m_base + m_cursor.getSize());
     return 1;
   }
 
+  moveTo((unsigned long)newOffset);
   return 0;
 }
 
 long libfreehand::FHInternalStream::tell()
 {
-  return m_offset;
+  if (m_pending >= 0)
+    return m_pending;
+  return long(m_base + m_cursor.tell());
 }
 
 bool libfreehand::FHInternalStream::isEnd()
 {
-  if ((long)m_offset >= (long)m_buffer.size())
-    return true;
+  if (!m_cursor.isEnd())
+    return false;
+
+  if (m_windowed)
+    fill(tell() + 1);
 
-  return false;
+  return m_cursor.isEnd();
 }
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
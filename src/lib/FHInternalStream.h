@@ -11,18 +11,53 @@
 #ifndef __FHINTERNALSTREAM_H__
 #define __FHINTERNALSTREAM_H__
 
+#include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <librevenge-stream/librevenge-stream.h>
 
+#include "FHBigEndianCursor.h"
+
 namespace libfreehand
 {
 
-class FHInternalStream : public librevenge::RVNGInputStream
+class FHInflateCache;
+class FHInflateCacheEntry;
+class FHInflater;
+
+/* How FHInternalStream reads its block from the input.
+ *
+ * An uncompressed block that the input can return in one piece is
+ * borrowed, not copied, if m_borrow is set, and so are compressed data.
+ * The input must be neither read from nor destroyed while the stream is
+ * in use. Compressed data are inflated lazily, keeping only about
+ * m_window bytes of the result, if m_window is not 0; seeking back
+ * beyond them inflates the whole block. Compressed data found in
+ * m_cache are not inflated at all, and data inflated in one piece are
+ * stored in it. With m_background, the data are inflated ahead in a
+ * separate thread, if there are threads, and kept whole unless m_window
+ * is set too.
+ */
+struct FHInternalStreamOptions
+{
+  bool m_compressed;
+  bool m_borrow;
+  unsigned long m_window;
+  FHInflateCache *m_cache;
+  bool m_background;
+  FHInternalStreamOptions()
+    : m_compressed(false), m_borrow(false), m_window(0), m_cache(nullptr), m_background(false) {}
+};
+
+class FHInternalStream final : public librevenge::RVNGInputStream
 {
 public:
-  FHInternalStream(librevenge::RVNGInputStream *input, unsigned long size, bool compressed=false);
-  ~FHInternalStream() override {}
+  FHInternalStream(librevenge::RVNGInputStream *input, unsigned long size, const FHInternalStreamOptions &options=FHInternalStreamOptions());
+  // Reads data owned by someone else, which must outlive the stream.
+  FHInternalStream(const unsigned char *data, unsigned long size);
+  ~FHInternalStream() override;
   bool isStructured() override
   {
     return false;
@@ -51,18 +86,162 @@ public:
   int seek(long offset, librevenge::RVNG_SEEK_TYPE seekType) override;
   long tell() override;
   bool isEnd() override;
-  unsigned long getSize() const
+  unsigned long getSize();
+  unsigned long getRemainingLength()
+  {
+    const unsigned long size = getSize();
+    const unsigned long offset = (unsigned long)tell();
+    return size > offset ? size - offset : 0;
+  }
+  /* Returns the remaining length, but at most limit. That does not need
+   * to inflate more than limit bytes ahead.
+   */
+  unsigned long getRemainingLength(unsigned long limit)
+  {
+    return std::min(cursor(limit).getRemaining(), limit);
+  }
+
+  /* Faster variants of the functions in libfreehand_utils.h, for the
+   * readers in FHParser. Instead of throwing EndOfStreamException, they
+   * return 0 and set a failure flag, which stays set until cleared.
+   */
+  bool hasFailed() const
+  {
+    return m_damaged || m_cursor.hasFailed();
+  }
+  void clearFailure()
+  {
+    m_cursor.clearFailure();
+  }
+  uint8_t readU8()
+  {
+    return cursor(1).readU8();
+  }
+  uint16_t readU16()
+  {
+    return cursor(2).readU16();
+  }
+  uint32_t readU32()
+  {
+    return cursor(4).readU32();
+  }
+  double readCoordinate()
+  {
+    return cursor(4).readCoordinate();
+  }
+  unsigned readRecordId()
+  {
+    if (m_cursor.getRemaining() >= 4)
+      return m_cursor.readRecordId();
+    const unsigned recid = readU16();
+    return recid == 0xffff ? 0x1ff00 - readU16() : recid;
+  }
+  void readU16Array(uint16_t *out, unsigned long count)
+  {
+    cursor(2 * count).readU16Array(out, count);
+  }
+  void readS32FixedArray(double *out, unsigned long count)
+  {
+    cursor(4 * count).readS32FixedArray(out, count);
+  }
+  void readRecordIdArray(unsigned *out, unsigned long count)
   {
-    return m_buffer.size();
+    // escaped ids take 4 bytes
+    cursor(4 * count).readRecordIdArray(out, count);
+  }
+  // All of the data, or nullptr if only a window into them is kept
+  const unsigned char *getData(unsigned long &size);
+  // Whether getData will return the data, once they are all read
+  bool keepsAllData() const;
+  /* Whether the compressed data are damaged. Nothing of them can be read
+   * then, as if they were inflated in one piece. The rest of the data may
+   * have to be inflated to find out.
+   */
+  bool isDamaged();
+  // The name of the inflate cache entry of the data, if there is a cache
+  const std::string &getCacheEntryName() const
+  {
+    return m_cacheEntryName;
   }
 
 private:
-  volatile long m_offset;
+  FHBigEndianCursor &cursor(unsigned long length)
+  {
+    if (m_cursor.getRemaining() < length && m_windowed)
+      fill(tell() + length);
+    return m_cursor;
+  }
+
+  void copyFrom(librevenge::RVNGInputStream *input, const unsigned char *data, unsigned long numBytes, unsigned long size);
+  void inflateAll(const unsigned char *data, unsigned long size);
+  void fill(unsigned long end);
+  void materialize();
+  void setDamaged();
+  void moveTo(unsigned long offset);
+
+  // the data (or the window into them) and the position in them
+  FHBigEndianCursor m_cursor;
   std::vector<unsigned char> m_buffer;
+  std::unique_ptr<FHInflateCacheEntry> m_cacheEntry;
+  std::string m_cacheEntryName;
+
+  // windowed inflate
+  bool m_windowed;
+  std::unique_ptr<FHInflater> m_inflater;
+  const unsigned char *m_compressed;
+  unsigned long m_compressedSize;
+  std::vector<unsigned char> m_compressedBuffer;
+  unsigned long m_window;
+  unsigned long m_base;
+  long m_totalSize;
+  // an offset beyond the window, which has not been inflated yet
+  long m_pending;
+  bool m_damaged;
+
   FHInternalStream(const FHInternalStream &);
   FHInternalStream &operator=(const FHInternalStream &);
 };
 
+inline uint8_t readU8(FHInternalStream *input)
+{
+  return input->readU8();
+}
+
+inline uint16_t readU16(FHInternalStream *input)
+{
+  return input->readU16();
+}
+
+inline uint32_t readU32(FHInternalStream *input)
+{
+  return input->readU32();
+}
+
+inline int8_t readS8(FHInternalStream *input)
+{
+  return (int8_t)input->readU8();
+}
+
+inline int16_t readS16(FHInternalStream *input)
+{
+  return (int16_t)input->readU16();
+}
+
+inline int32_t readS32(FHInternalStream *input)
+{
+  return (int32_t)input->readU32();
+}
+
+inline unsigned long getRemainingLength(FHInternalStream *input)
+{
+  return input->getRemainingLength();
+}
+
+inline unsigned long getRemainingLength(FHInternalStream *input, unsigned long limit)
+{
+  return input->getRemainingLength(limit);
+}
+
 } // namespace libfreehand
 
 #endif
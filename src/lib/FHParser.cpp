@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string.h>
@@ -19,48 +20,141 @@
 #include "FHCollector.h"
 #include "FHColorProfiles.h"
 #include "FHConstants.h"
+#include "FHInflateCache.h"
 #include "FHInternalStream.h"
 #include "FHParser.h"
+#include "FHRecordGraph.h"
+#include "FHRecordIndex.h"
 #include "libfreehand_utils.h"
 #include "tokens.h"
 
+// config.h, which says if there are threads, comes with libfreehand_utils.h
+#ifdef HAVE_PTHREAD
+#include <system_error>
+#include <thread>
+#endif
+
 
 namespace
 {
 
 #include "tokenhash.h"
 
+static_assert(FH_TOKEN_COUNT <= 0x100, "token slots do not fit in unsigned char");
+
+constexpr unsigned foldTokenHash(unsigned hash)
+{
+  return (hash ^ (hash >> 16)) & ((1u << FH_TOKEN_HASH_BITS) - 1);
+}
+
+// FNV-1a, seeded so that tokenSlots is a perfect hash of the token names.
+// It must be kept in sync with hash_token in gentoken.pl.
+constexpr unsigned hashTokenName(const char *name, unsigned hash = 2166136261u ^ FH_TOKEN_HASH_SEED)
+{
+  return *name ? hashTokenName(name + 1, ((hash ^ (unsigned char)*name) * 16777619u) & 0xffffffffu) : foldTokenHash(hash);
+}
+
+constexpr bool areTokenSlotsValid(int token = 1)
+{
+  return token == FH_TOKEN_COUNT || (tokenSlots[hashTokenName(tokenNames[token])] == token && areTokenSlotsValid(token + 1));
+}
+
+static_assert(areTokenSlotsValid(), "tokenhash.h does not match hashTokenName");
+
 static int getTokenId(const char *name)
 {
-  const fhtoken *token = Perfect_Hash::in_word_set(name, strlen(name));
-  if (token)
-    return token->tokenId;
-  else
-    return FH_TOKEN_INVALID;
+  const int token = tokenSlots[hashTokenName(name)];
+  if (token && !strcmp(tokenNames[token], name))
+    return token;
+  return FH_TOKEN_INVALID;
 }
 
-#ifdef DEBUG
-const char *getTokenName(int tokenId)
+// Nothing refers to blocks and names, they are found by what they are,
+// and VMpObj records add to the page bounds, which are the parser's own.
+// So they are decoded in order even if the other records are not.
+bool isDecodedInOrder(int token)
 {
-  if (tokenId >= FH_TOKEN_COUNT)
-    return nullptr;
-  const fhtoken *currentToken = wordlist;
-  while (currentToken != wordlist+sizeof(wordlist)/sizeof(*wordlist))
+  return token == FH_BLOCK || token == FH_MNAME || token == FH_VMPOBJ;
+}
+
+// Fewer records are not worth another thread
+const unsigned long MIN_RECORDS_PER_THREAD = 1024;
+
+// The fake record after the last one
+const unsigned long TAIL_SIZE = 0x32;
+
+// How far after a damaged record the next one is looked for, and how
+// much is read to check that records start there
+const unsigned long RESYNC_DISTANCE = 0x4000;
+const unsigned long RESYNC_READ_AHEAD = 0x10000;
+// How many records after a damaged one may be damaged too, and how many
+// before it may have been misread
+const unsigned long RESYNC_MAX_SKIPPED = 8;
+// How many records must be read without a problem from where the next
+// record is thought to start
+const unsigned RESYNC_RECORDS = 8;
+
+// The size of a point of a path in the document
+const unsigned long PATH_POINT_SIZE = 27;
+
+// Reads up to count points of a path into coords, as the point and the
+// control points before and after it, and tells how many there were
+unsigned readPathPoints(libfreehand::FHInternalStream *input, unsigned count, std::vector<double> &coords)
+{
+  // A damaged count must not make us allocate much more than there is
+  const unsigned long available = input->getRemainingLength(PATH_POINT_SIZE * count) / PATH_POINT_SIZE + 1;
+  if (count > available)
+    count = unsigned(available);
+  coords.resize(6 * (unsigned long)count);
+  unsigned i = 0;
+  for (; i < count && !input->isEnd(); ++i)
   {
-    if (currentToken->tokenId == tokenId)
-      return currentToken->name;
-    ++currentToken;
+    // the type of the point is not used
+    input->seek(3, librevenge::RVNG_SEEK_CUR);
+    input->readS32FixedArray(&coords[6 * i], 6);
+    if (input->hasFailed())
+      break;
   }
-  return nullptr;
+  return i;
 }
 
+// Joins the points read by readPathPoints by curves
+void appendPathPoints(libfreehand::FHPath &path, const std::vector<double> &coords, unsigned count, bool closed)
+{
+  path.reserve(count + 1);
+  path.appendMoveTo(coords[0] / 72.0, coords[1] / 72.0);
+  const double *point = &coords[0];
+  for (unsigned i = 1; i < count; ++i, point += 6)
+    path.appendCubicBezierTo(point[4] / 72.0, point[5] / 72.0,
+                             point[8] / 72.0, point[9] / 72.0,
+                             point[6] / 72.0, point[7] / 72.0);
+  if (closed)
+  {
+    path.appendCubicBezierTo(point[4] / 72.0, point[5] / 72.0,
+                             coords[2] / 72.0, coords[3] / 72.0,
+                             coords[0] / 72.0, coords[1] / 72.0);
+    path.appendClosePath();
+  }
+}
+
+#ifdef DEBUG
+const char *getTokenName(int token)
+{
+  if (token <= 0 || token >= FH_TOKEN_COUNT)
+    return nullptr;
+  return tokenNames[token];
+}
 #endif
 
 } // anonymous namespace
 
 libfreehand::FHParser::FHParser()
-  : m_input(nullptr), m_collector(nullptr), m_version(-1), m_dictionary(),
-    m_records(), m_currentRecord(0), m_pageInfo(), m_colorTransform(nullptr)
+  : m_input(nullptr), m_collector(nullptr), m_version(-1), m_dictionary(), m_dictionaryEntries(),
+    m_records(), m_currentRecord(0), m_pageInfo(), m_colorTransform(nullptr),
+    m_inflateWindow(0), m_inflateCacheDir(), m_inflateCacheSize(0),
+    m_inflateInBackground(false), m_inputLength(0), m_lazyDecoding(false), m_decodeThreads(1), m_content(CONTENT_ALL),
+    m_skipDamagedRecords(false), m_skippedRecords(0), m_invalidRecordIds(0), m_recordIndex(),
+    m_decodedRecords(), m_lazyInput(nullptr), m_recordGraph(nullptr), m_document(this)
 {
   cmsHPROFILE inProfile  = cmsOpenProfileFromMem(CMYK_icc, sizeof(CMYK_icc)/sizeof(CMYK_icc[0]));
   cmsHPROFILE outProfile = cmsCreate_sRGBProfile();
@@ -71,22 +165,151 @@ libfreehand::FHParser::FHParser()
   cmsCloseProfile(outProfile);
 }
 
+libfreehand::FHParser::FHParser(const FHParser *document)
+  : m_input(nullptr), m_collector(nullptr), m_version(document->m_version), m_dictionary(), m_dictionaryEntries(),
+    m_records(), m_currentRecord(0), m_pageInfo(), m_colorTransform(document->m_colorTransform),
+    m_inflateWindow(0), m_inflateCacheDir(), m_inflateCacheSize(0),
+    m_inflateInBackground(false), m_inputLength(0), m_lazyDecoding(false), m_decodeThreads(1), m_content(document->m_content),
+    m_skipDamagedRecords(document->m_skipDamagedRecords), m_skippedRecords(0), m_invalidRecordIds(0), m_recordIndex(),
+    m_decodedRecords(), m_lazyInput(nullptr), m_recordGraph(nullptr), m_document(document)
+{
+}
+
 libfreehand::FHParser::~FHParser()
 {
-  if (m_colorTransform)
+  if (m_colorTransform && m_document == this)
     cmsDeleteTransform(m_colorTransform);
 }
 
+void libfreehand::FHParser::setInflateWindow(unsigned long size)
+{
+  m_inflateWindow = size;
+}
+
+void libfreehand::FHParser::setInflateCache(const std::string &dir, unsigned long size)
+{
+  m_inflateCacheDir = dir;
+  m_inflateCacheSize = size;
+}
+
+void libfreehand::FHParser::setInflateInBackground(bool background)
+{
+#ifdef HAVE_PTHREAD
+  m_inflateInBackground = background;
+#else
+  // nothing to gain without threads
+  (void)background;
+#endif
+}
+
+void libfreehand::FHParser::setLazyDecoding(bool lazy)
+{
+  m_lazyDecoding = lazy;
+}
+
+void libfreehand::FHParser::setDecodeThreads(unsigned threads)
+{
+  m_decodeThreads = threads;
+}
+
+void libfreehand::FHParser::setContent(Content content)
+{
+  m_content = content;
+}
+
+void libfreehand::FHParser::setSkipDamagedRecords(bool skip)
+{
+  m_skipDamagedRecords = skip;
+}
+
 bool libfreehand::FHParser::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter)
+{
+  std::unique_ptr<FHInflateCache> cache;
+  std::unique_ptr<FHInternalStream> dataStream = openDocument(input, cache);
+  if (!dataStream)
+    return false;
+  FHCollector contentCollector;
+  if (m_lazyDecoding)
+  {
+    if (!parseDocumentLazily(dataStream.get(), &contentCollector, cache.get()))
+      return false;
+  }
+  else if (m_decodeThreads != 1)
+  {
+    if (!parseDocumentInParallel(dataStream.get(), &contentCollector, cache.get()))
+      return false;
+  }
+  else if (!parseDocument(dataStream.get(), &contentCollector))
+    return false;
+  // A window may not have come to the damage yet
+  if (dataStream->isDamaged())
+    return false;
+  unsigned long dataSize = 0;
+  const unsigned char *const data = dataStream->getData(dataSize);
+  contentCollector.setDocumentData(data, dataSize);
+  contentCollector.outputDrawing(painter);
+  contentCollector.setRecordDecoder(nullptr);
+
+  return true;
+}
+
+bool libfreehand::FHParser::buildRecordIndex(librevenge::RVNGInputStream *input, FHRecordIndex &index)
+{
+  std::unique_ptr<FHInflateCache> cache;
+  std::unique_ptr<FHInternalStream> dataStream = openDocument(input, cache);
+  if (!dataStream)
+    return false;
+  return getRecordIndex(dataStream.get(), cache.get(), index) && !dataStream->isDamaged();
+}
+
+bool libfreehand::FHParser::buildDecodedRecordIndex(librevenge::RVNGInputStream *input, FHRecordIndex &index)
+{
+  std::unique_ptr<FHInflateCache> cache;
+  std::unique_ptr<FHInternalStream> dataStream = openDocument(input, cache);
+  if (!dataStream)
+    return false;
+  FHCollector collector;
+  return indexRecords(dataStream.get(), index, &collector) && !dataStream->isDamaged();
+}
+
+bool libfreehand::FHParser::buildRecordGraph(librevenge::RVNGInputStream *input, FHRecordGraph &graph)
+{
+  graph.clear();
+  std::unique_ptr<FHInflateCache> cache;
+  std::unique_ptr<FHInternalStream> dataStream = openDocument(input, cache);
+  if (!dataStream)
+    return false;
+
+  // Indexing reads every record that refers to others
+  graph.reset(unsigned(m_records.size()));
+  m_recordGraph = &graph;
+  FHRecordIndex index;
+  const bool indexed = indexRecords(dataStream.get(), index, nullptr);
+  if (indexed)
+  {
+    for (FHRecordIndex::const_iterator it = index.begin(); it != index.end(); ++it)
+      graph.setRecordSize(it->m_record, it->m_length);
+    dataStream->seek((long)index.getTailOffset(), librevenge::RVNG_SEEK_SET);
+    m_currentRecord = m_records.size();
+    graph.startTail();
+    readFHTail(dataStream.get(), nullptr);
+  }
+  m_recordGraph = nullptr;
+  graph.finish();
+  return indexed && !dataStream->isDamaged();
+}
+
+std::unique_ptr<libfreehand::FHInternalStream> libfreehand::FHParser::openDocument(librevenge::RVNGInputStream *input, std::unique_ptr<FHInflateCache> &cache)
 {
   long dataOffset = input->tell();
+  m_inputLength = getLength(input);
   unsigned agd = readU32(input);
   if (((agd >> 24) & 0xff) == 'A' && ((agd >> 16) & 0xff) == 'G' && ((agd >> 8) & 0xff) == 'D')
     m_version = (agd & 0xff) - 0x30 + 5;
   else if (((agd >> 24) & 0xff) == 'F' && ((agd >> 16) & 0xff) == 'H' && ((agd >> 8) & 0xff) == '3')
     m_version = 3;
   else
-    return false;
+    return std::unique_ptr<FHInternalStream>();
 
   // Skip a dword
   input->seek(4, librevenge::RVNG_SEEK_CUR);
@@ -100,13 +323,18 @@ bool libfreehand::FHParser::parse(librevenge::RVNGInputStream *input, librevenge
 
   input->seek(dataOffset+12, librevenge::RVNG_SEEK_SET);
 
-  FHInternalStream dataStream(input, dataLength-12, m_version >= 9);
-  dataStream.seek(0, librevenge::RVNG_SEEK_SET);
-  FHCollector contentCollector;
-  parseDocument(&dataStream, &contentCollector);
-  contentCollector.outputDrawing(painter);
-
-  return true;
+  // input is not used any more, so uncompressed data need not be copied
+  if (m_version >= 9 && !m_inflateCacheDir.empty())
+    cache.reset(new FHInflateCache(m_inflateCacheDir, m_inflateCacheSize));
+  FHInternalStreamOptions options;
+  options.m_compressed = m_version >= 9;
+  options.m_borrow = true;
+  options.m_window = m_inflateWindow;
+  options.m_cache = cache.get();
+  options.m_background = m_inflateInBackground;
+  std::unique_ptr<FHInternalStream> dataStream(new FHInternalStream(input, dataLength-12, options));
+  dataStream->seek(0, librevenge::RVNG_SEEK_SET);
+  return dataStream;
 }
 
 void libfreehand::FHParser::parseDictionary(librevenge::RVNGInputStream *input)
@@ -114,6 +342,10 @@ void libfreehand::FHParser::parseDictionary(librevenge::RVNGInputStream *input)
   unsigned count = readU16(input);
   FH_DEBUG_MSG(("FHParser::parseDictionary - count 0x%x\n", count));
   input->seek(2, librevenge::RVNG_SEEK_CUR);
+  // Record types are 16 bit, so they index the dictionary directly.
+  m_dictionary.assign(0x10000, 0);
+  const VersionFamily family = getVersionFamily(m_version);
+  m_dictionaryEntries.assign(1, DictionaryEntry(FH_TOKEN_INVALID, nullptr, nullptr, nullptr, false));
   for (unsigned i = 0; i < count; ++i)
   {
     unsigned short id = readU16(input);
@@ -137,15 +369,23 @@ void libfreehand::FHParser::parseDictionary(librevenge::RVNGInputStream *input)
       }
     }
 
-    m_dictionary[id] = nameToken;
+    const RecordType *type = getRecordType(nameToken);
+    const DictionaryEntry entry(nameToken, type, type ? type->m_readers[family] : nullptr, getRecordLayout(nameToken, m_version), isSkipped(type));
+    if (m_dictionary[id])
+      m_dictionaryEntries[m_dictionary[id]] = entry;
+    else
+    {
+      m_dictionary[id] = (unsigned short)m_dictionaryEntries.size();
+      m_dictionaryEntries.push_back(entry);
+    }
   }
 }
 
 void libfreehand::FHParser::parseRecordList(librevenge::RVNGInputStream *input)
 {
   unsigned count = readU32(input);
-  if (count > getRemainingLength(input) / 2)
-    count = getRemainingLength(input) / 2;
+  if (count > getRemainingLength(input, m_inputLength) / 2)
+    count = getRemainingLength(input, m_inputLength) / 2;
   for (unsigned i = 0; i < count; ++i)
   {
     unsigned id = readU16(input);
@@ -154,399 +394,151 @@ void libfreehand::FHParser::parseRecordList(librevenge::RVNGInputStream *input)
   }
 }
 
-void libfreehand::FHParser::parseRecord(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector, int recordId)
-{
-  FH_DEBUG_MSG(("Parsing record number 0x%x: %s Offset 0x%lx\n", (unsigned)m_currentRecord+1, getTokenName(recordId), input->tell()));
-  switch (recordId)
-  {
-  case FH_AGDFONT:
-    readAGDFont(input, collector);
-    break;
-  case FH_AGDSELECTION:
-    readAGDSelection(input, collector);
-    break;
-  case FH_ARROWPATH:
-    readArrowPath(input, collector);
-    break;
-  case FH_ATTRIBUTEHOLDER:
-    readAttributeHolder(input, collector);
-    break;
-  case FH_BASICFILL:
-    readBasicFill(input, collector);
-    break;
-  case FH_BASICLINE:
-    readBasicLine(input, collector);
-    break;
-  case FH_BENDFILTER:
-    readBendFilter(input, collector);
-    break;
-  case FH_BLENDOBJECT:
-    readBlendObject(input, collector);
-    break;
-  case FH_BLOCK:
-    readBlock(input, collector);
-    break;
-  case FH_BRUSHLIST:
-    readList(input, collector);
-    break;
-  case FH_BRUSH:
-    readBrush(input, collector);
-    break;
-  case FH_BRUSHSTROKE:
-    readBrushStroke(input, collector);
-    break;
-  case FH_BRUSHTIP:
-    readBrushTip(input, collector);
-    break;
-  case FH_CALLIGRAPHICSTROKE:
-    readCalligraphicStroke(input, collector);
-    break;
-  case FH_CHARACTERFILL:
-    readCharacterFill(input, collector);
-    break;
-  case FH_CLIPGROUP:
-    readClipGroup(input, collector);
-    break;
-  case FH_COLLECTOR:
-    readCollector(input, collector);
-    break;
-  case FH_COLOR6:
-    readColor6(input, collector);
-    break;
-  case FH_COMPOSITEPATH:
-    readCompositePath(input, collector);
-    break;
-  case FH_CONEFILL:
-    readConeFill(input, collector);
-    break;
-  case FH_CONNECTORLINE:
-    readConnectorLine(input, collector);
-    break;
-  case FH_CONTENTFILL:
-    readContentFill(input, collector);
-    break;
-  case FH_CONTOURFILL:
-    readContourFill(input, collector);
-    break;
-  case FH_CUSTOMPROC:
-    readCustomProc(input, collector);
-    break;
-  case FH_DATALIST:
-    readDataList(input, collector);
-    break;
-  case FH_DATA:
-    readData(input, collector);
-    break;
-  case FH_DATETIME:
-    readDateTime(input, collector);
-    break;
-  case FH_DISPLAYTEXT:
-    readDisplayText(input, collector);
-    break;
-  case FH_DUETFILTER:
-    readDuetFilter(input, collector);
-    break;
-  case FH_ELEMENT:
-    readElement(input, collector);
-    break;
-  case FH_ELEMLIST:
-    readElemList(input, collector);
-    break;
-  case FH_ELEMPROPLST:
-    readElemPropLst(input, collector);
-    break;
-  case FH_ENVELOPE:
-    readEnvelope(input, collector);
-    break;
-  case FH_EPSIMPORT:
-    readEPSImport(input, collector);
-    break;
-  case FH_EXPANDFILTER:
-    readExpandFilter(input, collector);
-    break;
-  case FH_EXTRUSION:
-    readExtrusion(input, collector);
-    break;
-  case FH_FHDOCHEADER:
-    readFHDocHeader(input, collector);
-    break;
-  case FH_FIGURE:
-    readFigure(input, collector);
-    break;
-  case FH_FILEDESCRIPTOR:
-    readFileDescriptor(input, collector);
-    break;
-  case FH_FILTERATTRIBUTEHOLDER:
-    readFilterAttributeHolder(input, collector);
-    break;
-  case FH_FWBEVELFILTER:
-    readFWBevelFilter(input, collector);
-    break;
-  case FH_FWBLURFILTER:
-    readFWBlurFilter(input, collector);
-    break;
-  case FH_FWFEATHERFILTER:
-    readFWFeatherFilter(input, collector);
-    break;
-  case FH_FWGLOWFILTER:
-    readFWGlowFilter(input, collector);
-    break;
-  case FH_FWSHADOWFILTER:
-    readFWShadowFilter(input, collector);
-    break;
-  case FH_FWSHARPENFILTER:
-    readFWSharpenFilter(input, collector);
-    break;
-  case FH_GRADIENTMASKFILTER:
-    readGradientMaskFilter(input, collector);
-    break;
-  case FH_GRAPHICSTYLE:
-    readGraphicStyle(input, collector);
-    break;
-  case FH_GROUP:
-    readGroup(input, collector);
-    break;
-  case FH_GUIDES:
-    readGuides(input, collector);
-    break;
-  case FH_HALFTONE:
-    readHalftone(input, collector);
-    break;
-  case FH_IMAGEFILL:
-    readImageFill(input, collector);
-    break;
-  case FH_IMAGEIMPORT:
-    readImageImport(input, collector);
-    break;
-  case FH_IMPORT:
-    readImport(input, collector);
-    break;
-  case FH_LAYER:
-    readLayer(input, collector);
-    break;
-  case FH_LENSFILL:
-    readLensFill(input, collector);
-    break;
-  case FH_LINEARFILL:
-    readLinearFill(input, collector);
-    break;
-  case FH_LINEPAT:
-    readLinePat(input, collector);
-    break;
-  case FH_LINETABLE:
-    readLineTable(input, collector);
-    break;
-  case FH_LIST:
-    readList(input, collector);
-    break;
-  case FH_MASTERPAGEDOCMAN:
-    readMasterPageDocMan(input, collector);
-    break;
-  case FH_MASTERPAGEELEMENT:
-    readMasterPageElement(input, collector);
-    break;
-  case FH_MASTERPAGELAYERELEMENT:
-    readMasterPageLayerElement(input, collector);
-    break;
-  case FH_MASTERPAGELAYERINSTANCE:
-    readMasterPageLayerInstance(input, collector);
-    break;
-  case FH_MASTERPAGESYMBOLCLASS:
-    readMasterPageSymbolClass(input, collector);
-    break;
-  case FH_MASTERPAGESYMBOLINSTANCE:
-    readMasterPageSymbolInstance(input, collector);
-    break;
-  case FH_MDICT:
-    readMDict(input, collector);
-    break;
-  case FH_MLIST:
-    readList(input, collector);
-    break;
-  case FH_MNAME:
-    readMName(input, collector);
-    break;
-  case FH_MPOBJECT:
-    readMpObject(input, collector);
-    break;
-  case FH_MQUICKDICT:
-    readMQuickDict(input, collector);
-    break;
-  case FH_MSTRING:
-    readMString(input, collector);
-    break;
-  case FH_MULTIBLEND:
-    readMultiBlend(input, collector);
-    break;
-  case FH_MULTICOLORLIST:
-    readMultiColorList(input, collector);
-    break;
-  case FH_NEWBLEND:
-    readNewBlend(input, collector);
-    break;
-  case FH_NEWCONTOURFILL:
-    readNewContourFill(input, collector);
-    break;
-  case FH_NEWRADIALFILL:
-    readNewRadialFill(input, collector);
-    break;
-  case FH_OPACITYFILTER:
-    readOpacityFilter(input, collector);
-    break;
-  case FH_OVAL:
-    readOval(input, collector);
-    break;
-  case FH_PANTONECOLOR:
-    readPantoneColor(input, collector);
-    break;
-  case FH_PARAGRAPH:
-    readParagraph(input, collector);
-    break;
-  case FH_PATH:
-    readPath(input, collector);
-    break;
-  case FH_PATHTEXT:
-    readPathText(input, collector);
-    break;
-  case FH_PATHTEXTLINEINFO:
-    readPathTextLineInfo(input, collector);
-    break;
-  case FH_PATTERNFILL:
-    readPatternFill(input, collector);
-    break;
-  case FH_PATTERNLINE:
-    readPatternLine(input, collector);
-    break;
-  case FH_PERSPECTIVEENVELOPE:
-    readPerspectiveEnvelope(input, collector);
-    break;
-  case FH_PERSPECTIVEGRID:
-    readPerspectiveGrid(input, collector);
-    break;
-  case FH_POLYGONFIGURE:
-    readPolygonFigure(input, collector);
-    break;
-  case FH_PROCEDURE:
-    readProcedure(input, collector);
-    break;
-  case FH_PROCESSCOLOR:
-    readProcessColor(input, collector);
-    break;
-  case FH_PROPLST:
-    readPropLst(input, collector);
-    break;
-  case FH_PSFILL:
-    readPSFill(input, collector);
-    break;
-  case FH_PSLINE:
-    readPSLine(input, collector);
-    break;
-  case FH_RADIALFILL:
-    readRadialFill(input, collector);
-    break;
-  case FH_RADIALFILLX:
-    readRadialFillX(input, collector);
-    break;
-  case FH_RAGGEDFILTER:
-    readRaggedFilter(input, collector);
-    break;
-  case FH_RECTANGLE:
-    readRectangle(input, collector);
-    break;
-  case FH_SKETCHFILTER:
-    readSketchFilter(input, collector);
-    break;
-  case FH_SPOTCOLOR:
-    readSpotColor(input, collector);
-    break;
-  case FH_SPOTCOLOR6:
-    readSpotColor6(input, collector);
-    break;
-  case FH_STYLEPROPLST:
-    readStylePropLst(input, collector);
-    break;
-  case FH_SWFIMPORT:
-    readSwfImport(input, collector);
-    break;
-  case FH_SYMBOLCLASS:
-    readSymbolClass(input, collector);
-    break;
-  case FH_SYMBOLINSTANCE:
-    readSymbolInstance(input, collector);
-    break;
-  case FH_SYMBOLLIBRARY:
-    readSymbolLibrary(input, collector);
-    break;
-  case FH_TABTABLE:
-    readTabTable(input, collector);
-    break;
-  case FH_TAPEREDFILL:
-    readTaperedFill(input, collector);
-    break;
-  case FH_TAPEREDFILLX:
-    readTaperedFillX(input, collector);
-    break;
-  case FH_TEFFECT:
-    readTEffect(input, collector);
-    break;
-  case FH_TEXTBLOK:
-    readTextBlok(input, collector);
-    break;
-  case FH_TEXTCOLUMN:
-  case FH_TEXTINPATH:
-  case FH_TFONPATH:
-    readTextObject(input, collector);
-    break;
-  case FH_TEXTEFFS:
-    readTextEffs(input, collector);
-    break;
-  case FH_TILEFILL:
-    readTileFill(input, collector);
-    break;
-  case FH_TINTCOLOR:
-    readTintColor(input, collector);
-    break;
-  case FH_TINTCOLOR6:
-    readTintColor6(input, collector);
-    break;
-  case FH_TRANSFORMFILTER:
-    readTransformFilter(input, collector);
-    break;
-  case FH_TSTRING:
-    readTString(input, collector);
-    break;
-  case FH_USTRING:
-    readUString(input, collector);
-    break;
-  case FH_VDICT:
-    readVDict(input, collector);
-    break;
-  case FH_VMPOBJ:
-    readVMpObj(input, collector);
-    break;
-  case FH_XFORM:
-    readXform(input, collector);
-    break;
+const libfreehand::FHParser::RecordType *libfreehand::FHParser::getRecordType(int token)
+{
+  static constexpr RecordType recordTypes[] =
+  {
+#include "recordtypes.h"
+  };
+  static_assert(sizeof(recordTypes) / sizeof(recordTypes[0]) == FH_TOKEN_COUNT, "record type table does not match tokens");
+
+  if (token <= 0 || token >= FH_TOKEN_COUNT)
+    return nullptr;
+  return &recordTypes[token];
+}
+
+const libfreehand::FHParser::LayoutStep *libfreehand::FHParser::getRecordLayout(int token, int version)
+{
+#include "recordlayouts.h"
+
+  if (token <= 0 || token >= FH_TOKEN_COUNT)
+    return nullptr;
+  if (version < FH_LAYOUT_MIN_VERSION)
+    version = FH_LAYOUT_MIN_VERSION;
+  else if (version > FH_LAYOUT_MAX_VERSION)
+    version = FH_LAYOUT_MAX_VERSION;
+  const unsigned short start = recordLayouts[version - FH_LAYOUT_MIN_VERSION][token];
+  return start ? &layoutSteps[start] : nullptr;
+}
+
+long libfreehand::FHParser::getLayoutSize(const LayoutStep *layout)
+{
+  if (!layout)
+    return -1;
+  if (layout[0].m_op == LAYOUT_END)
+    return 0;
+  if (layout[0].m_op == LAYOUT_BYTES && !layout[0].m_count && layout[1].m_op == LAYOUT_END)
+    return layout[0].m_size;
+  return -1;
+}
+
+libfreehand::FHParser::VersionFamily libfreehand::FHParser::getVersionFamily(int version)
+{
+  if (version <= 3)
+    return FAMILY_FH3;
+  if (version <= 8)
+    return FAMILY_FH5;
+  if (version <= 10)
+    return FAMILY_FH9;
+  return FAMILY_FH11;
+}
+
+bool libfreehand::FHParser::isSkipped(const RecordType *type) const
+{
+  if (!type)
+    return false;
+  switch (m_content)
+  {
+  case CONTENT_NO_IMAGES:
+    return type->m_flags & RECORD_IMAGE;
+  case CONTENT_PAGES:
+    return !(type->m_flags & RECORD_PAGE);
   default:
+    return false;
+  }
+}
+
+void libfreehand::FHParser::parseRecord(FHInternalStream *input, libfreehand::FHCollector *collector, const DictionaryEntry &entry)
+{
+  FH_DEBUG_MSG(("Parsing record number 0x%x: %s Offset 0x%lx\n", (unsigned)m_currentRecord+1, getTokenName(entry.m_token), input->tell()));
+  if (!entry.m_type)
+  {
     FH_DEBUG_MSG(("FHParser::parseRecords UNKNOWN TOKEN\n"));
     return;
   }
+  if (entry.m_layout && (!entry.m_reader || !collector || entry.m_skipped))
+    skipRecord(input, entry.m_layout);
+  else
+    (this->*entry.m_reader)(input, entry.m_skipped ? nullptr : collector);
+}
 
+void libfreehand::FHParser::skipRecord(FHInternalStream *input, const LayoutStep *layout)
+{
+  // the counts read so far; steps without a count are done once
+  unsigned long counts[3] = { 1, 0, 0 };
+  for (const LayoutStep *step = layout; step->m_op != LAYOUT_END; ++step)
+  {
+    const unsigned long count = counts[step->m_count] * step->m_size;
+    switch (step->m_op)
+    {
+    case LAYOUT_BYTES:
+      input->seek((long)count, librevenge::RVNG_SEEK_CUR);
+      break;
+    case LAYOUT_IDS:
+      for (unsigned long i = 0; i < count && !input->hasFailed(); ++i)
+        _readRecordId(input);
+      break;
+    case LAYOUT_COUNT:
+      counts[step->m_count] = readU16(input);
+      break;
+    case LAYOUT_XFORM:
+    {
+      unsigned char var1 = readU8(input);
+      unsigned char var2 = readU8(input);
+      input->seek(_xformCalc(var1, var2) + 2, librevenge::RVNG_SEEK_CUR);
+      break;
+    }
+    default:
+      break;
+    }
+  }
 }
 
-void libfreehand::FHParser::parseRecords(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+bool libfreehand::FHParser::parseRecords(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
+  m_skippedRecords = 0;
   for (m_currentRecord = 0; m_currentRecord < m_records.size() && !input->isEnd(); ++m_currentRecord)
   {
-    std::map<unsigned short, int>::const_iterator iterDict = m_dictionary.find(m_records[m_currentRecord]);
-    if (iterDict != m_dictionary.end())
+    const unsigned short index = m_dictionary.empty() ? 0 : m_dictionary[m_records[m_currentRecord]];
+    if (index)
     {
-      if (iterDict->second == FH_TOKEN_INVALID)
+      const DictionaryEntry &entry = m_dictionaryEntries[index];
+      const unsigned long offset = (unsigned long)input->tell();
+      if (entry.m_token == FH_TOKEN_INVALID)
       {
         FH_DEBUG_MSG(("FHParser::parseRecords UNKNOWN TOKEN\n"));
-        return;
+        if (!m_skipDamagedRecords)
+          return true;
       }
-      parseRecord(input, collector, iterDict->second);
+      else
+      {
+        m_invalidRecordIds = 0;
+        parseRecord(input, collector, entry);
+        // The tail comes after the last record, so the data cannot end
+        // here. A record that refers to no record or ends before it
+        // starts is damaged too, but that is only worth noticing if it
+        // can be skipped.
+        if (!input->hasFailed() && !input->isEnd() && (!m_skipDamagedRecords || (!m_invalidRecordIds && (unsigned long)input->tell() >= offset)))
+          continue;
+        FH_DEBUG_MSG(("FHParser::parseRecords record %u is damaged\n", unsigned(m_currentRecord)));
+        if (!m_skipDamagedRecords)
+          return false;
+        if (collector)
+          collector->removeRecord(unsigned(m_currentRecord + 1));
+      }
+      // The document is drawn as far as it could be read
+      if (!skipDamagedRecords(input, offset))
+        return true;
     }
     else
     {
@@ -554,15 +546,391 @@ void libfreehand::FHParser::parseRecords(librevenge::RVNGInputStream *input, lib
     }
   }
   readFHTail(input, collector);
+  return m_skipDamagedRecords || !input->hasFailed();
+}
+
+bool libfreehand::FHParser::skipDamagedRecords(FHInternalStream *input, unsigned long offset)
+{
+  // The record at offset is damaged, and so may be some after it. Where
+  // the first good one starts, it and the records after it can be read
+  // without a problem, which is unlikely to happen anywhere else. Records
+  // before it may have been misread from garbage, so they are looked for
+  // too, but the ones after it first.
+  const std::vector<unsigned short>::size_type damaged = m_currentRecord;
+  const std::vector<unsigned short>::size_type first = damaged > RESYNC_MAX_SKIPPED ? damaged - RESYNC_MAX_SKIPPED : 0;
+  const std::vector<unsigned short>::size_type last = std::min<std::vector<unsigned short>::size_type>(damaged + RESYNC_MAX_SKIPPED, m_records.size() - 1);
+
+  // Whether records can be read from some place depends only on their
+  // types. So of the records that start the same run of types, only the
+  // first one needs to be tried.
+  std::vector<std::vector<unsigned short>::size_type> candidates;
+  std::set<std::vector<unsigned short> > runs;
+  auto addCandidate = [&](std::vector<unsigned short>::size_type record)
+  {
+    std::vector<unsigned short> run;
+    for (std::vector<unsigned short>::size_type i = record; i < m_records.size() && run.size() < RESYNC_RECORDS; ++i)
+    {
+      if (m_dictionary[m_records[i]])
+        run.push_back(m_dictionary[m_records[i]]);
+    }
+    if (m_dictionary[m_records[record]] && runs.insert(run).second)
+      candidates.push_back(record);
+  };
+  for (std::vector<unsigned short>::size_type record = damaged + 1; record <= last; ++record)
+    addCandidate(record);
+  for (std::vector<unsigned short>::size_type record = damaged + 1; record > first; --record)
+    addCandidate(record - 1);
+
+  const FHPageInfo pageInfo = m_pageInfo;
+  FHRecordGraph *const recordGraph = m_recordGraph;
+  m_recordGraph = nullptr;
+  input->clearFailure();
+  input->seek((long)offset, librevenge::RVNG_SEEK_SET);
+  unsigned long size = 0;
+  const unsigned char *const data = input->read(RESYNC_READ_AHEAD, size);
+  // the tail follows the records, so they cannot end with the data
+  const bool atEnd = size < RESYNC_READ_AHEAD;
+
+  std::vector<unsigned short>::size_type next = m_records.size();
+  unsigned long start = 1;
+  // for each type, whether a record of it can be read from start
+  std::vector<signed char> readable;
+  for (; start < std::min(size, RESYNC_DISTANCE); ++start)
+  {
+    readable.assign(m_dictionaryEntries.size(), -1);
+    for (std::vector<std::vector<unsigned short>::size_type>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+    {
+      signed char &firstReadable = readable[m_dictionary[m_records[*it]]];
+      if (firstReadable < 0)
+        firstReadable = isRecordStart(data, size, start, atEnd, *it, 1);
+      if (firstReadable && isRecordStart(data, size, start, atEnd, *it, RESYNC_RECORDS))
+      {
+        next = *it;
+        break;
+      }
+    }
+    if (next != m_records.size())
+      break;
+  }
+  m_pageInfo = pageInfo;
+  m_recordGraph = recordGraph;
+  for (std::vector<unsigned short>::size_type record = damaged; record < next; ++record)
+  {
+    if (m_dictionary[m_records[record]])
+      ++m_skippedRecords;
+  }
+  if (next == m_records.size())
+  {
+    FH_DEBUG_MSG(("FHParser::skipDamagedRecords - no record found after record %u\n", unsigned(damaged)));
+    m_currentRecord = next;
+    return false;
+  }
+
+  FH_DEBUG_MSG(("FHParser::skipDamagedRecords - going on with record %u at 0x%lx\n", unsigned(next), offset + start));
+  input->seek(long(offset + start), librevenge::RVNG_SEEK_SET);
+  // The caller's loop goes on with the record after the current one.
+  // That wraps around if it is the first record.
+  m_currentRecord = next - 1;
+  return true;
+}
+
+bool libfreehand::FHParser::isRecordStart(const unsigned char *data, unsigned long size, unsigned long start, bool atEnd, std::vector<unsigned short>::size_type record, unsigned count)
+{
+  // The data before start are kept, so that a record that goes back
+  // before it is noticed.
+  FHInternalStream input(data, size);
+  input.seek(long(start), librevenge::RVNG_SEEK_SET);
+  m_invalidRecordIds = 0;
+  unsigned read = 0;
+  for (m_currentRecord = record; m_currentRecord < m_records.size() && read < count; ++m_currentRecord)
+  {
+    const unsigned short entryIndex = m_dictionary[m_records[m_currentRecord]];
+    if (!entryIndex)
+      continue;
+    const DictionaryEntry &entry = m_dictionaryEntries[entryIndex];
+    const long recordStart = input.tell();
+    if (entry.m_token == FH_TOKEN_INVALID || input.isEnd())
+      return false;
+    parseRecord(&input, nullptr, entry);
+    if (input.hasFailed() || m_invalidRecordIds || input.tell() < recordStart || (atEnd && input.isEnd()))
+      return false;
+    ++read;
+  }
+  // the last record is followed by the tail
+  return read == count || input.getRemainingLength() >= TAIL_SIZE;
 }
 
-void libfreehand::FHParser::parseDocument(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+bool libfreehand::FHParser::parseDocument(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
-  parseRecords(input, collector);
+  if (!parseRecords(input, collector))
+    return false;
+  collector->collectPageInfo(m_pageInfo);
+  return true;
+}
+
+bool libfreehand::FHParser::parseDocumentLazily(FHInternalStream *input, libfreehand::FHCollector *collector, FHInflateCache *cache)
+{
+  if (!getRecordIndex(input, cache, m_recordIndex))
+  {
+    // Let the usual parse deal with whatever is wrong with the records
+    FH_DEBUG_MSG(("FHParser::parseDocumentLazily - cannot index the records\n"));
+    input->clearFailure();
+    input->seek(0, librevenge::RVNG_SEEK_SET);
+    return parseDocument(input, collector);
+  }
+
+  m_lazyInput = input;
+  m_collector = collector;
+  m_decodedRecords.assign(m_records.size(), false);
+
+  for (FHRecordIndex::const_iterator it = m_recordIndex.begin(); it != m_recordIndex.end(); ++it)
+  {
+    if (isDecodedInOrder(it->m_token))
+      decodeRecord(it->m_record);
+  }
+
+  input->seek((long)m_recordIndex.getTailOffset(), librevenge::RVNG_SEEK_SET);
+  m_currentRecord = m_records.size();
+  readFHTail(input, collector);
+  if (input->hasFailed() && !m_skipDamagedRecords)
+    return false;
+  collector->collectPageInfo(m_pageInfo);
+  collector->setRecordDecoder(this);
+  return true;
+}
+
+void libfreehand::FHParser::decodeRecord(unsigned recordId)
+{
+  if (!recordId || recordId > m_decodedRecords.size() || m_decodedRecords[recordId - 1])
+    return;
+  m_decodedRecords[recordId - 1] = true;
+
+  const FHRecordIndexEntry *const indexEntry = m_recordIndex.find(recordId);
+  const unsigned short entryIndex = m_dictionary[m_records[recordId - 1]];
+  if (!indexEntry || !entryIndex)
+    return;
+
+  m_lazyInput->seek((long)indexEntry->m_offset, librevenge::RVNG_SEEK_SET);
+  m_currentRecord = recordId - 1;
+  parseRecord(m_lazyInput, m_collector, m_dictionaryEntries[entryIndex]);
+  m_lazyInput->clearFailure();
+}
+
+bool libfreehand::FHParser::parseDocumentInParallel(FHInternalStream *input, libfreehand::FHCollector *collector, FHInflateCache *cache)
+{
+#ifdef HAVE_PTHREAD
+  unsigned long size = 0;
+  const unsigned char *const data = input->getData(size);
+  if (data && getRecordIndex(input, cache, m_recordIndex))
+  {
+    unsigned long threads = m_decodeThreads ? m_decodeThreads : std::thread::hardware_concurrency();
+    threads = std::min(threads, m_recordIndex.size() / MIN_RECORDS_PER_THREAD);
+    if (threads > 1)
+      return decodeRecordsInParallel(data, size, input, collector, (unsigned)threads);
+  }
+  FH_DEBUG_MSG(("FHParser::parseDocumentInParallel - decoding the records in one thread\n"));
+  input->clearFailure();
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+#else
+  (void)cache;
+#endif
+  return parseDocument(input, collector);
+}
+
+#ifdef HAVE_PTHREAD
+
+bool libfreehand::FHParser::decodeRecordsInParallel(const unsigned char *data, unsigned long size, FHInternalStream *input, libfreehand::FHCollector *collector, unsigned threads)
+{
+  // Give each thread about the same amount of data
+  std::vector<FHRecordIndex::const_iterator> bounds(1, m_recordIndex.begin());
+  for (FHRecordIndex::const_iterator it = m_recordIndex.begin(); it != m_recordIndex.end() && bounds.size() < threads; ++it)
+  {
+    if (it->m_offset >= m_recordIndex.getTailOffset() / threads * bounds.size())
+      bounds.push_back(it);
+  }
+  bounds.push_back(m_recordIndex.end());
+
+  // Every thread has its own parser state and collector, and shares the
+  // rest with us
+  const unsigned ranges = unsigned(bounds.size() - 1);
+  std::vector<std::unique_ptr<FHParser> > parsers;
+  std::vector<std::unique_ptr<FHCollector> > shards;
+  for (unsigned i = 0; i < ranges; ++i)
+  {
+    parsers.push_back(std::unique_ptr<FHParser>(new FHParser(this)));
+    shards.push_back(std::unique_ptr<FHCollector>(new FHCollector()));
+  }
+
+  std::vector<char> done(ranges, false);
+  auto decode = [&](unsigned i)
+  {
+    done[i] = parsers[i]->decodeRecordRange(data, size, bounds[i], bounds[i + 1], shards[i].get());
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(ranges);
+  for (unsigned i = 0; i < ranges; ++i)
+  {
+    try
+    {
+      workers.push_back(std::thread(decode, i));
+    }
+    catch (const std::system_error &)
+    {
+      decode(i);
+    }
+  }
+  for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+    it->join();
+  if (std::find(done.begin(), done.end(), false) != done.end())
+    return false;
+
+  for (unsigned i = 0; i < ranges; ++i)
+    collector->merge(*shards[i]);
+
+  // The rest depends on the order of the records, or changes our state
+  for (FHRecordIndex::const_iterator it = m_recordIndex.begin(); it != m_recordIndex.end(); ++it)
+  {
+    if (!isDecodedInOrder(it->m_token))
+      continue;
+    input->seek((long)it->m_offset, librevenge::RVNG_SEEK_SET);
+    m_currentRecord = it->m_record - 1;
+    parseRecord(input, collector, m_dictionaryEntries[m_dictionary[m_records[m_currentRecord]]]);
+  }
+  input->seek((long)m_recordIndex.getTailOffset(), librevenge::RVNG_SEEK_SET);
+  m_currentRecord = m_records.size();
+  readFHTail(input, collector);
+  if (input->hasFailed() && !m_skipDamagedRecords)
+    return false;
   collector->collectPageInfo(m_pageInfo);
+  return true;
+}
+
+bool libfreehand::FHParser::decodeRecordRange(const unsigned char *data, unsigned long size, FHRecordIndex::const_iterator begin, FHRecordIndex::const_iterator end, libfreehand::FHCollector *collector)
+{
+  FHInternalStream input(data, size);
+  for (FHRecordIndex::const_iterator it = begin; it != end; ++it)
+  {
+    if (isDecodedInOrder(it->m_token))
+      continue;
+    input.seek((long)it->m_offset, librevenge::RVNG_SEEK_SET);
+    m_currentRecord = it->m_record - 1;
+    parseRecord(&input, collector, m_document->m_dictionaryEntries[m_document->m_dictionary[m_document->m_records[m_currentRecord]]]);
+  }
+  return !input.hasFailed() || m_skipDamagedRecords;
+}
+
+#endif
+
+bool libfreehand::FHParser::indexRecords(FHInternalStream *input, FHRecordIndex &index, libfreehand::FHCollector *collector)
+{
+  index.clear();
+  index.reserve(m_records.size());
+  m_skippedRecords = 0;
+  // the readers add to the page bounds, which are not ours to change here
+  const FHPageInfo pageInfo = m_pageInfo;
+  bool ok = true;
+  for (m_currentRecord = 0; m_currentRecord < m_records.size() && !input->isEnd(); ++m_currentRecord)
+  {
+    const unsigned short entryIndex = m_dictionary.empty() ? 0 : m_dictionary[m_records[m_currentRecord]];
+    if (!entryIndex)
+      continue;
+    const DictionaryEntry &entry = m_dictionaryEntries[entryIndex];
+    const unsigned long offset = (unsigned long)input->tell();
+    if (m_recordGraph)
+      m_recordGraph->startRecord(unsigned(m_currentRecord + 1), entry.m_type ? entry.m_type->m_name : nullptr);
+    // parseRecords stops or skips records here, so the rest cannot be
+    // indexed reliably otherwise
+    bool damaged = false;
+    // the graph needs the ids in records of a fixed size too, and with a
+    // collector the records are decoded by their readers
+    const long layoutSize = (m_recordGraph || collector) ? -1 : getLayoutSize(entry.m_layout);
+    if (entry.m_token == FH_TOKEN_INVALID)
+      damaged = true;
+    else if (layoutSize >= 0)
+    {
+      const unsigned long size = (unsigned long)layoutSize;
+      damaged = input->getRemainingLength(size + 1) <= size;
+      if (!damaged)
+        input->seek((long)size, librevenge::RVNG_SEEK_CUR);
+    }
+    else
+    {
+      m_invalidRecordIds = 0;
+      parseRecord(input, collector, entry);
+      damaged = input->hasFailed() || input->isEnd() || (m_skipDamagedRecords && (m_invalidRecordIds || (unsigned long)input->tell() < offset));
+    }
+    if (damaged)
+    {
+      // drop the ids that were read from it
+      if (m_recordGraph)
+        m_recordGraph->startRecord(unsigned(m_currentRecord + 1), entry.m_type ? entry.m_type->m_name : nullptr);
+      if (m_skipDamagedRecords && skipDamagedRecords(input, offset))
+      {
+        // the records from where we go on may have been indexed already
+        index.removeAfter(unsigned(m_currentRecord + 1));
+        continue;
+      }
+      ok = false;
+      break;
+    }
+    index.append(unsigned(m_currentRecord + 1), (unsigned short)entry.m_token, offset, (unsigned long)input->tell() - offset);
+  }
+  index.setTailOffset((unsigned long)input->tell());
+  m_pageInfo = pageInfo;
+  return ok;
 }
 
-void libfreehand::FHParser::readAGDFont(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+std::string libfreehand::FHParser::getRecordIndexName(FHInternalStream *input, FHInflateCache *cache) const
+{
+  const std::string &contentName = input->getCacheEntryName();
+  if (!cache || contentName.empty())
+    return std::string();
+
+  // The index depends on the content, on the records and on how we read them.
+  std::vector<unsigned char> key(contentName.begin(), contentName.end());
+#ifdef PACKAGE_VERSION
+  const std::string packageVersion(PACKAGE_VERSION);
+  key.insert(key.end(), packageVersion.begin(), packageVersion.end());
+#endif
+  key.push_back((unsigned char)m_version);
+  key.reserve(key.size() + 2 * m_records.size());
+  for (std::vector<unsigned short>::const_iterator it = m_records.begin(); it != m_records.end(); ++it)
+  {
+    const unsigned short entryIndex = m_dictionary.empty() ? 0 : m_dictionary[*it];
+    const int token = entryIndex ? m_dictionaryEntries[entryIndex].m_token : 0;
+    key.push_back((unsigned char)(token >> 8));
+    key.push_back((unsigned char)token);
+  }
+  return cache->getEntryName(&key[0], key.size());
+}
+
+bool libfreehand::FHParser::getRecordIndex(FHInternalStream *input, FHInflateCache *cache, FHRecordIndex &index)
+{
+  const std::string name = getRecordIndexName(input, cache);
+  if (!name.empty())
+  {
+    std::unique_ptr<FHInflateCacheEntry> entry = cache->find(name);
+    if (entry && index.read(entry->getData(), entry->getSize()))
+    {
+      FH_DEBUG_MSG(("FHParser::getRecordIndex - %lu records from the cache\n", index.size()));
+      return true;
+    }
+  }
+
+  if (!indexRecords(input, index, nullptr))
+    return false;
+
+  // The cached index is used whether damaged records are skipped or not
+  if (!name.empty() && !m_skippedRecords)
+  {
+    std::vector<unsigned char> data;
+    index.write(data);
+    cache->store(name, &data[0], data.size());
+  }
+  return true;
+}
+
+void libfreehand::FHParser::readAGDFont(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   unsigned short num = readU16(input);
@@ -594,74 +962,41 @@ void libfreehand::FHParser::readAGDFont(librevenge::RVNGInputStream *input, libf
     collector->collectAGDFont(m_currentRecord+1, font);
 }
 
-void libfreehand::FHParser::readAGDSelection(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readArrowPath(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
-  unsigned short size = readU16(input);
-  input->seek(6+size*4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readArrowPath(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
-{
-  if (m_version > 8)
+  if (family >= FAMILY_FH9)
     input->seek(20, librevenge::RVNG_SEEK_CUR);
   unsigned numPoints = readU16(input);
-  if (m_version <= 8)
-    input->seek(20, librevenge::RVNG_SEEK_CUR);
-  if (m_version > 3)
-    input->seek(4, librevenge::RVNG_SEEK_CUR);
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-
-  long endPos=input->tell()+27*numPoints;
-  std::vector<unsigned char> ptrTypes;
-  std::vector<std::vector<std::pair<double, double> > > path;
-  try
-  {
-    for (unsigned short i = 0; i < numPoints  && !input->isEnd(); ++i)
-    {
-      input->seek(1, librevenge::RVNG_SEEK_CUR);
-      ptrTypes.push_back(readU8(input));
-      input->seek(1, librevenge::RVNG_SEEK_CUR);
-      std::vector<std::pair<double, double> > segment;
-      for (unsigned short j = 0; j < 3 && !input->isEnd(); ++j)
-      {
-        double x = _readCoordinate(input);
-        double y = _readCoordinate(input);
-        std::pair<double, double> tmpPoint = std::make_pair(72.*x, 72.*y);
-        segment.push_back(tmpPoint);
-      }
-      if (segment.size() == 3)
-        path.push_back(segment);
-      segment.clear();
-    }
-  }
-  catch (const EndOfStreamException &)
+  if (family < FAMILY_FH9)
+    input->seek(20, librevenge::RVNG_SEEK_CUR);
+  if (family > FAMILY_FH3)
+    input->seek(4, librevenge::RVNG_SEEK_CUR);
+  input->seek(4, librevenge::RVNG_SEEK_CUR);
+
+  long endPos=input->tell()+long(PATH_POINT_SIZE)*numPoints;
+  std::vector<double> coords;
+  const unsigned count = readPathPoints(input, numPoints, coords);
+  if (input->hasFailed())
   {
-    FH_DEBUG_MSG(("libfreehand::FHParser::readArrowPath:Caught EndOfStreamException, continuing\n"));
+    FH_DEBUG_MSG(("libfreehand::FHParser::readArrowPath:The path is truncated, continuing\n"));
+    input->clearFailure();
   }
   input->seek(endPos, librevenge::RVNG_SEEK_SET);
 
-  if (path.empty())
+  if (!count)
   {
     FH_DEBUG_MSG(("libfreehand::FHParser::readArrowPath:No path was read\n"));
     return;
   }
 
   FHPath fhPath;
-  fhPath.appendMoveTo(path[0][0].first / 72.0, path[0][0].second / 72.0);
-  size_t i = 0;
-  for (i = 0; i<path.size()-1; ++i)
-    fhPath.appendCubicBezierTo(path[i][2].first / 72.0, path[i][2].second / 72.0,
-                               path[i+1][1].first / 72.0, path[i+1][1].second / 72.0,
-                               path[i+1][0].first / 72.0,  path[i+1][0].second / 72.0);
-  fhPath.appendCubicBezierTo(path[i][2].first / 72.0, path[i][2].second / 72.0,
-                             path[0][1].first / 72.0, path[0][1].second / 72.0,
-                             path[0][0].first / 72.0, path[0][0].second / 72.0);
-  fhPath.appendClosePath();
+  appendPathPoints(fhPath, coords, count, true);
   if (collector && !fhPath.empty())
     collector->collectArrowPath(m_currentRecord+1, fhPath);
 }
 
-void libfreehand::FHParser::readAttributeHolder(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readAttributeHolder(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHAttributeHolder attributeHolder;
   attributeHolder.m_parentId = _readRecordId(input);
@@ -670,7 +1005,7 @@ void libfreehand::FHParser::readAttributeHolder(librevenge::RVNGInputStream *inp
     collector->collectAttributeHolder(m_currentRecord+1, attributeHolder);
 }
 
-void libfreehand::FHParser::readBasicFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readBasicFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHBasicFill fill;
   fill.m_colorId = _readRecordId(input);
@@ -679,7 +1014,7 @@ void libfreehand::FHParser::readBasicFill(librevenge::RVNGInputStream *input, li
     collector->collectBasicFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readBasicLine(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readBasicLine(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHBasicLine line;
   line.m_colorId = _readRecordId(input);
@@ -693,21 +1028,7 @@ void libfreehand::FHParser::readBasicLine(librevenge::RVNGInputStream *input, li
     collector->collectBasicLine(m_currentRecord+1, line);
 }
 
-void libfreehand::FHParser::readBendFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(10, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readBlendObject(librevenge::RVNGInputStream *input, libfreehand::FHCollector */*collector*/)
-{
-  // osnola useme
-  for (int i=0; i<2; ++i) _readRecordId(input);
-  input->seek(8, librevenge::RVNG_SEEK_CUR);
-  _readRecordId(input);
-  input->seek(16, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readBlock(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readBlock(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned layerListId = 0;
   if (m_version == 10)
@@ -753,44 +1074,13 @@ void libfreehand::FHParser::readBlock(librevenge::RVNGInputStream *input, libfre
   }
 }
 
-void libfreehand::FHParser::readBrush(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  _readRecordId(input);
-}
-
-void libfreehand::FHParser::readBrushStroke(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  _readRecordId(input);
-  _readRecordId(input);
-}
-
-void libfreehand::FHParser::readBrushTip(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  input->seek(60, librevenge::RVNG_SEEK_CUR);
-  if (m_version == 11)
-    input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readCalligraphicStroke(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  input->seek(12, librevenge::RVNG_SEEK_CUR);
-  _readRecordId(input);
-}
-
-void libfreehand::FHParser::readCharacterFill(librevenge::RVNGInputStream * /* input */, libfreehand::FHCollector * /* collector */)
-{
-}
-
-void libfreehand::FHParser::readClipGroup(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readClipGroup(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHGroup group;
   group.m_graphicStyleId = _readRecordId(input);
   _readRecordId(input);
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   group.m_elementsId = _readRecordId(input);
@@ -799,12 +1089,7 @@ void libfreehand::FHParser::readClipGroup(librevenge::RVNGInputStream *input, li
     collector->collectClipGroup(m_currentRecord+1, group);
 }
 
-void libfreehand::FHParser::readCollector(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readColor6(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readColor6(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned var = readU16(input);
   _readRecordId(input);
@@ -825,12 +1110,13 @@ void libfreehand::FHParser::readColor6(librevenge::RVNGInputStream *input, libfr
     collector->collectColor(m_currentRecord+1, color);
 }
 
-void libfreehand::FHParser::readCompositePath(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readCompositePath(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHCompositePath compositePath;
   compositePath.m_graphicStyleId = _readRecordId(input);
   _readRecordId(input);
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   compositePath.m_elementsId = _readRecordId(input);
@@ -838,7 +1124,7 @@ void libfreehand::FHParser::readCompositePath(librevenge::RVNGInputStream *input
     collector->collectCompositePath(m_currentRecord+1, compositePath);
 }
 
-void libfreehand::FHParser::readConeFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readConeFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   /* It is actually a conic gradient that goes from a line on an angle phi
      to a line at an angle phi + M_PI both CW and CCW. We are unable though
@@ -858,18 +1144,7 @@ void libfreehand::FHParser::readConeFill(librevenge::RVNGInputStream *input, lib
     collector->collectLinearFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readConnectorLine(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(20, librevenge::RVNG_SEEK_CUR);
-  unsigned short num = readU16(input);
-  input->seek(46+num*27, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readContentFill(librevenge::RVNGInputStream * /* input */, libfreehand::FHCollector * /* collector */)
-{
-}
-
-void libfreehand::FHParser::readContourFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readContourFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   if (m_version > 9)
   {
@@ -898,7 +1173,7 @@ void libfreehand::FHParser::readContourFill(librevenge::RVNGInputStream *input,
   }
 }
 
-void libfreehand::FHParser::readCustomProc(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readCustomProc(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHCustomProc line;
   unsigned short size = readU16(input);
@@ -934,39 +1209,46 @@ void libfreehand::FHParser::readCustomProc(librevenge::RVNGInputStream *input, l
     collector->collectCustomProc(m_currentRecord+1, line);
 }
 
-void libfreehand::FHParser::readDataList(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readDataList(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size = readU16(input);
   FHDataList list;
   list.m_dataSize = readU32(input);
   input->seek(4, librevenge::RVNG_SEEK_CUR);
-  if (size > getRemainingLength(input) / 2)
-    size = getRemainingLength(input) / 2;
-  list.m_elements.reserve(size);
-  for (unsigned short i = 0; i < size; ++i)
-    list.m_elements.push_back(_readRecordId(input));
+  if (size > getRemainingLength(input, 2 * (unsigned long)size) / 2)
+    size = getRemainingLength(input, 2 * (unsigned long)size) / 2;
+  list.m_elements.resize(size);
+  if (size)
+    _readRecordIdArray(input, &list.m_elements[0], size);
   if (collector)
     collector->collectDataList(m_currentRecord+1, list);
 }
 
-void libfreehand::FHParser::readData(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readData(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned blockSize = readU16(input);
   unsigned dataSize = readU32(input);
-  unsigned long numBytesRead = 0;
-  const unsigned char *buffer = input->read(dataSize, numBytesRead);
-  librevenge::RVNGBinaryData data(buffer, numBytesRead);
-  input->seek(blockSize*4-dataSize, librevenge::RVNG_SEEK_CUR);
+  FHData data;
+  data.m_offset = (unsigned long)input->tell();
+  if (collector && input->keepsAllData())
+  {
+    // the data are taken from the document when they are output
+    data.m_length = getRemainingLength(input, dataSize);
+    input->seek((long)data.m_length, librevenge::RVNG_SEEK_CUR);
+  }
+  else
+  {
+    const unsigned char *buffer = input->read(dataSize, data.m_length);
+    // the data are only copied if they are wanted
+    if (collector)
+      data.m_copy.assign(buffer, buffer + data.m_length);
+  }
   if (collector)
     collector->collectData(m_currentRecord+1, data);
+  input->seek(blockSize*4-dataSize, librevenge::RVNG_SEEK_CUR);
 }
 
-void libfreehand::FHParser::readDateTime(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readDisplayText(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readDisplayText(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   FHDisplayText displayText;
@@ -994,14 +1276,14 @@ void libfreehand::FHParser::readDisplayText(librevenge::RVNGInputStream *input,
     _readFH3CharProperties(input, charProps);
     displayText.m_charProps.push_back(charProps);
   }
-  while (charProps.m_offset < textLength);
+  while (charProps.m_offset < textLength && !input->hasFailed());
   FH3ParaProperties paraProps;
   do
   {
     _readFH3ParaProperties(input, paraProps);
     displayText.m_paraProps.push_back(paraProps);
   }
-  while (paraProps.m_offset < textLength);
+  while (paraProps.m_offset < textLength && !input->hasFailed());
 #ifdef DEBUG
   librevenge::RVNGString text;
 #endif
@@ -1018,27 +1300,13 @@ void libfreehand::FHParser::readDisplayText(librevenge::RVNGInputStream *input,
   FH_DEBUG_MSG(("FHParser::readDisplayText: %s\n", text.cstr()));
 }
 
-void libfreehand::FHParser::readDuetFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readElement(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readElemList(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readElemPropLst(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readElemPropLst(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
-  if (m_version > 8)
+  if (family >= FAMILY_FH9)
     input->seek(2, librevenge::RVNG_SEEK_CUR);
   unsigned short size = readU16(input);
-  if (m_version <= 8)
+  if (family < FAMILY_FH9)
     input->seek(2, librevenge::RVNG_SEEK_CUR);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   FHPropList propertyList;
@@ -1049,32 +1317,7 @@ void libfreehand::FHParser::readElemPropLst(librevenge::RVNGInputStream *input,
     collector->collectPropList(m_currentRecord+1, propertyList);
 }
 
-void libfreehand::FHParser::readEnvelope(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(2, librevenge::RVNG_SEEK_CUR);
-  _readRecordId(input);
-  _readRecordId(input);
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-  unsigned short num = readU16(input);
-  _readRecordId(input);
-  input->seek(19, librevenge::RVNG_SEEK_CUR);
-  unsigned short num2 = readU16(input);
-  input->seek(4*num2+27*num, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readEPSImport(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  // TODO: Needs to be verified. The size has been determined
-  // experimentally from a single v.7 (Mac) document.
-  input->seek(38, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readExpandFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readExtrusion(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
+void libfreehand::FHParser::readExtrusion(FHInternalStream *input, libfreehand::FHCollector * /* collector */)
 {
   long startPosition = input->tell();
   input->seek(96, librevenge::RVNG_SEEK_CUR);
@@ -1086,12 +1329,7 @@ void libfreehand::FHParser::readExtrusion(librevenge::RVNGInputStream *input, li
   input->seek(92 + _xformCalc(var1, var2) + 2, librevenge::RVNG_SEEK_CUR);
 }
 
-void libfreehand::FHParser::readFHDocHeader(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readFHTail(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readFHTail(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FH_DEBUG_MSG(("Reading FHTail fake record\n"));
   FHTail fhTail;
@@ -1102,7 +1340,7 @@ void libfreehand::FHParser::readFHTail(librevenge::RVNGInputStream *input, libfr
   input->seek(0x1a+startPosition, librevenge::RVNG_SEEK_SET);
   fhTail.m_pageInfo.m_maxX = _readCoordinate(input) / 72.0;
   fhTail.m_pageInfo.m_maxY = _readCoordinate(input) / 72.0;
-  input->seek(0x32+startPosition, librevenge::RVNG_SEEK_SET);
+  input->seek(long(TAIL_SIZE)+startPosition, librevenge::RVNG_SEEK_SET);
   fhTail.m_pageInfo.m_minX = 0.0;
   fhTail.m_pageInfo.m_minY = 0.0;
 
@@ -1110,21 +1348,7 @@ void libfreehand::FHParser::readFHTail(librevenge::RVNGInputStream *input, libfr
     collector->collectFHTail(m_currentRecord+1, fhTail);
 }
 
-void libfreehand::FHParser::readFigure(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readFileDescriptor(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  _readRecordId(input);
-  input->seek(5, librevenge::RVNG_SEEK_CUR);
-  unsigned short size = readU16(input);
-  input->seek(size, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readFilterAttributeHolder(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readFilterAttributeHolder(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHFilterAttributeHolder filterAttributeHolder;
   filterAttributeHolder.m_parentId = _readRecordId(input);
@@ -1134,23 +1358,7 @@ void libfreehand::FHParser::readFilterAttributeHolder(librevenge::RVNGInputStrea
     collector->collectFilterAttributeHolder(m_currentRecord+1, filterAttributeHolder);
 }
 
-void libfreehand::FHParser::readFWBevelFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  input->seek(28, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readFWBlurFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(12, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readFWFeatherFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(8, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readFWGlowFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readFWGlowFilter(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FWGlowFilter filter;
   filter.m_colorId = _readRecordId(input);
@@ -1165,7 +1373,7 @@ void libfreehand::FHParser::readFWGlowFilter(librevenge::RVNGInputStream *input,
     collector->collectFWGlowFilter(m_currentRecord+1, filter);
 }
 
-void libfreehand::FHParser::readFWShadowFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readFWShadowFilter(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FWShadowFilter filter;
   filter.m_colorId = _readRecordId(input);
@@ -1182,17 +1390,7 @@ void libfreehand::FHParser::readFWShadowFilter(librevenge::RVNGInputStream *inpu
     collector->collectFWShadowFilter(m_currentRecord+1, filter);
 }
 
-void libfreehand::FHParser::readFWSharpenFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(16, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readGradientMaskFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-}
-
-void libfreehand::FHParser::readGraphicStyle(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readGraphicStyle(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   unsigned short size = readU16(input);
@@ -1205,12 +1403,13 @@ void libfreehand::FHParser::readGraphicStyle(librevenge::RVNGInputStream *input,
     collector->collectGraphicStyle(m_currentRecord+1, graphicStyle);
 }
 
-void libfreehand::FHParser::readGroup(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readGroup(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHGroup group;
   group.m_graphicStyleId = _readRecordId(input);
   _readRecordId(input);
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   group.m_elementsId = _readRecordId(input);
@@ -1219,37 +1418,16 @@ void libfreehand::FHParser::readGroup(librevenge::RVNGInputStream *input, libfre
     collector->collectGroup(m_currentRecord+1, group);
 }
 
-void libfreehand::FHParser::readGuides(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  unsigned short size = readU16(input);
-  _readRecordId(input);
-  _readRecordId(input);
-  /* osnola: todo, useme, there is one guide by "page", ... */
-  if (m_version > 3)
-    input->seek(4, librevenge::RVNG_SEEK_CUR);
-  input->seek(12+size*8, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readHalftone(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  _readRecordId(input);
-  input->seek(8, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readImageFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(6, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readImageImport(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readImageImport(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHImageImport image;
   image.m_graphicStyleId = _readRecordId(input);
   _readRecordId(input); // parent
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(4, librevenge::RVNG_SEEK_CUR);
-  if (m_version > 8)
+  if (family >= FAMILY_FH9)
     _readRecordId(input); // format name
   image.m_dataListId = _readRecordId(input);
   _readRecordId(input); // file descriptor
@@ -1259,7 +1437,7 @@ void libfreehand::FHParser::readImageImport(librevenge::RVNGInputStream *input,
   image.m_width = _readCoordinate(input) / 72.0;
   image.m_height = _readCoordinate(input) / 72.0;
   input->seek(18, librevenge::RVNG_SEEK_CUR);
-  if (m_version > 8)
+  if (family >= FAMILY_FH9)
   {
     unsigned char character(0);
     do
@@ -1271,22 +1449,18 @@ void libfreehand::FHParser::readImageImport(librevenge::RVNGInputStream *input,
     while (character);
   }
 
-  if (m_version > 10)
+  if (family >= FAMILY_FH11)
     input->seek(2, librevenge::RVNG_SEEK_CUR);
   if (collector)
     collector->collectImage(m_currentRecord+1, image);
 }
 
-void libfreehand::FHParser::readImport(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(34, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readLayer(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readLayer(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHLayer layer;
   layer.m_graphicStyleId = _readRecordId(input);
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(6, librevenge::RVNG_SEEK_CUR);
   layer.m_elementsId = _readRecordId(input);
@@ -1297,7 +1471,7 @@ void libfreehand::FHParser::readLayer(librevenge::RVNGInputStream *input, libfre
     collector->collectLayer(m_currentRecord+1, layer);
 }
 
-void libfreehand::FHParser::readLensFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readLensFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHLensFill fill;
   fill.m_colorId = _readRecordId(input);
@@ -1309,7 +1483,7 @@ void libfreehand::FHParser::readLensFill(librevenge::RVNGInputStream *input, lib
     collector->collectLensFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readLinearFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readLinearFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHLinearFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -1322,7 +1496,7 @@ void libfreehand::FHParser::readLinearFill(librevenge::RVNGInputStream *input, l
     collector->collectLinearFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readLinePat(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readLinePat(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short numStrokes = readU16(input);
   if (!numStrokes && m_version == 8)
@@ -1334,8 +1508,8 @@ void libfreehand::FHParser::readLinePat(librevenge::RVNGInputStream *input, libf
   }
   input->seek(8, librevenge::RVNG_SEEK_CUR);
   FHLinePattern pattern;
-  if (numStrokes > getRemainingLength(input) / 4)
-    numStrokes = getRemainingLength(input) / 4;
+  if (numStrokes > getRemainingLength(input, 4 * (unsigned long)numStrokes) / 4)
+    numStrokes = getRemainingLength(input, 4 * (unsigned long)numStrokes) / 4;
   pattern.m_dashes.resize(size_t(numStrokes));
   for (unsigned short i=0; i<numStrokes; ++i)
     pattern.m_dashes[size_t(i)]=_readCoordinate(input);
@@ -1343,86 +1517,26 @@ void libfreehand::FHParser::readLinePat(librevenge::RVNGInputStream *input, libf
     collector->collectLinePattern(m_currentRecord+1, pattern);
 }
 
-void libfreehand::FHParser::readLineTable(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  unsigned short tmpSize = readU16(input);
-  unsigned short size = readU16(input);
-  if (m_version < 10)
-    size = tmpSize;
-  for (unsigned short i = 0; i < size; ++i)
-  {
-    input->seek(48, librevenge::RVNG_SEEK_CUR);
-    _readRecordId(input);
-  }
-}
-
-void libfreehand::FHParser::readMasterPageDocMan(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMasterPageElement(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMasterPageLayerElement(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMasterPageLayerInstance(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-  unsigned char var1 = readU8(input);
-  unsigned char var2 = readU8(input);
-  input->seek(_xformCalc(var1, var2) + 2, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMasterPageSymbolClass(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(12, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMasterPageSymbolInstance(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(14, librevenge::RVNG_SEEK_CUR);
-  unsigned char var1 = readU8(input);
-  unsigned char var2 = readU8(input);
-  input->seek(_xformCalc(var1, var2) + 2, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMDict(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(2, librevenge::RVNG_SEEK_CUR);
-  unsigned short size = readU16(input);
-  input->seek(2, librevenge::RVNG_SEEK_CUR);
-  for (unsigned short i = 0; i < size; ++i)
-  {
-    _readRecordId(input);
-    _readRecordId(input);
-  }
-}
-
-void libfreehand::FHParser::readList(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readList(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size2 = readU16(input);
   unsigned short size = readU16(input);
   input->seek(6, librevenge::RVNG_SEEK_CUR);
   FHList lst;
   lst.m_listType = readU16(input);
-  if (size > getRemainingLength(input) / 2)
-    size = getRemainingLength(input) / 2;
-  lst.m_elements.reserve(size);
-  for (unsigned short i = 0; i < size; ++i)
-    lst.m_elements.push_back(_readRecordId(input));
-  if (m_version < 9)
+  if (size > getRemainingLength(input, 2 * (unsigned long)size) / 2)
+    size = getRemainingLength(input, 2 * (unsigned long)size) / 2;
+  lst.m_elements.resize(size);
+  if (size)
+    _readRecordIdArray(input, &lst.m_elements[0], size);
+  if (family < FAMILY_FH9)
     input->seek(2*(size2-size),librevenge::RVNG_SEEK_CUR);
   if (collector)
     collector->collectList(m_currentRecord+1, lst);
 }
 
-void libfreehand::FHParser::readMName(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readMName(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   long startPosition = input->tell();
   unsigned short size = readU16(input);
@@ -1440,18 +1554,7 @@ void libfreehand::FHParser::readMName(librevenge::RVNGInputStream *input, libfre
   }
 }
 
-void libfreehand::FHParser::readMpObject(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMQuickDict(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  unsigned short size = readU16(input);
-  input->seek(5+size*4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMString(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readMString(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   long startPosition = input->tell();
   unsigned short size = readU16(input);
@@ -1466,24 +1569,13 @@ void libfreehand::FHParser::readMString(librevenge::RVNGInputStream *input, libf
     collector->collectString(m_currentRecord+1, str);
 }
 
-void libfreehand::FHParser::readMultiBlend(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  unsigned short size = readU16(input);
-  _readRecordId(input);
-  input->seek(8, librevenge::RVNG_SEEK_CUR);
-  _readRecordId(input);
-  _readRecordId(input);
-  _readRecordId(input);
-  input->seek(32 + size*6, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readMultiColorList(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readMultiColorList(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   std::vector<FHColorStop> colorStops;
   unsigned short num = readU16(input);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
-  if (num > getRemainingLength(input) / 10)
-    num = getRemainingLength(input) / 10;
+  if (num > getRemainingLength(input, 10 * (unsigned long)num) / 10)
+    num = getRemainingLength(input, 10 * (unsigned long)num) / 10;
   colorStops.reserve(num);
   for (unsigned short i = 0; i < num; ++i)
   {
@@ -1497,7 +1589,7 @@ void libfreehand::FHParser::readMultiColorList(librevenge::RVNGInputStream *inpu
     collector->collectMultiColorList(m_currentRecord+1, colorStops);
 }
 
-void libfreehand::FHParser::readNewBlend(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readNewBlend(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHNewBlend newBlend;
   newBlend.m_graphicStyleId = _readRecordId(input);
@@ -1511,7 +1603,7 @@ void libfreehand::FHParser::readNewBlend(librevenge::RVNGInputStream *input, lib
     collector->collectNewBlend(m_currentRecord+1, newBlend);
 }
 
-void libfreehand::FHParser::readNewContourFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readNewContourFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHRadialFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -1528,7 +1620,7 @@ void libfreehand::FHParser::readNewContourFill(librevenge::RVNGInputStream *inpu
     collector->collectRadialFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readNewRadialFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readNewRadialFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHRadialFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -1542,7 +1634,7 @@ void libfreehand::FHParser::readNewRadialFill(librevenge::RVNGInputStream *input
     collector->collectRadialFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readOpacityFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readOpacityFilter(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   _readRecordId(input);
   double opacity = (double)(readU16(input)) / 100.0;
@@ -1550,11 +1642,12 @@ void libfreehand::FHParser::readOpacityFilter(librevenge::RVNGInputStream *input
     collector->collectOpacityFilter(m_currentRecord+1, opacity);
 }
 
-void libfreehand::FHParser::readOval(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readOval(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short graphicStyle = _readRecordId(input);
   _readRecordId(input); // Layer
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(8, librevenge::RVNG_SEEK_CUR);
   unsigned short xform = _readRecordId(input);
@@ -1565,7 +1658,7 @@ void libfreehand::FHParser::readOval(librevenge::RVNGInputStream *input, libfree
   double arc1 = 0.0;
   double arc2 = 0.0;
   bool closed = false;
-  if (m_version > 10)
+  if (family >= FAMILY_FH11)
   {
     arc2 = _readCoordinate(input) * M_PI / 180.0;
     arc1 = _readCoordinate(input) * M_PI / 180.0;
@@ -1631,7 +1724,7 @@ void libfreehand::FHParser::readOval(librevenge::RVNGInputStream *input, libfree
     collector->collectPath(m_currentRecord+1, path);
 }
 
-void libfreehand::FHParser::readPantoneColor(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPantoneColor(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   _readRecordId(input);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
@@ -1641,7 +1734,7 @@ void libfreehand::FHParser::readPantoneColor(librevenge::RVNGInputStream *input,
     collector->collectColor(m_currentRecord+1, color);
 }
 
-void libfreehand::FHParser::readParagraph(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readParagraph(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   unsigned short size = readU16(input);
@@ -1649,8 +1742,8 @@ void libfreehand::FHParser::readParagraph(librevenge::RVNGInputStream *input, li
   FHParagraph paragraph;
   paragraph.m_paraStyleId = _readRecordId(input);
   paragraph.m_textBlokId = _readRecordId(input);
-  if (size > getRemainingLength(input) / 24)
-    size = getRemainingLength(input) / 24;
+  if (size > getRemainingLength(input, 24 * (unsigned long)size) / 24)
+    size = getRemainingLength(input, 24 * (unsigned long)size) / 24;
   paragraph.m_charStyleIds.reserve(size);
   for (unsigned short i = 0; i < size; ++i)
   {
@@ -1664,80 +1757,47 @@ void libfreehand::FHParser::readParagraph(librevenge::RVNGInputStream *input, li
     collector->collectParagraph(m_currentRecord+1, paragraph);
 }
 
-void libfreehand::FHParser::readPath(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readPath(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size = readU16(input); // 0-2
   unsigned graphicStyle = _readRecordId(input);
   _readRecordId(input);
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(9, librevenge::RVNG_SEEK_CUR);
   unsigned char flag = readU8(input);
   auto evenOdd = bool(flag&2);
   auto closed = bool(flag&1);
   unsigned short numPoints = readU16(input);
-  if (m_version > 8)
+  if (family >= FAMILY_FH9)
     size = numPoints;
 
-  std::vector<unsigned char> ptrTypes;
-  std::vector<std::vector<std::pair<double, double> > > path;
-
-  try
-  {
-    for (unsigned short i = 0; i < numPoints  && !input->isEnd(); ++i)
-    {
-      input->seek(1, librevenge::RVNG_SEEK_CUR);
-      ptrTypes.push_back(readU8(input));
-      input->seek(1, librevenge::RVNG_SEEK_CUR);
-      std::vector<std::pair<double, double> > segment;
-      for (unsigned short j = 0; j < 3 && !input->isEnd(); ++j)
-      {
-        double x = _readCoordinate(input);
-        double y = _readCoordinate(input);
-        std::pair<double, double> tmpPoint = std::make_pair(x, y);
-        segment.push_back(tmpPoint);
-      }
-      if (segment.size() == 3)
-        path.push_back(segment);
-      segment.clear();
-    }
-    input->seek((size-numPoints)*27, librevenge::RVNG_SEEK_CUR);
-  }
-  catch (const EndOfStreamException &)
+  std::vector<double> coords;
+  const unsigned count = readPathPoints(input, numPoints, coords);
+  if (input->hasFailed())
   {
-    FH_DEBUG_MSG(("Caught EndOfStreamException, continuing\n"));
+    FH_DEBUG_MSG(("The path is truncated, continuing\n"));
+    input->clearFailure();
   }
+  else
+    input->seek((size-numPoints)*long(PATH_POINT_SIZE), librevenge::RVNG_SEEK_CUR);
 
-  if (path.empty())
+  if (!count)
   {
     FH_DEBUG_MSG(("No path was read\n"));
     return;
   }
 
   FHPath fhPath;
-  fhPath.appendMoveTo(path[0][0].first / 72.0, path[0][0].second / 72.0);
-
-  size_t i = 0;
-  for (i = 0; i<path.size()-1; ++i)
-    fhPath.appendCubicBezierTo(path[i][2].first / 72.0, path[i][2].second / 72.0,
-                               path[i+1][1].first / 72.0, path[i+1][1].second / 72.0,
-                               path[i+1][0].first / 72.0,  path[i+1][0].second / 72.0);
-  if (closed)
-  {
-    fhPath.appendCubicBezierTo(path[i][2].first / 72.0, path[i][2].second / 72.0,
-                               path[0][1].first / 72.0, path[0][1].second / 72.0,
-                               path[0][0].first / 72.0, path[0][0].second / 72.0);
-
-    fhPath.appendClosePath();
-  }
-
+  appendPathPoints(fhPath, coords, count, closed);
   fhPath.setGraphicStyleId(graphicStyle);
   fhPath.setEvenOdd(evenOdd);
   if (collector && !fhPath.empty())
     collector->collectPath(m_currentRecord+1, fhPath);
 }
 
-void libfreehand::FHParser::readPathText(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPathText(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHPathText group;
   group.m_elementsId=_readRecordId(input);
@@ -1752,13 +1812,7 @@ void libfreehand::FHParser::readPathText(librevenge::RVNGInputStream *input, lib
     collector->collectPathText(m_currentRecord+1, group);
 }
 
-void libfreehand::FHParser::readPathTextLineInfo(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  // osnola: only try for N0=5, N1=2, N2=5
-  input->seek(46, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readPatternFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPatternFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHPatternFill fill;
   fill.m_colorId = _readRecordId(input);
@@ -1768,7 +1822,7 @@ void libfreehand::FHParser::readPatternFill(librevenge::RVNGInputStream *input,
     collector->collectPatternFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readPatternLine(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPatternLine(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHPatternLine line;
   line.m_colorId = _readRecordId(input);
@@ -1790,12 +1844,7 @@ void libfreehand::FHParser::readPatternLine(librevenge::RVNGInputStream *input,
     collector->collectPatternLine(m_currentRecord+1, line);
 }
 
-void libfreehand::FHParser::readPerspectiveEnvelope(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(177, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readPerspectiveGrid(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
+void libfreehand::FHParser::readPerspectiveGrid(FHInternalStream *input, libfreehand::FHCollector * /* collector */)
 {
   while (readU8(input))
   {
@@ -1803,7 +1852,7 @@ void libfreehand::FHParser::readPerspectiveGrid(librevenge::RVNGInputStream *inp
   input->seek(58, librevenge::RVNG_SEEK_CUR);
 }
 
-void libfreehand::FHParser::readPolygonFigure(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPolygonFigure(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short graphicStyle = _readRecordId(input);
   _readRecordId(input); // Layer
@@ -1854,12 +1903,7 @@ void libfreehand::FHParser::readPolygonFigure(librevenge::RVNGInputStream *input
     collector->collectPath(m_currentRecord+1, path);
 }
 
-void libfreehand::FHParser::readProcedure(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(4, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readProcessColor(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readProcessColor(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   _readRecordId(input);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
@@ -1873,7 +1917,8 @@ void libfreehand::FHParser::readProcessColor(librevenge::RVNGInputStream *input,
     collector->collectColor(m_currentRecord+1, color);
 }
 
-void libfreehand::FHParser::readPropLst(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readPropLst(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size2 = readU16(input);
   unsigned short size = readU16(input);
@@ -1882,13 +1927,13 @@ void libfreehand::FHParser::readPropLst(librevenge::RVNGInputStream *input, libf
   _readPropLstElements(input, propertyList.m_elements, size);
   /* osnola: TODO
      - if version>3, look if pages is defined, if yes, the zone defines the list of pages, */
-  if (m_version < 9)
+  if (family < FAMILY_FH9)
     input->seek((size2 - size)*4, librevenge::RVNG_SEEK_CUR);
   if (collector)
     collector->collectPropList(m_currentRecord+1, propertyList);
 }
 
-void libfreehand::FHParser::readPSFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPSFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHBasicFill fill;
   fill.m_colorId = _readRecordId(input);
@@ -1897,7 +1942,7 @@ void libfreehand::FHParser::readPSFill(librevenge::RVNGInputStream *input, libfr
     collector->collectBasicFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readPSLine(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readPSLine(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHBasicLine line;
   line.m_colorId = _readRecordId(input);
@@ -1907,7 +1952,7 @@ void libfreehand::FHParser::readPSLine(librevenge::RVNGInputStream *input, libfr
     collector->collectBasicLine(m_currentRecord+1, line);
 }
 
-void libfreehand::FHParser::readRadialFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readRadialFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHRadialFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -1927,7 +1972,7 @@ void libfreehand::FHParser::readRadialFill(librevenge::RVNGInputStream *input, l
     collector->collectRadialFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readRadialFillX(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readRadialFillX(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHRadialFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -1940,16 +1985,12 @@ void libfreehand::FHParser::readRadialFillX(librevenge::RVNGInputStream *input,
     collector->collectRadialFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readRaggedFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(16, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readRectangle(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readRectangle(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned graphicStyle = _readRecordId(input);
   _readRecordId(input);
-  if (m_version > 3)
+  if (family > FAMILY_FH3)
     input->seek(4, librevenge::RVNG_SEEK_CUR);
   input->seek(8, librevenge::RVNG_SEEK_CUR);
   unsigned xform = _readRecordId(input);
@@ -1969,7 +2010,7 @@ void libfreehand::FHParser::readRectangle(librevenge::RVNGInputStream *input, li
   bool rtl(true);
   bool rtr(true);
   bool rbr(true);
-  if (m_version >= 11)
+  if (family >= FAMILY_FH11)
   {
     rtrt = _readCoordinate(input) / 72.0;
     rtrr = _readCoordinate(input) / 72.0;
@@ -2034,12 +2075,7 @@ void libfreehand::FHParser::readRectangle(librevenge::RVNGInputStream *input, li
     collector->collectPath(m_currentRecord+1, path);
 }
 
-void libfreehand::FHParser::readSketchFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(11, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readSpotColor(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readSpotColor(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   _readRecordId(input);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
@@ -2049,7 +2085,7 @@ void libfreehand::FHParser::readSpotColor(librevenge::RVNGInputStream *input, li
     collector->collectColor(m_currentRecord+1, color);
 }
 
-void libfreehand::FHParser::readSpotColor6(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readSpotColor6(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size = readU16(input);
   _readRecordId(input);
@@ -2063,12 +2099,13 @@ void libfreehand::FHParser::readSpotColor6(librevenge::RVNGInputStream *input, l
     collector->collectColor(m_currentRecord+1, color);
 }
 
-void libfreehand::FHParser::readStylePropLst(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readStylePropLst(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
-  if (m_version > 8)
+  if (family >= FAMILY_FH9)
     input->seek(2, librevenge::RVNG_SEEK_CUR);
   unsigned short size = readU16(input);
-  if (m_version <= 8)
+  if (family < FAMILY_FH9)
     input->seek(2, librevenge::RVNG_SEEK_CUR);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   FHPropList propertyList;
@@ -2079,7 +2116,7 @@ void libfreehand::FHParser::readStylePropLst(librevenge::RVNGInputStream *input,
     collector->collectPropList(m_currentRecord+1, propertyList);
 }
 
-void libfreehand::FHParser::readSwfImport(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readSwfImport(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHImageImport image;
   image.m_graphicStyleId = _readRecordId(input);
@@ -2098,7 +2135,7 @@ void libfreehand::FHParser::readSwfImport(librevenge::RVNGInputStream *input, li
     collector->collectImage(m_currentRecord+1, image);
 }
 
-void libfreehand::FHParser::readSymbolClass(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readSymbolClass(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHSymbolClass symbolClass;
   symbolClass.m_nameId = _readRecordId(input);
@@ -2110,7 +2147,7 @@ void libfreehand::FHParser::readSymbolClass(librevenge::RVNGInputStream *input,
     collector->collectSymbolClass(m_currentRecord+1, symbolClass);
 }
 
-void libfreehand::FHParser::readSymbolInstance(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readSymbolInstance(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHSymbolInstance symbolInstance;
   symbolInstance.m_graphicStyleId = _readRecordId(input);
@@ -2138,16 +2175,7 @@ void libfreehand::FHParser::readSymbolInstance(librevenge::RVNGInputStream *inpu
     collector->collectSymbolInstance(m_currentRecord+1, symbolInstance);
 }
 
-void libfreehand::FHParser::readSymbolLibrary(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(2, librevenge::RVNG_SEEK_CUR);
-  unsigned short size = readU16(input);
-  input->seek(8, librevenge::RVNG_SEEK_CUR);
-  for (unsigned short i = 0; i < size+3; ++i)
-    _readRecordId(input);
-}
-
-void libfreehand::FHParser::readTabTable(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTabTable(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size = readU16(input);
   unsigned short n = readU16(input);
@@ -2170,7 +2198,7 @@ void libfreehand::FHParser::readTabTable(librevenge::RVNGInputStream *input, lib
   input->seek(endPos, librevenge::RVNG_SEEK_SET);
 }
 
-void libfreehand::FHParser::readTaperedFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTaperedFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHLinearFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -2181,7 +2209,7 @@ void libfreehand::FHParser::readTaperedFill(librevenge::RVNGInputStream *input,
     collector->collectLinearFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readTaperedFillX(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTaperedFillX(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHLinearFill fill;
   fill.m_color1Id = _readRecordId(input);
@@ -2193,7 +2221,7 @@ void libfreehand::FHParser::readTaperedFillX(librevenge::RVNGInputStream *input,
     collector->collectLinearFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readTEffect(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTEffect(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHTEffect eff;
   input->seek(4, librevenge::RVNG_SEEK_CUR);
@@ -2228,16 +2256,15 @@ void libfreehand::FHParser::readTEffect(librevenge::RVNGInputStream *input, libf
     collector->collectTEffect(m_currentRecord+1, eff);
 }
 
-void libfreehand::FHParser::readTextBlok(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTextBlok(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size = readU16(input);
   unsigned short length = readU16(input);
-  if (length > getRemainingLength(input) / 2)
-    length = getRemainingLength(input) / 2;
-  std::vector<unsigned short> characters;
-  characters.reserve(length);
-  for (unsigned i = 0; i < length; ++i)
-    characters.push_back(readU16(input));
+  if (length > getRemainingLength(input, 2 * (unsigned long)length) / 2)
+    length = getRemainingLength(input, 2 * (unsigned long)length) / 2;
+  std::vector<unsigned short> characters(length);
+  if (length)
+    input->readU16Array(&characters[0], length);
   input->seek(size*4 - length*2, librevenge::RVNG_SEEK_CUR);
   if (collector)
     collector->collectTextBlok(m_currentRecord+1, characters);
@@ -2248,7 +2275,7 @@ void libfreehand::FHParser::readTextBlok(librevenge::RVNGInputStream *input, lib
 #endif
 }
 
-void libfreehand::FHParser::readTextEffs(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTextEffs(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned num = readU16(input);
   FHTEffect eff;
@@ -2278,7 +2305,7 @@ void libfreehand::FHParser::readTextEffs(librevenge::RVNGInputStream *input, lib
     collector->collectTEffect(m_currentRecord+1, eff);
 }
 
-void libfreehand::FHParser::readTextObject(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTextObject(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   unsigned short num = readU16(input);
@@ -2343,7 +2370,7 @@ void libfreehand::FHParser::readTextObject(librevenge::RVNGInputStream *input, l
     collector->collectTextObject(m_currentRecord+1, textObject);
 }
 
-void libfreehand::FHParser::readTileFill(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTileFill(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   FHTileFill fill;
   fill.m_xFormId = _readRecordId(input);
@@ -2358,7 +2385,7 @@ void libfreehand::FHParser::readTileFill(librevenge::RVNGInputStream *input, lib
     collector->collectTileFill(m_currentRecord+1, fill);
 }
 
-void libfreehand::FHParser::readTintColor(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTintColor(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   _readRecordId(input);
   input->seek(2, librevenge::RVNG_SEEK_CUR);
@@ -2382,7 +2409,7 @@ void libfreehand::FHParser::readTintColor(librevenge::RVNGInputStream *input, li
   }
 }
 
-void libfreehand::FHParser::readTintColor6(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readTintColor6(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   _readRecordId(input);
@@ -2395,35 +2422,31 @@ void libfreehand::FHParser::readTintColor6(librevenge::RVNGInputStream *input, l
     collector->collectColor(m_currentRecord+1, color);
 }
 
-void libfreehand::FHParser::readTransformFilter(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
-{
-  input->seek(39, librevenge::RVNG_SEEK_CUR);
-}
-
-void libfreehand::FHParser::readTString(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readTString(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   unsigned short size2 = readU16(input);
   unsigned short size = readU16(input);
   input->seek(16, librevenge::RVNG_SEEK_CUR);
-  if (size > getRemainingLength(input) / 2)
-    size = getRemainingLength(input) / 2;
+  if (size > getRemainingLength(input, 2 * (unsigned long)size) / 2)
+    size = getRemainingLength(input, 2 * (unsigned long)size) / 2;
   std::vector<unsigned> elements;
   elements.reserve(size);
   for (unsigned short i = 0; i < size; ++i)
     elements.push_back(_readRecordId(input));
-  if (m_version < 9)
+  if (family < FAMILY_FH9)
     input->seek((size2-size)*2, librevenge::RVNG_SEEK_CUR);
   if (collector && !elements.empty())
     collector->collectTString(m_currentRecord+1, elements);
 }
 
-void libfreehand::FHParser::readUString(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readUString(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   long startPosition = input->tell();
   unsigned short size = readU16(input);
   unsigned short length = readU16(input);
-  if (length > getRemainingLength(input) / 2)
-    length = getRemainingLength(input) / 2;
+  if (length > getRemainingLength(input, 2 * (unsigned long)length) / 2)
+    length = getRemainingLength(input, 2 * (unsigned long)length) / 2;
   std::vector<unsigned short> ustr;
   ustr.reserve(length);
   for (unsigned short i = 0; i < length; i++)
@@ -2444,7 +2467,7 @@ void libfreehand::FHParser::readUString(librevenge::RVNGInputStream *input, libf
     collector->collectString(m_currentRecord+1, str);
 }
 
-void libfreehand::FHParser::readVDict(librevenge::RVNGInputStream *input, libfreehand::FHCollector * /* collector */)
+void libfreehand::FHParser::readVDict(FHInternalStream *input, libfreehand::FHCollector * /* collector */)
 {
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   unsigned short num = readU16(input);
@@ -2460,7 +2483,7 @@ void libfreehand::FHParser::readVDict(librevenge::RVNGInputStream *input, libfre
   }
 }
 
-void libfreehand::FHParser::readVMpObj(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+void libfreehand::FHParser::readVMpObj(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   input->seek(4, librevenge::RVNG_SEEK_CUR);
   unsigned short num = readU16(input);
@@ -2515,16 +2538,16 @@ void libfreehand::FHParser::readVMpObj(librevenge::RVNGInputStream *input, libfr
     case FH_PARA_SPC_ABOVE:
     case FH_PARA_SPC_BELLOW:
     case FH_PARA_LEADING:
-      paraProps.m_idToDoubleMap[rec]=_readCoordinate(input);
+      paraProps.m_idToDoubleMap.set(rec, _readCoordinate(input));
       break;
     case FH_PARA_LINE_TOGETHER:
     case FH_PARA_TEXT_ALIGN:
     case FH_PARA_LEADING_TYPE:
     case FH_PARA_KEEP_SAME_LINE:
-      paraProps.m_idToIntMap[rec]=readU32(input);
+      paraProps.m_idToIntMap.set(rec, readU32(input));
       break;
     case FH_PARA_TAB_TABLE_ID:
-      paraProps.m_idToZoneIdMap[rec]=_readRecordId(input);
+      paraProps.m_idToZoneIdMap.set(rec, _readRecordId(input));
       break;
     case FH_TEFFECT_ID:
     {
@@ -2566,7 +2589,7 @@ void libfreehand::FHParser::readVMpObj(librevenge::RVNGInputStream *input, libfr
     case FH_RNG_KERN:
       if (!charProps)
         charProps.reset(new libfreehand::FHCharProperties());
-      charProps->m_idToDoubleMap[rec]=_readCoordinate(input);
+      charProps->m_idToDoubleMap.set(rec, _readCoordinate(input));
       break;
     default:
       if (key == 2)
@@ -2584,7 +2607,8 @@ void libfreehand::FHParser::readVMpObj(librevenge::RVNGInputStream *input, libfr
   }
 }
 
-void libfreehand::FHParser::readXform(librevenge::RVNGInputStream *input, libfreehand::FHCollector *collector)
+template<libfreehand::FHParser::VersionFamily family>
+void libfreehand::FHParser::readXform(FHInternalStream *input, libfreehand::FHCollector *collector)
 {
   double m11 = 1.0;
   double m21 = 0.0;
@@ -2592,7 +2616,7 @@ void libfreehand::FHParser::readXform(librevenge::RVNGInputStream *input, libfre
   double m22 = 1.0;
   double m13 = 0.0;
   double m23 = 0.0;
-  if (m_version < 9)
+  if (family < FAMILY_FH9)
   {
     input->seek(2, librevenge::RVNG_SEEK_CUR);
     m11 = _readCoordinate(input);
@@ -2630,12 +2654,26 @@ void libfreehand::FHParser::readXform(librevenge::RVNGInputStream *input, libfre
     collector->collectXform(m_currentRecord+1, m11, m21, m12, m22, m13, m23);
 }
 
-unsigned libfreehand::FHParser::_readRecordId(librevenge::RVNGInputStream *input)
+unsigned libfreehand::FHParser::_readRecordId(FHInternalStream *input)
+{
+  const unsigned recordId = input->readRecordId();
+  if (recordId > m_document->m_records.size())
+    ++m_invalidRecordIds;
+  if (m_recordGraph)
+    m_recordGraph->addReference(recordId);
+  return recordId;
+}
+
+void libfreehand::FHParser::_readRecordIdArray(FHInternalStream *input, unsigned *recordIds, unsigned long count)
 {
-  unsigned recid = readU16(input);
-  if (recid == 0xffff)
-    recid = 0x1ff00 - readU16(input);
-  return recid;
+  input->readRecordIdArray(recordIds, count);
+  for (unsigned long i = 0; i < count; ++i)
+  {
+    if (recordIds[i] > m_document->m_records.size())
+      ++m_invalidRecordIds;
+    if (m_recordGraph)
+      m_recordGraph->addReference(recordIds[i]);
+  }
 }
 
 unsigned libfreehand::FHParser::_xformCalc(unsigned char var1, unsigned char var2)
@@ -2658,12 +2696,12 @@ unsigned libfreehand::FHParser::_xformCalc(unsigned char var1, unsigned char var
   return length;
 }
 
-double libfreehand::FHParser::_readCoordinate(librevenge::RVNGInputStream *input)
+double libfreehand::FHParser::_readCoordinate(FHInternalStream *input)
 {
-  return (double)readS32(input)/65536.;
+  return input->readCoordinate();
 }
 
-libfreehand::FHRGBColor libfreehand::FHParser::_readRGBColor(librevenge::RVNGInputStream *input)
+libfreehand::FHRGBColor libfreehand::FHParser::_readRGBColor(FHInternalStream *input)
 {
   FHRGBColor tmpColor;
   tmpColor.m_red = readU16(input);
@@ -2672,7 +2710,7 @@ libfreehand::FHRGBColor libfreehand::FHParser::_readRGBColor(librevenge::RVNGInp
   return tmpColor;
 }
 
-libfreehand::FHRGBColor libfreehand::FHParser::_readCMYKColor(librevenge::RVNGInputStream *input)
+libfreehand::FHRGBColor libfreehand::FHParser::_readCMYKColor(FHInternalStream *input)
 {
   unsigned short cmyk[4] = { 0, 0, 0, 0 };
 
@@ -2692,7 +2730,7 @@ libfreehand::FHRGBColor libfreehand::FHParser::_readCMYKColor(librevenge::RVNGIn
   return tmpColor;
 }
 
-void libfreehand::FHParser::_readBlockInformation(librevenge::RVNGInputStream *input, unsigned i, unsigned &layerListId)
+void libfreehand::FHParser::_readBlockInformation(FHInternalStream *input, unsigned i, unsigned &layerListId)
 {
   if (i == 5)
     layerListId = _readRecordId(input);
@@ -2700,7 +2738,7 @@ void libfreehand::FHParser::_readBlockInformation(librevenge::RVNGInputStream *i
     _readRecordId(input);
 }
 
-void libfreehand::FHParser::_readPropLstElements(librevenge::RVNGInputStream *input, std::map<unsigned, unsigned> &properties, unsigned size)
+void libfreehand::FHParser::_readPropLstElements(FHInternalStream *input, std::map<unsigned, unsigned> &properties, unsigned size)
 {
   for (unsigned i = 0; i < size; ++i)
   {
@@ -2711,7 +2749,7 @@ void libfreehand::FHParser::_readPropLstElements(librevenge::RVNGInputStream *in
   }
 }
 
-void libfreehand::FHParser::_readFH3CharProperties(librevenge::RVNGInputStream *input, FH3CharProperties &charProps)
+void libfreehand::FHParser::_readFH3CharProperties(FHInternalStream *input, FH3CharProperties &charProps)
 {
   charProps.m_offset = readU16(input);
   unsigned flags = readU16(input);
@@ -2757,7 +2795,7 @@ void libfreehand::FHParser::_readFH3CharProperties(librevenge::RVNGInputStream *
   }
 }
 
-void libfreehand::FHParser::_readFH3ParaProperties(librevenge::RVNGInputStream *input, FH3ParaProperties &paraProps)
+void libfreehand::FHParser::_readFH3ParaProperties(FHInternalStream *input, FH3ParaProperties &paraProps)
 {
   paraProps.m_offset = readU16(input);
   input->seek(28, librevenge::RVNG_SEEK_CUR);
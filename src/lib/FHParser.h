@@ -11,174 +11,277 @@
 #define __FHPARSER_H__
 
 #include <map>
+#include <memory>
+#include <string>
 #include <vector>
 #include <lcms2.h>
 #include <librevenge/librevenge.h>
+#include "FHCollector.h"
+#include "FHRecordIndex.h"
 #include "FHTypes.h"
 
 namespace libfreehand
 {
 
-class FHCollector;
+class FHInflateCache;
+class FHInternalStream;
+class FHRecordGraph;
 
-class FHParser
+class FHParser : private FHRecordDecoder
 {
 public:
+  enum Content
+  {
+    CONTENT_ALL,
+    CONTENT_NO_IMAGES,
+    CONTENT_PAGES
+  };
+
   explicit FHParser();
   virtual ~FHParser();
   bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter);
+  // Finds where the records of the document are, without decoding them.
+  bool buildRecordIndex(librevenge::RVNGInputStream *input, FHRecordIndex &index);
+  // Finds where the records of the document are by decoding them, not by
+  // their layouts, so the two can be checked against each other.
+  bool buildDecodedRecordIndex(librevenge::RVNGInputStream *input, FHRecordIndex &index);
+  // Finds which records each record refers to, without decoding them.
+  bool buildRecordGraph(librevenge::RVNGInputStream *input, FHRecordGraph &graph);
+  void setInflateWindow(unsigned long size);
+  void setInflateCache(const std::string &dir, unsigned long size);
+  void setInflateInBackground(bool background);
+  void setLazyDecoding(bool lazy);
+  void setDecodeThreads(unsigned threads);
+  void setContent(Content content);
+  void setSkipDamagedRecords(bool skip);
+  // The number of records left out by the last parse
+  unsigned long getSkippedRecords() const
+  {
+    return m_skippedRecords;
+  }
 private:
   FHParser(const FHParser &);
   FHParser &operator=(const FHParser &);
+  // A parser for another thread, which decodes records of the document
+  // parsed by document. It shares the dictionary, the records and the
+  // color transform, which must outlive it.
+  explicit FHParser(const FHParser *document);
+
+  typedef void (FHParser::*RecordReader)(FHInternalStream *input, FHCollector *collector);
+
+  // Versions that lay records out alike. Readers that are templates over
+  // the family are instantiated for each, and the document picks one.
+  enum VersionFamily
+  {
+    FAMILY_FH3,
+    FAMILY_FH5, // 5 to 8
+    FAMILY_FH9, // 9 and 10
+    FAMILY_FH11,
+    FAMILY_COUNT
+  };
+
+  enum
+  {
+    RECORD_DRAWABLE = 1 << 0,
+    RECORD_IMAGE = 1 << 1,
+    RECORD_PAGE = 1 << 2
+  };
+
+  // Static description of a record type, generated from tokens.txt
+  struct RecordType
+  {
+    const char *m_name;
+    RecordReader m_readers[FAMILY_COUNT]; // nullptr if the record is only skipped
+    unsigned m_flags;
+  };
+
+  enum LayoutOp
+  {
+    LAYOUT_END,
+    LAYOUT_BYTES,
+    LAYOUT_IDS,
+    LAYOUT_COUNT,
+    LAYOUT_XFORM
+  };
 
+  // A step of the layout of a record in some version, generated from
+  // tokens.txt. The step is repeated as often as the count m_count says,
+  // or done once if m_count is 0.
+  struct LayoutStep
+  {
+    unsigned char m_op;
+    unsigned char m_count;
+    unsigned short m_size; // in bytes or record ids
+  };
+
+  struct DictionaryEntry
+  {
+    DictionaryEntry(int token, const RecordType *type, RecordReader reader, const LayoutStep *layout, bool skipped)
+      : m_token(token), m_type(type), m_reader(reader), m_layout(layout), m_skipped(skipped) {}
+    int m_token;
+    const RecordType *m_type;
+    RecordReader m_reader; // for the version of the document
+    const LayoutStep *m_layout;
+    bool m_skipped; // the record is not wanted
+  };
+
+  static const RecordType *getRecordType(int token);
+  static const LayoutStep *getRecordLayout(int token, int version);
+  static long getLayoutSize(const LayoutStep *layout);
+  static VersionFamily getVersionFamily(int version);
+
+  std::unique_ptr<FHInternalStream> openDocument(librevenge::RVNGInputStream *input, std::unique_ptr<FHInflateCache> &cache);
   void parseDictionary(librevenge::RVNGInputStream *input);
   void parseRecordList(librevenge::RVNGInputStream *input);
-  void parseRecord(librevenge::RVNGInputStream *input, FHCollector *collector, int recordId);
-  void parseRecords(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void parseDocument(librevenge::RVNGInputStream *input, FHCollector *collector);
-
-  void readAGDFont(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readAGDSelection(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readArrowPath(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readAttributeHolder(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBasicFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBasicLine(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBendFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBlendObject(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBlock(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBrush(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBrushStroke(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readBrushTip(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readCalligraphicStroke(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readCharacterFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readClipGroup(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readCollector(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readColor6(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readCompositePath(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readConeFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readConnectorLine(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readContentFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readContourFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readCustomProc(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readDataList(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readData(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readDateTime(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readDisplayText(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readDuetFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readElement(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readElemList(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readElemPropLst(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readEnvelope(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readEPSImport(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readExpandFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readExtrusion(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFHDocHeader(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFHTail(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFigure(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFileDescriptor(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFilterAttributeHolder(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFWBevelFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFWBlurFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFWFeatherFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFWGlowFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFWShadowFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readFWSharpenFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readGradientMaskFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readGraphicStyle(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readGroup(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readGuides(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readHalftone(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readImageFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readImageImport(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readImport(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readLayer(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readLensFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readLinearFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readLinePat(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readLineTable(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readList(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMasterPageDocMan(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMasterPageElement(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMasterPageLayerElement(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMasterPageLayerInstance(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMasterPageSymbolClass(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMasterPageSymbolInstance(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMDict(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMName(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMpObject(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMQuickDict(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMString(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMultiBlend(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readMultiColorList(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readNewBlend(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readNewContourFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readNewRadialFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readOpacityFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readOval(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPantoneColor(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readParagraph(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPath(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPathText(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPathTextLineInfo(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPatternFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPatternLine(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPerspectiveEnvelope(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPerspectiveGrid(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPolygonFigure(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readProcedure(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readProcessColor(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPropLst(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPSFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readPSLine(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readRadialFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readRadialFillX(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readRaggedFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readRectangle(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSketchFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSpotColor(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSpotColor6(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readStylePropLst(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSwfImport(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSymbolClass(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSymbolInstance(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readSymbolLibrary(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTabTable(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTaperedFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTaperedFillX(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTEffect(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTextBlok(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTextEffs(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTextObject(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTileFill(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTintColor(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTintColor6(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTransformFilter(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readTString(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readUString(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readVDict(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readVMpObj(librevenge::RVNGInputStream *input, FHCollector *collector);
-  void readXform(librevenge::RVNGInputStream *input, FHCollector *collector);
-
-  unsigned _readRecordId(librevenge::RVNGInputStream *input);
+  bool isSkipped(const RecordType *type) const;
+  void parseRecord(FHInternalStream *input, FHCollector *collector, const DictionaryEntry &entry);
+  void skipRecord(FHInternalStream *input, const LayoutStep *layout);
+  bool parseRecords(FHInternalStream *input, FHCollector *collector);
+  bool skipDamagedRecords(FHInternalStream *input, unsigned long offset);
+  bool isRecordStart(const unsigned char *data, unsigned long size, unsigned long start, bool atEnd, std::vector<unsigned short>::size_type record, unsigned count);
+  bool parseDocument(FHInternalStream *input, FHCollector *collector);
+  bool parseDocumentLazily(FHInternalStream *input, FHCollector *collector, FHInflateCache *cache);
+  bool parseDocumentInParallel(FHInternalStream *input, FHCollector *collector, FHInflateCache *cache);
+  bool decodeRecordsInParallel(const unsigned char *data, unsigned long size, FHInternalStream *input, FHCollector *collector, unsigned threads);
+  bool decodeRecordRange(const unsigned char *data, unsigned long size, FHRecordIndex::const_iterator begin, FHRecordIndex::const_iterator end, FHCollector *collector);
+  void decodeRecord(unsigned recordId) override;
+  bool indexRecords(FHInternalStream *input, FHRecordIndex &index, FHCollector *collector);
+  bool getRecordIndex(FHInternalStream *input, FHInflateCache *cache, FHRecordIndex &index);
+  std::string getRecordIndexName(FHInternalStream *input, FHInflateCache *cache) const;
+
+  void readAGDFont(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readArrowPath(FHInternalStream *input, FHCollector *collector);
+  void readAttributeHolder(FHInternalStream *input, FHCollector *collector);
+  void readBasicFill(FHInternalStream *input, FHCollector *collector);
+  void readBasicLine(FHInternalStream *input, FHCollector *collector);
+  void readBlock(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readClipGroup(FHInternalStream *input, FHCollector *collector);
+  void readColor6(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readCompositePath(FHInternalStream *input, FHCollector *collector);
+  void readConeFill(FHInternalStream *input, FHCollector *collector);
+  void readContourFill(FHInternalStream *input, FHCollector *collector);
+  void readCustomProc(FHInternalStream *input, FHCollector *collector);
+  void readDataList(FHInternalStream *input, FHCollector *collector);
+  void readData(FHInternalStream *input, FHCollector *collector);
+  void readDisplayText(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readElemPropLst(FHInternalStream *input, FHCollector *collector);
+  void readExtrusion(FHInternalStream *input, FHCollector *collector);
+  void readFHTail(FHInternalStream *input, FHCollector *collector);
+  void readFilterAttributeHolder(FHInternalStream *input, FHCollector *collector);
+  void readFWGlowFilter(FHInternalStream *input, FHCollector *collector);
+  void readFWShadowFilter(FHInternalStream *input, FHCollector *collector);
+  void readGraphicStyle(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readGroup(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readImageImport(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readLayer(FHInternalStream *input, FHCollector *collector);
+  void readLensFill(FHInternalStream *input, FHCollector *collector);
+  void readLinearFill(FHInternalStream *input, FHCollector *collector);
+  void readLinePat(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readList(FHInternalStream *input, FHCollector *collector);
+  void readMName(FHInternalStream *input, FHCollector *collector);
+  void readMString(FHInternalStream *input, FHCollector *collector);
+  void readMultiColorList(FHInternalStream *input, FHCollector *collector);
+  void readNewBlend(FHInternalStream *input, FHCollector *collector);
+  void readNewContourFill(FHInternalStream *input, FHCollector *collector);
+  void readNewRadialFill(FHInternalStream *input, FHCollector *collector);
+  void readOpacityFilter(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readOval(FHInternalStream *input, FHCollector *collector);
+  void readPantoneColor(FHInternalStream *input, FHCollector *collector);
+  void readParagraph(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readPath(FHInternalStream *input, FHCollector *collector);
+  void readPathText(FHInternalStream *input, FHCollector *collector);
+  void readPatternFill(FHInternalStream *input, FHCollector *collector);
+  void readPatternLine(FHInternalStream *input, FHCollector *collector);
+  void readPerspectiveGrid(FHInternalStream *input, FHCollector *collector);
+  void readPolygonFigure(FHInternalStream *input, FHCollector *collector);
+  void readProcessColor(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readPropLst(FHInternalStream *input, FHCollector *collector);
+  void readPSFill(FHInternalStream *input, FHCollector *collector);
+  void readPSLine(FHInternalStream *input, FHCollector *collector);
+  void readRadialFill(FHInternalStream *input, FHCollector *collector);
+  void readRadialFillX(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readRectangle(FHInternalStream *input, FHCollector *collector);
+  void readSpotColor(FHInternalStream *input, FHCollector *collector);
+  void readSpotColor6(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readStylePropLst(FHInternalStream *input, FHCollector *collector);
+  void readSwfImport(FHInternalStream *input, FHCollector *collector);
+  void readSymbolClass(FHInternalStream *input, FHCollector *collector);
+  void readSymbolInstance(FHInternalStream *input, FHCollector *collector);
+  void readTabTable(FHInternalStream *input, FHCollector *collector);
+  void readTaperedFill(FHInternalStream *input, FHCollector *collector);
+  void readTaperedFillX(FHInternalStream *input, FHCollector *collector);
+  void readTEffect(FHInternalStream *input, FHCollector *collector);
+  void readTextBlok(FHInternalStream *input, FHCollector *collector);
+  void readTextEffs(FHInternalStream *input, FHCollector *collector);
+  void readTextObject(FHInternalStream *input, FHCollector *collector);
+  void readTileFill(FHInternalStream *input, FHCollector *collector);
+  void readTintColor(FHInternalStream *input, FHCollector *collector);
+  void readTintColor6(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readTString(FHInternalStream *input, FHCollector *collector);
+  void readUString(FHInternalStream *input, FHCollector *collector);
+  void readVDict(FHInternalStream *input, FHCollector *collector);
+  void readVMpObj(FHInternalStream *input, FHCollector *collector);
+  template<VersionFamily family>
+  void readXform(FHInternalStream *input, FHCollector *collector);
+
+  unsigned _readRecordId(FHInternalStream *input);
+  void _readRecordIdArray(FHInternalStream *input, unsigned *recordIds, unsigned long count);
 
   unsigned _xformCalc(unsigned char var1, unsigned char var2);
 
-  double _readCoordinate(librevenge::RVNGInputStream *input);
-  FHRGBColor _readRGBColor(librevenge::RVNGInputStream *input);
-  FHRGBColor _readCMYKColor(librevenge::RVNGInputStream *input);
-  void _readPropLstElements(librevenge::RVNGInputStream *input, std::map<unsigned, unsigned> &properties, unsigned size);
-  void _readBlockInformation(librevenge::RVNGInputStream *input, unsigned i, unsigned &layerListId);
-  void _readFH3CharProperties(librevenge::RVNGInputStream *input, FH3CharProperties &charProps);
-  void _readFH3ParaProperties(librevenge::RVNGInputStream *input, FH3ParaProperties &paraProps);
+  double _readCoordinate(FHInternalStream *input);
+  FHRGBColor _readRGBColor(FHInternalStream *input);
+  FHRGBColor _readCMYKColor(FHInternalStream *input);
+  void _readPropLstElements(FHInternalStream *input, std::map<unsigned, unsigned> &properties, unsigned size);
+  void _readBlockInformation(FHInternalStream *input, unsigned i, unsigned &layerListId);
+  void _readFH3CharProperties(FHInternalStream *input, FH3CharProperties &charProps);
+  void _readFH3ParaProperties(FHInternalStream *input, FH3ParaProperties &paraProps);
 
   librevenge::RVNGInputStream *m_input;
   FHCollector *m_collector;
   int m_version;
-  std::map<unsigned short, int> m_dictionary;
+  // index to m_dictionaryEntries for each record type, 0 if it is not in the dictionary
+  std::vector<unsigned short> m_dictionary;
+  std::vector<DictionaryEntry> m_dictionaryEntries;
   std::vector<unsigned short> m_records;
   std::vector<unsigned short>::size_type m_currentRecord;
   FHPageInfo m_pageInfo;
   cmsHTRANSFORM m_colorTransform;
+  unsigned long m_inflateWindow;
+  std::string m_inflateCacheDir;
+  unsigned long m_inflateCacheSize;
+  bool m_inflateInBackground;
+  unsigned long m_inputLength;
+  bool m_lazyDecoding;
+  unsigned m_decodeThreads;
+  Content m_content;
+  bool m_skipDamagedRecords;
+  unsigned long m_skippedRecords;
+  // ids read that refer to no record
+  unsigned long m_invalidRecordIds;
+  // for lazy decoding
+  FHRecordIndex m_recordIndex;
+  std::vector<bool> m_decodedRecords;
+  FHInternalStream *m_lazyInput;
+  // the ids read are added to it, if not null
+  FHRecordGraph *m_recordGraph;
+  // the parser that has the dictionary and the records; this one, except
+  // in the threads that decode records
+  const FHParser *m_document;
 };
 
 } // namespace libfreehand
@@ -214,430 +214,121 @@ static double cubicBase(double t, double a, double b, double c, double d)
   return (1.0-t)*(1.0-t)*(1.0-t)*a + 3.0*(1.0-t)*(1.0-t)*t*b + 3.0*(1.0-t)*t*t*c + t*t*t*d;
 }
 
-template<typename T, typename... Args>
-std::unique_ptr<T> make_unique(Args &&... args)
-{
-  return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
-}
-
-}
-
-namespace libfreehand
-{
-
-class FHMoveToElement : public FHPathElement
-{
-public:
-  FHMoveToElement(double x, double y)
-    : m_x(x),
-      m_y(y) {}
-  ~FHMoveToElement() override {}
-  void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
-  void writeOut(std::ostream &o) const override;
-  void transform(const FHTransform &trafo) override;
-  FHPathElement *clone() override;
-  void getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const override;
-  double getX() const override
-  {
-    return m_x;
-  }
-  double getY() const override
-  {
-    return m_y;
-  }
-private:
-  double m_x;
-  double m_y;
-};
-
-class FHLineToElement : public FHPathElement
-{
-public:
-  FHLineToElement(double x, double y)
-    : m_x(x),
-      m_y(y) {}
-  ~FHLineToElement() override {}
-  void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
-  void writeOut(std::ostream &o) const override;
-  void transform(const FHTransform &trafo) override;
-  FHPathElement *clone() override;
-  void getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const override;
-  double getX() const override
-  {
-    return m_x;
-  }
-  double getY() const override
-  {
-    return m_y;
-  }
-private:
-  double m_x;
-  double m_y;
-};
-
-class FHCubicBezierToElement : public FHPathElement
-{
-public:
-  FHCubicBezierToElement(double x1, double y1, double x2, double y2, double x, double y)
-    : m_x1(x1),
-      m_y1(y1),
-      m_x2(x2),
-      m_y2(y2),
-      m_x(x),
-      m_y(y) {}
-  ~FHCubicBezierToElement() override {}
-  void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
-  void writeOut(std::ostream &o) const override;
-  void transform(const FHTransform &trafo) override;
-  FHPathElement *clone() override;
-  void getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const override;
-  double getX() const override
-  {
-    return m_x;
-  }
-  double getY() const override
-  {
-    return m_y;
-  }
-private:
-  double m_x1;
-  double m_y1;
-  double m_x2;
-  double m_y2;
-  double m_x;
-  double m_y;
-};
-
-class FHQuadraticBezierToElement : public FHPathElement
-{
-public:
-  FHQuadraticBezierToElement(double x1, double y1, double x, double y)
-    : m_x1(x1),
-      m_y1(y1),
-      m_x(x),
-      m_y(y) {}
-  ~FHQuadraticBezierToElement() override {}
-  void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
-  void writeOut(std::ostream &o) const override;
-  void transform(const FHTransform &trafo) override;
-  FHPathElement *clone() override;
-  void getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const override;
-  double getX() const override
-  {
-    return m_x;
-  }
-  double getY() const override
-  {
-    return m_y;
-  }
-private:
-  double m_x1;
-  double m_y1;
-  double m_x;
-  double m_y;
-};
-
-class FHArcToElement : public FHPathElement
-{
-public:
-  FHArcToElement(double rx, double ry, double rotation, bool largeArc, bool sweep, double x, double y)
-    : m_rx(rx),
-      m_ry(ry),
-      m_rotation(rotation),
-      m_largeArc(largeArc),
-      m_sweep(sweep),
-      m_x(x),
-      m_y(y) {}
-  ~FHArcToElement() override {}
-  void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
-  void writeOut(std::ostream &o) const override;
-  void transform(const FHTransform &trafo) override;
-  FHPathElement *clone() override;
-  void getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const override;
-  double getX() const override
-  {
-    return m_x;
-  }
-  double getY() const override
-  {
-    return m_y;
-  }
-private:
-  double m_rx;
-  double m_ry;
-  double m_rotation;
-  bool m_largeArc;
-  bool m_sweep;
-  double m_x;
-  double m_y;
-};
-
-} // namespace libfreehand
-
-
-void libfreehand::FHMoveToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
-{
-  librevenge::RVNGPropertyList node;
-  node.insert("librevenge:path-action", "M");
-  node.insert("svg:x", m_x);
-  node.insert("svg:y", m_y);
-  vec.append(node);
-}
-
-void libfreehand::FHMoveToElement::writeOut(std::ostream &o) const
-{
-  o << "M " << int(35*m_x) << " " << int(35*m_y);
-}
-
-void libfreehand::FHMoveToElement::transform(const FHTransform &trafo)
-{
-  trafo.applyToPoint(m_x,m_y);
-}
-
-libfreehand::FHPathElement *libfreehand::FHMoveToElement::clone()
-{
-  return new FHMoveToElement(m_x, m_y);
-}
-
-void libfreehand::FHMoveToElement::getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const
-{
-  if (x0 < xmin) xmin = x0;
-  if (m_x < xmin) xmin = m_x;
-
-  if (y0 < ymin) ymin = y0;
-  if (m_y < ymin) ymin = m_y;
-
-  if (x0 > xmax) xmax = x0;
-  if (m_x > xmax) xmax = m_x;
-
-  if (y0 > ymax) ymax = y0;
-  if (m_y > ymax) ymax = m_y;
-}
-
-void libfreehand::FHLineToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
-{
-  librevenge::RVNGPropertyList node;
-  node.insert("librevenge:path-action", "L");
-  node.insert("svg:x", m_x);
-  node.insert("svg:y", m_y);
-  vec.append(node);
-}
-
-void libfreehand::FHLineToElement::writeOut(std::ostream &o) const
-{
-  o << "L " << int(35*m_x) << " " << int(35*m_y);
-}
-
-void libfreehand::FHLineToElement::transform(const FHTransform &trafo)
-{
-  trafo.applyToPoint(m_x,m_y);
-}
-
-libfreehand::FHPathElement *libfreehand::FHLineToElement::clone()
-{
-  return new FHLineToElement(m_x, m_y);
-}
-
-void libfreehand::FHLineToElement::getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const
-{
-  if (x0 < xmin) xmin = x0;
-  if (m_x < xmin) xmin = m_x;
-
-  if (y0 < ymin) ymin = y0;
-  if (m_y < ymin) ymin = m_y;
-
-  if (x0 > xmax) xmax = x0;
-  if (m_x > xmax) xmax = m_x;
-
-  if (y0 > ymax) ymax = y0;
-  if (m_y > ymax) ymax = m_y;
-}
-
-void libfreehand::FHCubicBezierToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
-{
-  librevenge::RVNGPropertyList node;
-  node.insert("librevenge:path-action", "C");
-  node.insert("svg:x1", m_x1);
-  node.insert("svg:y1", m_y1);
-  node.insert("svg:x2", m_x2);
-  node.insert("svg:y2", m_y2);
-  node.insert("svg:x", m_x);
-  node.insert("svg:y", m_y);
-  vec.append(node);
-}
-
-void libfreehand::FHCubicBezierToElement::writeOut(std::ostream &o) const
-{
-  o << "C " << int(35*m_x1) << " " << int(35*m_y1) << " "
-    << int(35*m_x2) << " " << int(35*m_y2) << " " << int(35*m_x) << " " << int(35*m_y);
-}
-
-void libfreehand::FHCubicBezierToElement::transform(const FHTransform &trafo)
-{
-  trafo.applyToPoint(m_x1,m_y1);
-  trafo.applyToPoint(m_x2,m_y2);
-  trafo.applyToPoint(m_x,m_y);
-}
-
-libfreehand::FHPathElement *libfreehand::FHCubicBezierToElement::clone()
-{
-  return new FHCubicBezierToElement(m_x1, m_y1, m_x2, m_y2, m_x, m_y);
-}
-
-void libfreehand::FHCubicBezierToElement::getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const
+static void getCubicBezierBBox(double x0, double y0, double x1, double y1, double x2, double y2, double x, double y,
+                               double &xmin, double &ymin, double &xmax, double &ymax)
 {
   if (x0 < xmin) xmin = x0;
-  if (m_x < xmin) xmin = m_x;
+  if (x < xmin) xmin = x;
 
   if (y0 < ymin) ymin = y0;
-  if (m_y < ymin) ymin = m_y;
+  if (y < ymin) ymin = y;
 
   if (x0 > xmax) xmax = x0;
-  if (m_x > xmax) xmax = m_x;
+  if (x > xmax) xmax = x;
 
   if (y0 > ymax) ymax = y0;
-  if (m_y > ymax) ymax = m_y;
+  if (y > ymax) ymax = y;
 
   for (int i=0; i<=100; ++i)
   {
     double t=double(i)/100.;
-    double tmpx = cubicBase(t, x0, m_x1, m_x2, m_x);
+    double tmpx = cubicBase(t, x0, x1, x2, x);
     if (tmpx < xmin) xmin = tmpx;
     if (tmpx > xmax) xmax = tmpx;
-    double tmpy = cubicBase(t, y0, m_y1, m_y2, m_y);
+    double tmpy = cubicBase(t, y0, y1, y2, y);
     if (tmpy < ymin) ymin = tmpy;
     if (tmpy > ymax) ymax = tmpy;
   }
 }
 
-void libfreehand::FHQuadraticBezierToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
-{
-  librevenge::RVNGPropertyList node;
-  node.insert("librevenge:path-action", "Q");
-  node.insert("svg:x1", m_x1);
-  node.insert("svg:y1", m_y1);
-  node.insert("svg:x", m_x);
-  node.insert("svg:y", m_y);
-  vec.append(node);
-}
-
-void libfreehand::FHQuadraticBezierToElement::writeOut(std::ostream &o) const
-{
-  o << "Q " << int(35*m_x1) << " " << int(35*m_y1) << " " << int(35*m_x) << " " << int(35*m_y);
-}
-
-void libfreehand::FHQuadraticBezierToElement::transform(const FHTransform &trafo)
-{
-  trafo.applyToPoint(m_x1,m_y1);
-  trafo.applyToPoint(m_x,m_y);
-}
-
-libfreehand::FHPathElement *libfreehand::FHQuadraticBezierToElement::clone()
-{
-  return new FHQuadraticBezierToElement(m_x1, m_y1, m_x, m_y);
-}
-
-void libfreehand::FHQuadraticBezierToElement::getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const
+static void getQuadraticBezierBBox(double x0, double y0, double x1, double y1, double x, double y,
+                                   double &xmin, double &ymin, double &xmax, double &ymax)
 {
   if (x0 < xmin) xmin = x0;
-  if (m_x < xmin) xmin = m_x;
+  if (x < xmin) xmin = x;
 
   if (y0 < ymin) ymin = y0;
-  if (m_y < ymin) ymin = m_y;
+  if (y < ymin) ymin = y;
 
   if (x0 > xmax) xmax = x0;
-  if (m_x > xmax) xmax = m_x;
+  if (x > xmax) xmax = x;
 
   if (y0 > ymax) ymax = y0;
-  if (m_y > ymax) ymax = m_y;
+  if (y > ymax) ymax = y;
 
-  double t = quadraticDerivative(x0, m_x1, m_x);
+  double t = quadraticDerivative(x0, x1, x);
   if (t>=0 && t<=1)
   {
-    double tmpx = quadraticExtreme(t, x0, m_x1, m_x);
+    double tmpx = quadraticExtreme(t, x0, x1, x);
     if (xmin > tmpx) xmin = tmpx;
     if (xmax < tmpx) xmax = tmpx;
   }
 
-  t = quadraticDerivative(y0, m_y1, m_y);
+  t = quadraticDerivative(y0, y1, y);
   if (t>=0 && t<=1)
   {
-    double tmpy = quadraticExtreme(t, y0, m_y1, m_y);
+    double tmpy = quadraticExtreme(t, y0, y1, y);
     if (ymin > tmpy) ymin = tmpy;
     if (ymax < tmpy) ymax = tmpy;
   }
 }
 
-void libfreehand::FHArcToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
-{
-  librevenge::RVNGPropertyList node;
-  node.insert("librevenge:path-action", "A");
-  node.insert("svg:rx", m_rx);
-  node.insert("svg:ry", m_ry);
-  node.insert("librevenge:rotate", m_rotation * 180 / M_PI, librevenge::RVNG_GENERIC);
-  node.insert("librevenge:large-arc", m_largeArc);
-  node.insert("librevenge:sweep", m_sweep);
-  node.insert("svg:x", m_x);
-  node.insert("svg:y", m_y);
-  vec.append(node);
 }
 
-void libfreehand::FHArcToElement::writeOut(std::ostream &o) const
+unsigned libfreehand::FHPath::getCoordCount(unsigned char type)
 {
-  o << "A " << int(35*m_rx) << " " << int(35*m_ry) << " "
-    << int(m_rotation * 180 / M_PI) << " " << m_largeArc << " " << m_sweep << " "
-    << int(35*m_x) << " " << int(35*m_y);
-}
-
-void libfreehand::FHArcToElement::transform(const FHTransform &trafo)
-{
-  trafo.applyToArc(m_rx, m_ry, m_rotation, m_sweep, m_x, m_y);
+  switch (type)
+  {
+  case ELEMENT_CUBIC_BEZIER_TO:
+    return 6;
+  case ELEMENT_QUADRATIC_BEZIER_TO:
+    return 4;
+  case ELEMENT_ARC_TO:
+    return 7;
+  default:
+    return 2;
+  }
 }
 
-libfreehand::FHPathElement *libfreehand::FHArcToElement::clone()
+void libfreehand::FHPath::reserve(unsigned long count)
 {
-  return new FHArcToElement(m_rx, m_ry, m_rotation, m_largeArc, m_sweep, m_x, m_y);
-}
-
-void libfreehand::FHArcToElement::getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const
-{
-  double tmpXMin = m_x < x0 ? m_x : x0;
-  double tmpXMax = m_x > x0 ? m_x : x0;
-  double tmpYMin = m_y < y0 ? m_y : y0;
-  double tmpYMax = m_y > y0 ? m_y : y0;
-
-  getEllipticalArcBBox(x0, y0, m_rx, m_ry, m_rotation, m_largeArc, m_sweep, m_x, m_y, tmpXMin, tmpYMin, tmpXMax, tmpYMax);
-
-  if (tmpXMin < xmin) xmin = tmpXMin;
-  if (tmpXMax > xmax) xmax = tmpXMax;
-
-  if (tmpYMin < ymin) ymin = tmpYMin;
-  if (tmpYMax > ymax) ymax = tmpYMax;
+  m_types.reserve(m_types.size() + count);
+  m_coords.reserve(m_coords.size() + 6 * count);
 }
 
 void libfreehand::FHPath::appendMoveTo(double x, double y)
 {
-  m_elements.push_back(make_unique<libfreehand::FHMoveToElement>(x, y));
+  m_types.push_back(ELEMENT_MOVE_TO);
+  m_coords.push_back(x);
+  m_coords.push_back(y);
 }
 
 void libfreehand::FHPath::appendLineTo(double x, double y)
 {
-  m_elements.push_back(make_unique<libfreehand::FHLineToElement>(x, y));
+  m_types.push_back(ELEMENT_LINE_TO);
+  m_coords.push_back(x);
+  m_coords.push_back(y);
 }
 
 void libfreehand::FHPath::appendCubicBezierTo(double x1, double y1, double x2, double y2, double x, double y)
 {
-  m_elements.push_back(make_unique<libfreehand::FHCubicBezierToElement>(x1, y1, x2, y2, x, y));
+  m_types.push_back(ELEMENT_CUBIC_BEZIER_TO);
+  const double coords[] = { x1, y1, x2, y2, x, y };
+  m_coords.insert(m_coords.end(), coords, coords + 6);
 }
 
 void libfreehand::FHPath::appendQuadraticBezierTo(double x1, double y1, double x, double y)
 {
-  m_elements.push_back(make_unique<libfreehand::FHQuadraticBezierToElement>(x1, y1, x, y));
+  m_types.push_back(ELEMENT_QUADRATIC_BEZIER_TO);
+  const double coords[] = { x1, y1, x, y };
+  m_coords.insert(m_coords.end(), coords, coords + 4);
 }
 
 void libfreehand::FHPath::appendArcTo(double rx, double ry, double rotation, bool longAngle, bool sweep, double x, double y)
 {
-  m_elements.push_back(make_unique<libfreehand::FHArcToElement>(rx, ry, rotation, longAngle, sweep, x, y));
+  m_types.push_back(ELEMENT_ARC_TO);
+  const double coords[] = { rx, ry, rotation, longAngle ? 1.0 : 0.0, sweep ? 1.0 : 0.0, x, y };
+  m_coords.insert(m_coords.end(), coords, coords + 7);
 }
 
 void libfreehand::FHPath::appendClosePath()
@@ -646,10 +337,9 @@ void libfreehand::FHPath::appendClosePath()
 }
 
 libfreehand::FHPath::FHPath(const libfreehand::FHPath &path)
-  : m_elements(), m_isClosed(path.m_isClosed), m_xFormId(path.m_xFormId),
+  : m_types(path.m_types), m_coords(path.m_coords), m_isClosed(path.m_isClosed), m_xFormId(path.m_xFormId),
     m_graphicStyleId(path.m_graphicStyleId), m_evenOdd(path.m_evenOdd)
 {
-  appendPath(path);
 }
 
 libfreehand::FHPath &libfreehand::FHPath::operator=(const libfreehand::FHPath &path)
@@ -657,8 +347,8 @@ libfreehand::FHPath &libfreehand::FHPath::operator=(const libfreehand::FHPath &p
   // Check for self-assignment
   if (this == &path)
     return *this;
-  clear();
-  appendPath(path);
+  m_types = path.m_types;
+  m_coords = path.m_coords;
   m_isClosed = path.m_isClosed;
   m_xFormId = path.m_xFormId;
   m_graphicStyleId = path.m_graphicStyleId;
@@ -668,8 +358,8 @@ libfreehand::FHPath &libfreehand::FHPath::operator=(const libfreehand::FHPath &p
 
 void libfreehand::FHPath::appendPath(const FHPath &path)
 {
-  for (const auto &element : path.m_elements)
-    m_elements.push_back(std::unique_ptr<FHPathElement>(element->clone()));
+  m_types.insert(m_types.end(), path.m_types.begin(), path.m_types.end());
+  m_coords.insert(m_coords.end(), path.m_coords.begin(), path.m_coords.end());
 }
 
 libfreehand::FHPath::~FHPath()
@@ -693,27 +383,108 @@ void libfreehand::FHPath::setEvenOdd(bool evenOdd)
 
 void libfreehand::FHPath::writeOut(librevenge::RVNGPropertyListVector &vec) const
 {
-  for (const auto &element : m_elements)
-    element->writeOut(vec);
+  const double *c = m_coords.data();
+  for (unsigned char type : m_types)
+  {
+    librevenge::RVNGPropertyList node;
+    switch (type)
+    {
+    case ELEMENT_MOVE_TO:
+      node.insert("librevenge:path-action", "M");
+      break;
+    case ELEMENT_LINE_TO:
+      node.insert("librevenge:path-action", "L");
+      break;
+    case ELEMENT_CUBIC_BEZIER_TO:
+      node.insert("librevenge:path-action", "C");
+      node.insert("svg:x1", c[0]);
+      node.insert("svg:y1", c[1]);
+      node.insert("svg:x2", c[2]);
+      node.insert("svg:y2", c[3]);
+      break;
+    case ELEMENT_QUADRATIC_BEZIER_TO:
+      node.insert("librevenge:path-action", "Q");
+      node.insert("svg:x1", c[0]);
+      node.insert("svg:y1", c[1]);
+      break;
+    case ELEMENT_ARC_TO:
+      node.insert("librevenge:path-action", "A");
+      node.insert("svg:rx", c[0]);
+      node.insert("svg:ry", c[1]);
+      node.insert("librevenge:rotate", c[2] * 180 / M_PI, librevenge::RVNG_GENERIC);
+      node.insert("librevenge:large-arc", c[3] != 0.0);
+      node.insert("librevenge:sweep", c[4] != 0.0);
+      break;
+    default:
+      break;
+    }
+    const unsigned count = getCoordCount(type);
+    node.insert("svg:x", c[count - 2]);
+    node.insert("svg:y", c[count - 1]);
+    vec.append(node);
+    c += count;
+  }
 }
 
 std::string libfreehand::FHPath::getPathString() const
 {
   std::stringstream s;
-  for (const auto &element : m_elements)
-    element->writeOut(s);
+  const double *c = m_coords.data();
+  for (unsigned char type : m_types)
+  {
+    switch (type)
+    {
+    case ELEMENT_MOVE_TO:
+      s << "M " << int(35*c[0]) << " " << int(35*c[1]);
+      break;
+    case ELEMENT_LINE_TO:
+      s << "L " << int(35*c[0]) << " " << int(35*c[1]);
+      break;
+    case ELEMENT_CUBIC_BEZIER_TO:
+      s << "C " << int(35*c[0]) << " " << int(35*c[1]) << " "
+        << int(35*c[2]) << " " << int(35*c[3]) << " " << int(35*c[4]) << " " << int(35*c[5]);
+      break;
+    case ELEMENT_QUADRATIC_BEZIER_TO:
+      s << "Q " << int(35*c[0]) << " " << int(35*c[1]) << " " << int(35*c[2]) << " " << int(35*c[3]);
+      break;
+    case ELEMENT_ARC_TO:
+      s << "A " << int(35*c[0]) << " " << int(35*c[1]) << " "
+        << int(c[2] * 180 / M_PI) << " " << (c[3] != 0.0) << " " << (c[4] != 0.0) << " "
+        << int(35*c[5]) << " " << int(35*c[6]);
+      break;
+    default:
+      break;
+    }
+    c += getCoordCount(type);
+  }
   return s.str();
 }
 
 void libfreehand::FHPath::transform(const FHTransform &trafo)
 {
-  for (const auto &element : m_elements)
-    element->transform(trafo);
+  double *c = m_coords.data();
+  for (unsigned char type : m_types)
+  {
+    const unsigned count = getCoordCount(type);
+    if (type == ELEMENT_ARC_TO)
+    {
+      bool sweep = c[4] != 0.0;
+      trafo.applyToArc(c[0], c[1], c[2], sweep, c[5], c[6]);
+      c[4] = sweep ? 1.0 : 0.0;
+    }
+    else
+    {
+      for (unsigned i = 0; i < count; i += 2)
+        trafo.applyToPoint(c[i], c[i + 1]);
+    }
+    c += count;
+  }
 }
 
 void libfreehand::FHPath::clear()
 {
-  m_elements.clear();
+  m_types.clear();
+  m_coords.clear();
   m_isClosed = false;
   m_xFormId = 0;
   m_graphicStyleId = 0;
@@ -721,7 +492,7 @@ void libfreehand::FHPath::clear()
 
 bool libfreehand::FHPath::empty() const
 {
-  return m_elements.empty();
+  return m_types.empty();
 }
 
 bool libfreehand::FHPath::isClosed() const
@@ -733,14 +504,14 @@ double libfreehand::FHPath::getX() const
 {
   if (empty())
     return 0.0;
-  return m_elements.back()->getX();
+  return m_coords[m_coords.size() - 2];
 }
 
 double libfreehand::FHPath::getY() const
 {
   if (empty())
     return 0.0;
-  return m_elements.back()->getY();
+  return m_coords.back();
 }
 
 unsigned libfreehand::FHPath::getXFormId() const
@@ -760,10 +531,12 @@ bool libfreehand::FHPath::getEvenOdd() const
 
 void libfreehand::FHPath::getBoundingBox(double x0, double y0, double &xmin, double &ymin, double &xmax, double &ymax) const
 {
-  for (const auto &element : m_elements)
+  const double *c = m_coords.data();
+  for (unsigned char type : m_types)
   {
-    double x = element->getX();
-    double y = element->getY();
+    const unsigned count = getCoordCount(type);
+    double x = c[count - 2];
+    double y = c[count - 1];
 
     if (x0 < xmin) xmin = x0;
     if (x < xmin) xmin = x;
@@ -777,21 +550,48 @@ void libfreehand::FHPath::getBoundingBox(double x0, double y0, double &xmin, dou
     if (y0 > ymax) ymax = y0;
     if (y > ymax) ymax = y;
 
-    element->getBoundingBox(x0, y0, xmin, ymin, xmax, ymax);
-    x0 = element->getX();
-    y0 = element->getY();
+    switch (type)
+    {
+    case ELEMENT_CUBIC_BEZIER_TO:
+      getCubicBezierBBox(x0, y0, c[0], c[1], c[2], c[3], x, y, xmin, ymin, xmax, ymax);
+      break;
+    case ELEMENT_QUADRATIC_BEZIER_TO:
+      getQuadraticBezierBBox(x0, y0, c[0], c[1], x, y, xmin, ymin, xmax, ymax);
+      break;
+    case ELEMENT_ARC_TO:
+    {
+      double tmpXMin = x < x0 ? x : x0;
+      double tmpXMax = x > x0 ? x : x0;
+      double tmpYMin = y < y0 ? y : y0;
+      double tmpYMax = y > y0 ? y : y0;
+
+      getEllipticalArcBBox(x0, y0, c[0], c[1], c[2], c[3] != 0.0, c[4] != 0.0, x, y, tmpXMin, tmpYMin, tmpXMax, tmpYMax);
+
+      if (tmpXMin < xmin) xmin = tmpXMin;
+      if (tmpXMax > xmax) xmax = tmpXMax;
+
+      if (tmpYMin < ymin) ymin = tmpYMin;
+      if (tmpYMax > ymax) ymax = tmpYMax;
+      break;
+    }
+    default:
+      break;
+    }
+    x0 = x;
+    y0 = y;
+    c += count;
   }
 }
 
 void libfreehand::FHPath::getBoundingBox(double &xmin, double &ymin, double &xmax, double &ymax) const
 {
-  if (m_elements.empty())
+  if (m_types.empty())
   {
     FH_DEBUG_MSG(("libfreehand::FHPath::getBoundingBox: get an empty path\n"));
     return;
   }
-  double x0 = m_elements[0]->getX();
-  double y0 = m_elements[0]->getY();
+  double x0 = m_coords[getCoordCount(m_types[0]) - 2];
+  double y0 = m_coords[getCoordCount(m_types[0]) - 1];
   xmin = xmax = x0;
   ymin = ymax = y0;
   getBoundingBox(x0, y0, xmin, ymin, xmax, ymax);
@@ -10,9 +10,8 @@
 #ifndef __FHPATH_H__
 #define __FHPATH_H__
 
-#include <memory>
+#include <string>
 #include <vector>
-#include <ostream>
 
 #include <librevenge/librevenge.h>
 
@@ -21,30 +20,21 @@ namespace libfreehand
 
 struct FHTransform;
 
-class FHPathElement
-{
-public:
-  FHPathElement() {}
-  virtual ~FHPathElement() {}
-  virtual void writeOut(librevenge::RVNGPropertyListVector &vec) const = 0;
-  virtual void writeOut(std::ostream &s) const = 0;
-  virtual void transform(const FHTransform &trafo) = 0;
-  virtual FHPathElement *clone() = 0;
-  virtual void getBoundingBox(double x0, double y0, double &px, double &py, double &qx, double &qy) const = 0;
-  virtual double getX() const = 0;
-  virtual double getY() const = 0;
-};
-
-
+/* The elements of a path are kept as their types and, separately, all
+ * their coordinates in a row, so that appending one does not allocate
+ * anything once enough space has been reserved.
+ */
 class FHPath
 {
 public:
-  FHPath() : m_elements(), m_isClosed(false), m_xFormId(0), m_graphicStyleId(0), m_evenOdd(false) {}
+  FHPath() : m_types(), m_coords(), m_isClosed(false), m_xFormId(0), m_graphicStyleId(0), m_evenOdd(false) {}
   FHPath(const FHPath &path);
   ~FHPath();
 
   FHPath &operator=(const FHPath &path);
 
+  // Makes room for count elements of any type but arcs
+  void reserve(unsigned long count);
   void appendMoveTo(double x, double y);
   void appendLineTo(double x, double y);
   void appendCubicBezierTo(double x1, double y1, double x2, double y2, double x, double y);
@@ -72,7 +62,19 @@ public:
   void getBoundingBox(double &xmin, double &ymin, double &xmax, double &ymax) const;
 
 private:
-  std::vector<std::unique_ptr<FHPathElement>> m_elements;
+  enum ElementType
+  {
+    ELEMENT_MOVE_TO,
+    ELEMENT_LINE_TO,
+    ELEMENT_CUBIC_BEZIER_TO,
+    ELEMENT_QUADRATIC_BEZIER_TO,
+    ELEMENT_ARC_TO // rx, ry, rotation, large arc and sweep before the end point
+  };
+
+  static unsigned getCoordCount(unsigned char type);
+
+  std::vector<unsigned char> m_types;
+  std::vector<double> m_coords; // every element ends with its end point
   bool m_isClosed;
   unsigned m_xFormId;
   unsigned m_graphicStyleId;
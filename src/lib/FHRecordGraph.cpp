@@ -0,0 +1,149 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "FHRecordGraph.h"
+
+libfreehand::FHRecordGraph::FHRecordGraph()
+  : m_recordCount(0), m_current(0), m_inTail(false), m_offsets(2, 0), m_targets(), m_tailTargets(),
+    m_types(1, nullptr), m_sizes(1, 0), m_reachable(1, true)
+{
+}
+
+void libfreehand::FHRecordGraph::clear()
+{
+  reset(0);
+  finish();
+}
+
+void libfreehand::FHRecordGraph::reset(unsigned recordCount)
+{
+  m_recordCount = recordCount;
+  m_current = 0;
+  m_inTail = false;
+  m_offsets.assign(recordCount + 2, 0);
+  m_targets.clear();
+  m_tailTargets.clear();
+  m_types.assign(recordCount + 1, nullptr);
+  m_sizes.assign(recordCount + 1, 0);
+  m_reachable.assign(recordCount + 1, false);
+}
+
+void libfreehand::FHRecordGraph::startRecord(unsigned record, const char *type)
+{
+  if (!record || record > m_recordCount)
+    return;
+  if (record <= m_current)
+  {
+    m_targets.resize(m_offsets[record]);
+    for (unsigned i = record + 1; i <= m_current; ++i)
+    {
+      m_types[i] = nullptr;
+      m_sizes[i] = 0;
+    }
+  }
+  else
+  {
+    for (unsigned i = m_current + 1; i <= record; ++i)
+      m_offsets[i] = unsigned(m_targets.size());
+  }
+  m_current = record;
+  m_inTail = false;
+  m_types[record] = type;
+  m_sizes[record] = 0;
+}
+
+void libfreehand::FHRecordGraph::startTail()
+{
+  m_tailTargets.clear();
+  m_inTail = true;
+}
+
+void libfreehand::FHRecordGraph::addReference(unsigned target)
+{
+  if (!target || target > m_recordCount)
+    return;
+  if (m_inTail)
+    m_tailTargets.push_back(target);
+  else if (m_current)
+    m_targets.push_back(target);
+}
+
+void libfreehand::FHRecordGraph::setRecordSize(unsigned record, unsigned long size)
+{
+  if (record && record <= m_recordCount)
+    m_sizes[record] = size;
+}
+
+void libfreehand::FHRecordGraph::finish()
+{
+  for (unsigned i = m_current + 1; i <= m_recordCount + 1; ++i)
+    m_offsets[i] = unsigned(m_targets.size());
+  m_current = m_recordCount;
+  m_inTail = false;
+
+  // The tail comes last in the document, but first here
+  const unsigned tailCount = unsigned(m_tailTargets.size());
+  m_targets.insert(m_targets.begin(), m_tailTargets.begin(), m_tailTargets.end());
+  m_tailTargets.clear();
+  for (unsigned i = 1; i <= m_recordCount + 1; ++i)
+    m_offsets[i] += tailCount;
+
+  m_reachable.assign(m_recordCount + 1, false);
+  m_reachable[0] = true;
+  std::vector<unsigned> pending(1, 0);
+  while (!pending.empty())
+  {
+    const unsigned record = pending.back();
+    pending.pop_back();
+    for (unsigned i = m_offsets[record]; i < m_offsets[record + 1]; ++i)
+    {
+      if (!m_reachable[m_targets[i]])
+      {
+        m_reachable[m_targets[i]] = true;
+        pending.push_back(m_targets[i]);
+      }
+    }
+  }
+}
+
+const char *libfreehand::FHRecordGraph::getRecordType(unsigned record) const
+{
+  return record <= m_recordCount ? m_types[record] : nullptr;
+}
+
+unsigned long libfreehand::FHRecordGraph::getRecordSize(unsigned record) const
+{
+  return record <= m_recordCount ? m_sizes[record] : 0;
+}
+
+const unsigned *libfreehand::FHRecordGraph::getReferences(unsigned record, unsigned &count) const
+{
+  count = 0;
+  if (record > m_recordCount)
+    return nullptr;
+  count = m_offsets[record + 1] - m_offsets[record];
+  return count ? &m_targets[m_offsets[record]] : nullptr;
+}
+
+bool libfreehand::FHRecordGraph::isReachable(unsigned record) const
+{
+  return record <= m_recordCount && m_reachable[record];
+}
+
+const unsigned *libfreehand::FHRecordGraph::getOffsets() const
+{
+  return &m_offsets[0];
+}
+
+const unsigned *libfreehand::FHRecordGraph::getTargets() const
+{
+  return m_targets.empty() ? nullptr : &m_targets[0];
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
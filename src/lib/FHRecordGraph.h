@@ -0,0 +1,68 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FHRECORDGRAPH_H__
+#define __FHRECORDGRAPH_H__
+
+#include <vector>
+
+namespace libfreehand
+{
+
+/* The records of a document and the ids each of them reads, as one array
+ * of references with the offsets of every record's references in it.
+ * Record 0 is the tail, from which the drawing is found.
+ *
+ * The references are added while the records are read, in order. A
+ * record can be started again, e.g. after damaged records were skipped,
+ * which drops what was added for it and for the records after it.
+ */
+class FHRecordGraph
+{
+public:
+  FHRecordGraph();
+
+  void clear();
+  void reset(unsigned recordCount);
+  void startRecord(unsigned record, const char *type);
+  void startTail();
+  // Ids of no record, like 0, are left out
+  void addReference(unsigned target);
+  void setRecordSize(unsigned record, unsigned long size);
+  // Makes the offsets complete and finds what the tail leads to
+  void finish();
+
+  unsigned getRecordCount() const
+  {
+    return m_recordCount;
+  }
+  const char *getRecordType(unsigned record) const;
+  unsigned long getRecordSize(unsigned record) const;
+  const unsigned *getReferences(unsigned record, unsigned &count) const;
+  bool isReachable(unsigned record) const;
+  // getRecordCount() + 2 offsets into getTargets()
+  const unsigned *getOffsets() const;
+  const unsigned *getTargets() const;
+
+private:
+  unsigned m_recordCount;
+  unsigned m_current; // the record references are added to
+  bool m_inTail;
+  std::vector<unsigned> m_offsets;
+  std::vector<unsigned> m_targets;
+  std::vector<unsigned> m_tailTargets;
+  std::vector<const char *> m_types;
+  std::vector<unsigned long> m_sizes;
+  std::vector<bool> m_reachable;
+};
+
+} // namespace libfreehand
+
+#endif /* __FHRECORDGRAPH_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,138 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "FHRecordIndex.h"
+
+#include <algorithm>
+
+#include "FHBigEndianCursor.h"
+
+namespace
+{
+
+// "FHRI" and the version of the format
+const uint32_t INDEX_MAGIC = 0x46485249;
+const uint32_t INDEX_VERSION = 1;
+
+const unsigned long HEADER_SIZE = 16;
+const unsigned long ENTRY_SIZE = 14;
+
+void putU16(std::vector<unsigned char> &data, unsigned value)
+{
+  data.push_back((unsigned char)(value >> 8));
+  data.push_back((unsigned char)value);
+}
+
+void putU32(std::vector<unsigned char> &data, unsigned long value)
+{
+  putU16(data, (unsigned)(value >> 16) & 0xffff);
+  putU16(data, (unsigned)value & 0xffff);
+}
+
+bool compareRecord(const libfreehand::FHRecordIndexEntry &entry, unsigned record)
+{
+  return entry.m_record < record;
+}
+
+bool compareRecordAfter(unsigned record, const libfreehand::FHRecordIndexEntry &entry)
+{
+  return record < entry.m_record;
+}
+
+}
+
+libfreehand::FHRecordIndex::FHRecordIndex()
+  : m_entries(), m_tailOffset(0)
+{
+}
+
+void libfreehand::FHRecordIndex::clear()
+{
+  m_entries.clear();
+  m_tailOffset = 0;
+}
+
+void libfreehand::FHRecordIndex::reserve(unsigned long count)
+{
+  m_entries.reserve(count);
+}
+
+void libfreehand::FHRecordIndex::append(unsigned record, unsigned short token, unsigned long offset, unsigned long length)
+{
+  m_entries.push_back(FHRecordIndexEntry(record, token, (unsigned)offset, (unsigned)length));
+}
+
+void libfreehand::FHRecordIndex::setTailOffset(unsigned long offset)
+{
+  m_tailOffset = offset;
+}
+
+void libfreehand::FHRecordIndex::removeAfter(unsigned record)
+{
+  m_entries.erase(std::upper_bound(m_entries.begin(), m_entries.end(), record, compareRecordAfter), m_entries.end());
+}
+
+const libfreehand::FHRecordIndexEntry *libfreehand::FHRecordIndex::find(unsigned record) const
+{
+  const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), record, compareRecord);
+  if (it == m_entries.end() || it->m_record != record)
+    return nullptr;
+  return &*it;
+}
+
+void libfreehand::FHRecordIndex::write(std::vector<unsigned char> &data) const
+{
+  data.clear();
+  data.reserve(HEADER_SIZE + m_entries.size() * ENTRY_SIZE);
+  putU32(data, INDEX_MAGIC);
+  putU32(data, INDEX_VERSION);
+  putU32(data, m_entries.size());
+  putU32(data, m_tailOffset);
+  for (const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+  {
+    putU32(data, it->m_record);
+    putU16(data, it->m_token);
+    putU32(data, it->m_offset);
+    putU32(data, it->m_length);
+  }
+}
+
+bool libfreehand::FHRecordIndex::read(const unsigned char *data, unsigned long size)
+{
+  clear();
+  FHBigEndianCursor cursor(data, size);
+  if (cursor.readU32() != INDEX_MAGIC || cursor.readU32() != INDEX_VERSION)
+    return false;
+  const unsigned long count = cursor.readU32();
+  m_tailOffset = cursor.readU32();
+  if (cursor.hasFailed() || cursor.getRemaining() / ENTRY_SIZE < count)
+  {
+    clear();
+    return false;
+  }
+
+  m_entries.reserve(count);
+  for (unsigned long i = 0; i < count; ++i)
+  {
+    const unsigned record = cursor.readU32();
+    const unsigned short token = cursor.readU16();
+    const unsigned offset = cursor.readU32();
+    const unsigned length = cursor.readU32();
+    // keep find() working on whatever we are given
+    if (!m_entries.empty() && m_entries.back().m_record >= record)
+    {
+      clear();
+      return false;
+    }
+    m_entries.push_back(FHRecordIndexEntry(record, token, offset, length));
+  }
+  return true;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,82 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FHRECORDINDEX_H__
+#define __FHRECORDINDEX_H__
+
+#include <vector>
+
+#include "libfreehand_utils.h"
+
+namespace libfreehand
+{
+
+struct FHRecordIndexEntry
+{
+  FHRecordIndexEntry(unsigned record, unsigned short token, unsigned offset, unsigned length)
+    : m_record(record), m_offset(offset), m_length(length), m_token(token) {}
+  uint32_t m_record; // the record id, as used by the collector
+  uint32_t m_offset; // in the document content
+  uint32_t m_length;
+  uint16_t m_token;
+};
+
+/* Where each record of a document's content starts and how long it is,
+ * in record order. Records that take no space (e.g. ones missing from
+ * the dictionary) are not listed.
+ */
+class FHRecordIndex
+{
+public:
+  typedef std::vector<FHRecordIndexEntry>::const_iterator const_iterator;
+
+  FHRecordIndex();
+
+  void clear();
+  void reserve(unsigned long count);
+  void append(unsigned record, unsigned short token, unsigned long offset, unsigned long length);
+  void setTailOffset(unsigned long offset);
+  // Removes the entries of the records after record
+  void removeAfter(unsigned record);
+
+  const FHRecordIndexEntry *find(unsigned record) const;
+  unsigned long getTailOffset() const
+  {
+    return m_tailOffset;
+  }
+  unsigned long size() const
+  {
+    return m_entries.size();
+  }
+  bool empty() const
+  {
+    return m_entries.empty();
+  }
+  const_iterator begin() const
+  {
+    return m_entries.begin();
+  }
+  const_iterator end() const
+  {
+    return m_entries.end();
+  }
+
+  // A portable form of the index, to be stored along with the document
+  void write(std::vector<unsigned char> &data) const;
+  bool read(const unsigned char *data, unsigned long size);
+
+private:
+  std::vector<FHRecordIndexEntry> m_entries;
+  unsigned long m_tailOffset;
+};
+
+} // namespace libfreehand
+
+#endif /* __FHRECORDINDEX_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,178 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "FHSpoolStream.h"
+
+#include <limits>
+
+#include "libfreehand_utils.h"
+
+#define CHUNK 65536
+
+namespace
+{
+
+// Offsets are longs in tell(), seek() and fseek(), which may have 32 bits
+const unsigned long MAX_SIZE = (unsigned long)std::numeric_limits<long>::max();
+
+}
+
+libfreehand::FHSpoolStream::FHSpoolStream(librevenge::RVNGInputStream *input, unsigned long memoryLimit) :
+  librevenge::RVNGInputStream(),
+  m_buffer(),
+  m_file(nullptr),
+  m_size(0),
+  m_offset(0)
+{
+  if (!input)
+    return;
+
+  while (!input->isEnd())
+  {
+    unsigned long numBytesRead = 0;
+    const unsigned char *data = input->read(CHUNK, numBytesRead);
+    if (!data || !numBytesRead)
+      break;
+    if (numBytesRead > MAX_SIZE - m_size)
+    {
+      // Only a part would be reachable, so keep nothing
+      FH_DEBUG_MSG(("FHSpoolStream::FHSpoolStream - the input is too large\n"));
+      if (m_file)
+        std::fclose(m_file);
+      m_file = nullptr;
+      m_buffer.clear();
+      m_size = 0;
+      return;
+    }
+    append(data, numBytesRead, memoryLimit);
+  }
+
+  if (m_file)
+  {
+    // the buffer is only used for reading from now
+    m_buffer.clear();
+    std::fflush(m_file);
+  }
+}
+
+libfreehand::FHSpoolStream::~FHSpoolStream()
+{
+  if (m_file)
+    std::fclose(m_file);
+}
+
+void libfreehand::FHSpoolStream::append(const unsigned char *data, unsigned long size, unsigned long memoryLimit)
+{
+  if (!m_file && m_size + size > memoryLimit)
+  {
+    m_file = std::tmpfile();
+    if (m_file)
+    {
+      FH_DEBUG_MSG(("FHSpoolStream::append - spooling to a temporary file after 0x%lx bytes\n", m_size));
+      if (m_size && std::fwrite(&m_buffer[0], 1, m_size, m_file) != m_size)
+      {
+        std::fclose(m_file);
+        m_file = nullptr;
+      }
+      else
+      {
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+      }
+    }
+  }
+
+  if (m_file)
+  {
+    if (std::fwrite(data, 1, size, m_file) != size)
+    {
+      // keep what we have
+      FH_DEBUG_MSG(("FHSpoolStream::append - cannot write to the temporary file\n"));
+      return;
+    }
+  }
+  else
+  {
+    m_buffer.insert(m_buffer.end(), data, data + size);
+  }
+  m_size += size;
+}
+
+const unsigned char *libfreehand::FHSpoolStream::read(unsigned long numBytes, unsigned long &numBytesRead)
+{
+  numBytesRead = 0;
+
+  if (numBytes == 0 || m_offset >= m_size)
+    return nullptr;
+
+  if (numBytes > m_size - m_offset)
+    numBytes = m_size - m_offset;
+
+  if (!m_file)
+  {
+    const unsigned char *const data = &m_buffer[m_offset];
+    m_offset += numBytes;
+    numBytesRead = numBytes;
+    return data;
+  }
+
+  m_buffer.resize(numBytes);
+  if (std::fseek(m_file, long(m_offset), SEEK_SET) != 0)
+    return nullptr;
+  numBytesRead = std::fread(&m_buffer[0], 1, numBytes, m_file);
+  m_offset += numBytesRead;
+  return numBytesRead ? &m_buffer[0] : nullptr;
+}
+
+int libfreehand::FHSpoolStream::seek(long offset, librevenge::RVNG_SEEK_TYPE seekType)
+{
+  long newOffset = long(m_offset);
+  if (seekType == librevenge::RVNG_SEEK_CUR)
+    newOffset += offset;
+  else if (seekType == librevenge::RVNG_SEEK_SET)
+    newOffset = offset;
+  else if (seekType == librevenge::RVNG_SEEK_END)
+    newOffset = long(m_size) + offset;
+
+  if (newOffset < 0)
+  {
+    m_offset = 0;
+    return 1;
+  }
+  if ((unsigned long)newOffset > m_size)
+  {
+    m_offset = m_size;
+    return 1;
+  }
+
+  m_offset = (unsigned long)newOffset;
+  return 0;
+}
+
+long libfreehand::FHSpoolStream::tell()
+{
+  return long(m_offset);
+}
+
+bool libfreehand::FHSpoolStream::isEnd()
+{
+  return m_offset >= m_size;
+}
+
+bool libfreehand::FHSpoolStream::isSeekable(librevenge::RVNGInputStream *input)
+{
+  const long pos = input->tell();
+  if (pos < 0)
+    return false;
+  if (input->seek(0, librevenge::RVNG_SEEK_END) != 0)
+    return false;
+  return input->seek(pos, librevenge::RVNG_SEEK_SET) == 0;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
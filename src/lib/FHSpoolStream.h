@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __FHSPOOLSTREAM_H__
+#define __FHSPOOLSTREAM_H__
+
+#include <cstdio>
+#include <vector>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+namespace libfreehand
+{
+
+/* Makes a stream that cannot seek (e.g., a pipe) seekable, by reading the
+ * rest of it into memory. Data beyond memoryLimit bytes go to a temporary
+ * file instead. If the rest is larger than a long can address, the
+ * stream is empty.
+ */
+class FHSpoolStream final : public librevenge::RVNGInputStream
+{
+public:
+  explicit FHSpoolStream(librevenge::RVNGInputStream *input, unsigned long memoryLimit = 32 * 1024 * 1024);
+  ~FHSpoolStream() override;
+  bool isStructured() override
+  {
+    return false;
+  }
+  unsigned subStreamCount() override
+  {
+    return 0;
+  }
+  const char *subStreamName(unsigned) override
+  {
+    return nullptr;
+  }
+  bool existsSubStream(const char *) override
+  {
+    return false;
+  }
+  librevenge::RVNGInputStream *getSubStreamByName(const char *) override
+  {
+    return nullptr;
+  }
+  librevenge::RVNGInputStream *getSubStreamById(unsigned) override
+  {
+    return nullptr;
+  }
+  const unsigned char *read(unsigned long numBytes, unsigned long &numBytesRead) override;
+  int seek(long offset, librevenge::RVNG_SEEK_TYPE seekType) override;
+  long tell() override;
+  bool isEnd() override;
+  unsigned long getSize() const
+  {
+    return m_size;
+  }
+  bool isInMemory() const
+  {
+    return !m_file;
+  }
+
+  // Checks whether input can seek to its end and back.
+  static bool isSeekable(librevenge::RVNGInputStream *input);
+
+private:
+  FHSpoolStream(const FHSpoolStream &);
+  FHSpoolStream &operator=(const FHSpoolStream &);
+
+  void append(const unsigned char *data, unsigned long size, unsigned long memoryLimit);
+
+  std::vector<unsigned char> m_buffer;
+  std::FILE *m_file;
+  unsigned long m_size;
+  unsigned long m_offset;
+};
+
+} // namespace libfreehand
+
+#endif /* __FHSPOOLSTREAM_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -11,6 +11,8 @@
 #define __FHTYPES_H__
 
 #include <float.h>
+#include <algorithm>
+#include <utility>
 #include <vector>
 #include <map>
 #include "FHPath.h"
@@ -132,11 +134,75 @@ struct FHTextObject
       m_colNum(1), m_rowNum(1), m_colSep(0.0), m_rowSep(0.0), m_rowBreakFirst(0) {}
 };
 
+/* Values by id, sorted by id and kept in place. It is looked up like a
+ * std::map, but holds at most Size values, one for each of the ids that
+ * can be set.
+ */
+template<typename T, unsigned Size>
+class FHPropertyMap
+{
+public:
+  typedef std::pair<unsigned, T> value_type;
+  typedef const value_type *const_iterator;
+  typedef const_iterator iterator;
+
+  FHPropertyMap() : m_values(), m_size(0) {}
+
+  const_iterator begin() const
+  {
+    return m_values;
+  }
+  const_iterator end() const
+  {
+    return m_values + m_size;
+  }
+  bool empty() const
+  {
+    return !m_size;
+  }
+  unsigned size() const
+  {
+    return m_size;
+  }
+
+  const_iterator find(unsigned id) const
+  {
+    const_iterator it = std::lower_bound(begin(), end(), id, lessId);
+    return it != end() && it->first == id ? it : end();
+  }
+
+  // Returns false if the value did not fit
+  bool set(unsigned id, const T &value)
+  {
+    value_type *it = std::lower_bound(m_values, m_values + m_size, id, lessId);
+    if (it != m_values + m_size && it->first == id)
+    {
+      it->second = value;
+      return true;
+    }
+    if (m_size == Size)
+      return false;
+    std::copy_backward(it, m_values + m_size, m_values + m_size + 1);
+    *it = value_type(id, value);
+    ++m_size;
+    return true;
+  }
+
+private:
+  static bool lessId(const value_type &value, unsigned id)
+  {
+    return value.first < id;
+  }
+
+  value_type m_values[Size];
+  unsigned m_size;
+};
+
 struct FHParagraphProperties
 {
-  std::map<unsigned,unsigned> m_idToIntMap; // id to enum, int map
-  std::map<unsigned,double> m_idToDoubleMap;
-  std::map<unsigned,unsigned> m_idToZoneIdMap;
+  FHPropertyMap<unsigned, 4> m_idToIntMap; // id to enum, int map
+  FHPropertyMap<double, 6> m_idToDoubleMap;
+  FHPropertyMap<unsigned, 1> m_idToZoneIdMap;
   FHParagraphProperties() : m_idToIntMap(), m_idToDoubleMap(), m_idToZoneIdMap()
   {}
   bool empty() const
@@ -152,7 +218,7 @@ struct FHCharProperties
   unsigned m_fontNameId;
   unsigned m_fontId;
   unsigned m_tEffectId;
-  std::map<unsigned,double> m_idToDoubleMap;
+  FHPropertyMap<double, 3> m_idToDoubleMap;
   FHCharProperties()
     : m_textColorId(0), m_fontSize(12.0), m_fontNameId(0), m_fontId(0), m_tEffectId(0), m_idToDoubleMap() {}
 };
@@ -342,6 +408,17 @@ struct FHDataList
   FHDataList() : m_dataSize(0), m_elements() {}
 };
 
+/* The data of a Data record, as a part of the inflated document. If the
+ * document is not kept whole, they are copied instead.
+ */
+struct FHData
+{
+  unsigned long m_offset;
+  unsigned long m_length;
+  std::vector<unsigned char> m_copy;
+  FHData() : m_offset(0), m_length(0), m_copy() {}
+};
+
 struct FHImageImport
 {
   unsigned m_graphicStyleId;
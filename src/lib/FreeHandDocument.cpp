@@ -7,11 +7,15 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <memory>
 #include <sstream>
 #include <string>
 #include <string.h>
 #include <libfreehand/libfreehand.h>
+#include "FHBigEndianCursor.h"
 #include "FHParser.h"
+#include "FHRecordGraph.h"
+#include "FHSpoolStream.h"
 #include "libfreehand_utils.h"
 
 namespace libfreehand
@@ -20,16 +24,26 @@ namespace libfreehand
 namespace
 {
 
+bool isAGD(unsigned agd)
+{
+  return ((agd >> 24) & 0xff) == 'A' && ((agd >> 16) & 0xff) == 'G' && ((agd >> 8) & 0xff) == 'D';
+}
+
+bool isFH3(unsigned agd)
+{
+  return ((agd >> 24) & 0xff) == 'F' && ((agd >> 16) & 0xff) == 'H' && ((agd >> 8) & 0xff) == '3';
+}
+
 bool findAGD(librevenge::RVNGInputStream *input)
 {
   unsigned agd = readU32(input);
   input->seek(-4, librevenge::RVNG_SEEK_CUR);
-  if (((agd >> 24) & 0xff) == 'A' && ((agd >> 16) & 0xff) == 'G' && ((agd >> 8) & 0xff) == 'D')
+  if (isAGD(agd))
   {
     FH_DEBUG_MSG(("Found AGD at offset 0x%lx (FreeHand version %i)\n", input->tell(), (agd & 0xff) - 0x30 + 5));
     return true;
   }
-  else if (((agd >> 24) & 0xff) == 'F' && ((agd >> 16) & 0xff) == 'H' && ((agd >> 8) & 0xff) == '3')
+  else if (isFH3(agd))
   {
     FH_DEBUG_MSG(("Found FH3 at offset 0x%lx (FreeHand version %c.%c)\n", input->tell(), (agd >> 8) & 0xff, agd & 0xff));
     return true;
@@ -53,7 +67,7 @@ bool findAGD(librevenge::RVNGInputStream *input)
         {
           agd = readU32(input);
           input->seek(-4, librevenge::RVNG_SEEK_CUR);
-          if (((agd >> 24) & 0xff) == 'A' && ((agd >> 16) & 0xff) == 'G' && ((agd >> 8) & 0xff) == 'D')
+          if (isAGD(agd))
           {
             FH_DEBUG_MSG(("Found AGD at offset 0x%lx (FreeHand version %i)\n", input->tell(), (agd & 0xff) - 0x30 + 5));
             return true;
@@ -66,6 +80,42 @@ bool findAGD(librevenge::RVNGInputStream *input)
   return false;
 }
 
+FHParser::Content getParserContent(FreeHandParseOptions::Content content)
+{
+  switch (content)
+  {
+  case FreeHandParseOptions::CONTENT_NO_IMAGES:
+    return FHParser::CONTENT_NO_IMAGES;
+  case FreeHandParseOptions::CONTENT_PAGES:
+    return FHParser::CONTENT_PAGES;
+  default:
+    return FHParser::CONTENT_ALL;
+  }
+}
+
+void setParserOptions(FHParser &parser, const FreeHandParseOptions &options)
+{
+  parser.setInflateWindow(options.getInflateWindowSize());
+  parser.setInflateCache(options.getInflateCacheDir(), options.getInflateCacheSize());
+  parser.setInflateInBackground(options.getInflateInBackground());
+  parser.setLazyDecoding(options.getLazyDecoding());
+  parser.setDecodeThreads(options.getDecodeThreads());
+  parser.setContent(getParserContent(options.getContent()));
+  parser.setSkipDamagedRecords(options.getSkipDamagedRecords());
+}
+
+// The parser seeks back and forth, so a stream that cannot seek is read
+// into a buffer first.
+librevenge::RVNGInputStream *getSeekableStream(librevenge::RVNGInputStream *input, std::unique_ptr<FHSpoolStream> &spool)
+{
+  if (input->seek(0, librevenge::RVNG_SEEK_SET) != 0 || !FHSpoolStream::isSeekable(input))
+  {
+    spool.reset(new FHSpoolStream(input));
+    return spool.get();
+  }
+  return input;
+}
+
 } // anonymous namespace
 
 /**
@@ -95,6 +145,82 @@ FHAPI bool FreeHandDocument::isSupported(librevenge::RVNGInputStream *input)
 
 }
 
+/**
+Checks whether a block of data, the beginning of a file, looks like a FreeHand
+Document that libfreehand is able to parse. Unlike isSupported, it does not
+need the whole file, and it does not allocate any memory.
+\param data The beginning of the file
+\param size The size of data
+\param version If not null, receives the FreeHand version of a supported document
+\param agdOffset If not null, receives the offset of the document in the file
+\return SNIFF_SUPPORTED or SNIFF_UNSUPPORTED, or SNIFF_NEED_MORE_DATA if more of
+the file is needed to decide. If data contain the whole file, the latter means
+that it is not supported.
+*/
+FHAPI FreeHandDocument::SniffResult FreeHandDocument::sniff(const unsigned char *data, unsigned long size, int *version, unsigned long *agdOffset)
+{
+  if (!data)
+    return size ? SNIFF_UNSUPPORTED : SNIFF_NEED_MORE_DATA;
+
+  FHBigEndianCursor cursor(data, size);
+  if (cursor.getRemaining() < 4)
+    return SNIFF_NEED_MORE_DATA;
+  unsigned agd = cursor.readU32();
+  int foundVersion = 0;
+  unsigned long offset = 0;
+  if (isAGD(agd))
+    foundVersion = int(agd & 0xff) - 0x30 + 5;
+  else if (isFH3(agd))
+    foundVersion = 3;
+  else
+  {
+    // look for AGD block in the records, like findAGD
+    cursor.seek(0);
+    for (;;)
+    {
+      if (cursor.isEnd())
+        return SNIFF_NEED_MORE_DATA;
+      if (0x1c != cursor.readU8())
+        return SNIFF_UNSUPPORTED;
+      if (cursor.getRemaining() < 4)
+        return SNIFF_NEED_MORE_DATA;
+      const unsigned short opcode = cursor.readU16();
+      const unsigned char flag = cursor.readU8();
+      unsigned long length = cursor.readU8();
+      if (0x80 == flag)
+      {
+        if (4 != length)
+          return SNIFF_UNSUPPORTED;
+        if (cursor.getRemaining() < 4)
+          return SNIFF_NEED_MORE_DATA;
+        length = cursor.readU32();
+        if (0x080a == opcode)
+        {
+          if (cursor.getRemaining() < 4)
+            return SNIFF_NEED_MORE_DATA;
+          offset = cursor.tell();
+          agd = cursor.readU32();
+          cursor.seek(offset);
+          if (isAGD(agd))
+          {
+            foundVersion = int(agd & 0xff) - 0x30 + 5;
+            break;
+          }
+        }
+      }
+      if (cursor.getRemaining() < length)
+        return SNIFF_NEED_MORE_DATA;
+      cursor.skip(length);
+    }
+  }
+
+  if (agdOffset)
+    *agdOffset = offset;
+  if (version)
+    *version = foundVersion;
+  return SNIFF_SUPPORTED;
+}
+
 /**
 Parses the input stream content. It will make callbacks to the functions provided by a
 librevenge::RVNGDrawingInterface class implementation when needed. This is often commonly called the
@@ -105,16 +231,53 @@ librevenge::RVNGDrawingInterface class implementation when needed. This is often
 */
 FHAPI bool FreeHandDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter)
 {
+  return parse(input, painter, FreeHandParseOptions());
+}
+
+/**
+Parses the input stream content, like the function above, but allows to
+tune how it is done.
+\param input The input stream
+\param painter A librevenge::RVNGDrawingerInterface implementation
+\param options Parsing options
+\return A value that indicates whether the parsing was successful
+*/
+FHAPI bool FreeHandDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, const FreeHandParseOptions &options)
+{
+  return parse(input, painter, options, nullptr);
+}
+
+/**
+Parses the input stream content, like the function above, and tells how many
+records were left out because they were damaged.
+\param input The input stream
+\param painter A librevenge::RVNGDrawingerInterface implementation
+\param options Parsing options
+\param skippedRecords If not null, receives the number of records that were
+skipped. It is only ever more than 0 if options allow to skip damaged records.
+\return A value that indicates whether the parsing was successful
+*/
+FHAPI bool FreeHandDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, const FreeHandParseOptions &options, unsigned long *skippedRecords)
+{
+  if (skippedRecords)
+    *skippedRecords = 0;
   if (!input)
     return false;
 
   try
   {
+    std::unique_ptr<FHSpoolStream> spool;
+    input = getSeekableStream(input, spool);
+
     input->seek(0, librevenge::RVNG_SEEK_SET);
     if (findAGD(input))
     {
       FHParser parser;
-      if (!parser.parse(input, painter))
+      setParserOptions(parser, options);
+      const bool parsed = parser.parse(input, painter);
+      if (skippedRecords)
+        *skippedRecords = parser.getSkippedRecords();
+      if (!parsed)
         return false;
     }
     else
@@ -127,6 +290,53 @@ FHAPI bool FreeHandDocument::parse(librevenge::RVNGInputStream *input, libreveng
   return false;
 }
 
+/**
+Finds which records of the document in the input stream refer to which,
+without drawing anything.
+\param input The input stream
+\param graph Receives the records and their references
+\return A value that indicates whether all the records could be read.
+If not, graph holds what was found before the problem.
+*/
+FHAPI bool FreeHandDocument::parseRecordGraph(librevenge::RVNGInputStream *input, FreeHandRecordGraph &graph)
+{
+  return parseRecordGraph(input, graph, FreeHandParseOptions());
+}
+
+/**
+Finds which records refer to which, like the function above, but allows to
+tune how the document is read. Options that only concern decoding, like
+lazy decoding and the number of threads, have no effect.
+\param input The input stream
+\param graph Receives the records and their references
+\param options Parsing options
+\return A value that indicates whether all the records could be read
+*/
+FHAPI bool FreeHandDocument::parseRecordGraph(librevenge::RVNGInputStream *input, FreeHandRecordGraph &graph, const FreeHandParseOptions &options)
+{
+  graph.m_impl->clear();
+  if (!input)
+    return false;
+
+  try
+  {
+    std::unique_ptr<FHSpoolStream> spool;
+    input = getSeekableStream(input, spool);
+
+    input->seek(0, librevenge::RVNG_SEEK_SET);
+    if (!findAGD(input))
+      return false;
+    FHParser parser;
+    setParserOptions(parser, options);
+    return parser.buildRecordGraph(input, *graph.m_impl);
+  }
+  catch (...)
+  {
+  }
+  graph.m_impl->clear();
+  return false;
+}
+
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
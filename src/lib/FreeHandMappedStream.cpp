@@ -0,0 +1,209 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <libfreehand/FreeHandMappedStream.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "libfreehand_utils.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace libfreehand
+{
+
+struct FreeHandMappedStreamImpl
+{
+  FreeHandMappedStreamImpl()
+    : m_data(nullptr), m_size(0), m_offset(0), m_mapped(false), m_open(false), m_buffer()
+  {
+  }
+
+  void open(const char *filename);
+  bool map(const char *filename);
+  bool readAll(const char *filename);
+
+  const unsigned char *m_data;
+  unsigned long m_size;
+  unsigned long m_offset;
+  bool m_mapped;
+  bool m_open;
+  // the content, if it could not be mapped
+  std::vector<unsigned char> m_buffer;
+};
+
+void FreeHandMappedStreamImpl::open(const char *filename)
+{
+  if (!filename)
+    return;
+  m_open = map(filename) || readAll(filename);
+}
+
+bool FreeHandMappedStreamImpl::map(const char *filename)
+{
+#ifdef HAVE_SYS_MMAN_H
+  const int fd = ::open(filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  bool mapped = false;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+  {
+    void *const data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+#ifdef MADV_SEQUENTIAL
+      // the parser mostly reads forward
+      (void)madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+#endif
+      m_data = static_cast<const unsigned char *>(data);
+      m_size = (unsigned long)info.st_size;
+      m_mapped = true;
+      mapped = true;
+    }
+  }
+  close(fd);
+  return mapped;
+#else
+  (void)filename;
+  return false;
+#endif
+}
+
+bool FreeHandMappedStreamImpl::readAll(const char *filename)
+{
+  std::FILE *const file = std::fopen(filename, "rb");
+  if (!file)
+    return false;
+
+  unsigned char chunk[65536];
+  size_t numBytesRead = 0;
+  while ((numBytesRead = std::fread(chunk, 1, sizeof(chunk), file)) != 0)
+    m_buffer.insert(m_buffer.end(), chunk, chunk + numBytesRead);
+  const bool valid = !std::ferror(file);
+  std::fclose(file);
+  if (!valid)
+  {
+    m_buffer.clear();
+    return false;
+  }
+
+  m_data = m_buffer.empty() ? nullptr : &m_buffer[0];
+  m_size = m_buffer.size();
+  return true;
+}
+
+FHAPI FreeHandMappedStream::FreeHandMappedStream(const char *filename)
+  : librevenge::RVNGInputStream()
+  , m_impl(new FreeHandMappedStreamImpl())
+{
+  m_impl->open(filename);
+}
+
+FHAPI FreeHandMappedStream::~FreeHandMappedStream()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (m_impl->m_mapped)
+    munmap(const_cast<unsigned char *>(m_impl->m_data), m_impl->m_size);
+#endif
+  delete m_impl;
+}
+
+FHAPI bool FreeHandMappedStream::isOpen() const
+{
+  return m_impl->m_open;
+}
+
+FHAPI bool FreeHandMappedStream::isStructured()
+{
+  return false;
+}
+
+FHAPI unsigned FreeHandMappedStream::subStreamCount()
+{
+  return 0;
+}
+
+FHAPI const char *FreeHandMappedStream::subStreamName(unsigned)
+{
+  return nullptr;
+}
+
+FHAPI bool FreeHandMappedStream::existsSubStream(const char *)
+{
+  return false;
+}
+
+FHAPI librevenge::RVNGInputStream *FreeHandMappedStream::getSubStreamByName(const char *)
+{
+  return nullptr;
+}
+
+FHAPI librevenge::RVNGInputStream *FreeHandMappedStream::getSubStreamById(unsigned)
+{
+  return nullptr;
+}
+
+FHAPI const unsigned char *FreeHandMappedStream::read(unsigned long numBytes, unsigned long &numBytesRead)
+{
+  numBytesRead = std::min(numBytes, m_impl->m_size - m_impl->m_offset);
+  if (!numBytesRead)
+    return nullptr;
+
+  const unsigned char *const data = m_impl->m_data + m_impl->m_offset;
+  m_impl->m_offset += numBytesRead;
+  return data;
+}
+
+FHAPI int FreeHandMappedStream::seek(long offset, librevenge::RVNG_SEEK_TYPE seekType)
+{
+  long newOffset = long(m_impl->m_offset);
+  if (seekType == librevenge::RVNG_SEEK_CUR)
+    newOffset += offset;
+  else if (seekType == librevenge::RVNG_SEEK_SET)
+    newOffset = offset;
+  else if (seekType == librevenge::RVNG_SEEK_END)
+    newOffset = long(m_impl->m_size) + offset;
+
+  if (newOffset < 0)
+  {
+    m_impl->m_offset = 0;
+    return 1;
+  }
+  if ((unsigned long)newOffset > m_impl->m_size)
+  {
+    m_impl->m_offset = m_impl->m_size;
+    return 1;
+  }
+
+  m_impl->m_offset = (unsigned long)newOffset;
+  return 0;
+}
+
+FHAPI long FreeHandMappedStream::tell()
+{
+  return long(m_impl->m_offset);
+}
+
+FHAPI bool FreeHandMappedStream::isEnd()
+{
+  return m_impl->m_offset >= m_impl->m_size;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <string>
+
+#include <libfreehand/libfreehand.h>
+
+namespace libfreehand
+{
+
+struct FreeHandParseOptionsImpl
+{
+  FreeHandParseOptionsImpl()
+    : m_inflateWindowSize(0)
+    , m_inflateCacheDir()
+    , m_inflateCacheSize(256 * 1024 * 1024)
+    , m_inflateInBackground(false)
+    , m_lazyDecoding(false)
+    , m_decodeThreads(1)
+    , m_content(FreeHandParseOptions::CONTENT_ALL)
+    , m_skipDamagedRecords(false)
+  {
+  }
+
+  unsigned long m_inflateWindowSize;
+  std::string m_inflateCacheDir;
+  unsigned long m_inflateCacheSize;
+  bool m_inflateInBackground;
+  bool m_lazyDecoding;
+  unsigned m_decodeThreads;
+  FreeHandParseOptions::Content m_content;
+  bool m_skipDamagedRecords;
+};
+
+FHAPI FreeHandParseOptions::FreeHandParseOptions()
+  : m_impl(new FreeHandParseOptionsImpl())
+{
+}
+
+FHAPI FreeHandParseOptions::FreeHandParseOptions(const FreeHandParseOptions &other)
+  : m_impl(new FreeHandParseOptionsImpl(*other.m_impl))
+{
+}
+
+FHAPI FreeHandParseOptions::~FreeHandParseOptions()
+{
+  delete m_impl;
+}
+
+FHAPI FreeHandParseOptions &FreeHandParseOptions::operator=(const FreeHandParseOptions &other)
+{
+  if (this != &other)
+    *m_impl = *other.m_impl;
+  return *this;
+}
+
+FHAPI void FreeHandParseOptions::setInflateWindowSize(unsigned long size)
+{
+  m_impl->m_inflateWindowSize = size;
+}
+
+FHAPI unsigned long FreeHandParseOptions::getInflateWindowSize() const
+{
+  return m_impl->m_inflateWindowSize;
+}
+
+FHAPI void FreeHandParseOptions::setInflateCacheDir(const char *dir)
+{
+  m_impl->m_inflateCacheDir = dir ? dir : "";
+}
+
+FHAPI const char *FreeHandParseOptions::getInflateCacheDir() const
+{
+  return m_impl->m_inflateCacheDir.c_str();
+}
+
+FHAPI void FreeHandParseOptions::setInflateCacheSize(unsigned long size)
+{
+  m_impl->m_inflateCacheSize = size;
+}
+
+FHAPI unsigned long FreeHandParseOptions::getInflateCacheSize() const
+{
+  return m_impl->m_inflateCacheSize;
+}
+
+FHAPI void FreeHandParseOptions::setInflateInBackground(bool background)
+{
+  m_impl->m_inflateInBackground = background;
+}
+
+FHAPI bool FreeHandParseOptions::getInflateInBackground() const
+{
+  return m_impl->m_inflateInBackground;
+}
+
+FHAPI void FreeHandParseOptions::setLazyDecoding(bool lazy)
+{
+  m_impl->m_lazyDecoding = lazy;
+}
+
+FHAPI bool FreeHandParseOptions::getLazyDecoding() const
+{
+  return m_impl->m_lazyDecoding;
+}
+
+FHAPI void FreeHandParseOptions::setDecodeThreads(unsigned threads)
+{
+  m_impl->m_decodeThreads = threads;
+}
+
+FHAPI unsigned FreeHandParseOptions::getDecodeThreads() const
+{
+  return m_impl->m_decodeThreads;
+}
+
+FHAPI void FreeHandParseOptions::setContent(Content content)
+{
+  m_impl->m_content = content;
+}
+
+FHAPI FreeHandParseOptions::Content FreeHandParseOptions::getContent() const
+{
+  return m_impl->m_content;
+}
+
+FHAPI void FreeHandParseOptions::setSkipDamagedRecords(bool skip)
+{
+  m_impl->m_skipDamagedRecords = skip;
+}
+
+FHAPI bool FreeHandParseOptions::getSkipDamagedRecords() const
+{
+  return m_impl->m_skipDamagedRecords;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <libfreehand/libfreehand.h>
+#include "FHRecordGraph.h"
+
+namespace libfreehand
+{
+
+FHAPI FreeHandRecordGraph::FreeHandRecordGraph()
+  : m_impl(new FHRecordGraph())
+{
+}
+
+FHAPI FreeHandRecordGraph::FreeHandRecordGraph(const FreeHandRecordGraph &other)
+  : m_impl(new FHRecordGraph(*other.m_impl))
+{
+}
+
+FHAPI FreeHandRecordGraph::~FreeHandRecordGraph()
+{
+  delete m_impl;
+}
+
+FHAPI FreeHandRecordGraph &FreeHandRecordGraph::operator=(const FreeHandRecordGraph &other)
+{
+  if (this != &other)
+    *m_impl = *other.m_impl;
+  return *this;
+}
+
+FHAPI unsigned FreeHandRecordGraph::getRecordCount() const
+{
+  return m_impl->getRecordCount();
+}
+
+FHAPI const char *FreeHandRecordGraph::getRecordType(unsigned record) const
+{
+  return m_impl->getRecordType(record);
+}
+
+FHAPI unsigned long FreeHandRecordGraph::getRecordSize(unsigned record) const
+{
+  return m_impl->getRecordSize(record);
+}
+
+FHAPI const unsigned *FreeHandRecordGraph::getReferences(unsigned record, unsigned &count) const
+{
+  return m_impl->getReferences(record, count);
+}
+
+FHAPI bool FreeHandRecordGraph::isReachable(unsigned record) const
+{
+  return m_impl->isReachable(record);
+}
+
+FHAPI const unsigned *FreeHandRecordGraph::getReferenceOffsets() const
+{
+  return m_impl->getOffsets();
+}
+
+FHAPI const unsigned *FreeHandRecordGraph::getReferenceTargets() const
+{
+  return m_impl->getTargets();
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
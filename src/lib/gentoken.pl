@@ -28,16 +28,87 @@
 $ARGV0 = shift @ARGV;
 $ARGV1 = shift @ARGV;
 $ARGV2 = shift @ARGV;
+$ARGV3 = shift @ARGV;
+$ARGV4 = shift @ARGV;
+
+# Record layouts are generated for these versions; older and newer
+# documents use the first and the last one.
+$minVersion = 3;
+$maxVersion = 12;
 
 open ( TOKENS, $ARGV0 ) || die "can't open token file: $!";
 my %tokens;
+my %readers;
+my %layouts;
+my %flags;
+my %versioned;
+
+# FHParser::VersionFamily, which versioned readers are instantiated for
+@families = ( "FAMILY_FH3", "FAMILY_FH5", "FAMILY_FH9", "FAMILY_FH11" );
+
+# one step of a layout in tokens.txt: [ guard, op, count, size ]
+sub parse_step
+{
+    my ( $name, $step ) = @_;
+    my $guard = "";
+    if ( $step =~ /^v(>=|<=|>|<|=)(\d+):(.*)$/ )
+    {
+        $guard = ( $1 eq "=" ? "==" : $1 ).$2;
+        $step = $3;
+    }
+    my %counts = ( "n" => 1, "m" => 2 );
+    return [ $guard, "LAYOUT_BYTES", 0, $1 ] if ( $step =~ /^(\d+)$/ );
+    return [ $guard, "LAYOUT_BYTES", $counts{$2}, $1 ] if ( $step =~ /^(\d+)\*([nm])$/ );
+    return [ $guard, "LAYOUT_IDS", 0, 1 ] if ( $step eq "id" );
+    return [ $guard, "LAYOUT_IDS", $counts{$1}, 1 ] if ( $step =~ /^id\*([nm])$/ );
+    return [ $guard, "LAYOUT_COUNT", $counts{$1}, 0 ] if ( $step =~ /^([nm])$/ );
+    return [ $guard, "LAYOUT_XFORM", 0, 0 ] if ( $step eq "xform" );
+    die "bad layout step $step of $name";
+}
+
+sub is_guard_met
+{
+    my ( $guard, $version ) = @_;
+    return 1 if ( $guard eq "" );
+    return eval( "$version $guard" ) ? 1 : 0;
+}
 
 while ( defined ($line = <TOKENS>) )
 {
     if( !($line =~ /^#/) )
     {
         chomp($line);
-        @token = split(/\s+/,$line);
+        @fields = split(/\s+/,$line);
+        @token = ( shift(@fields) );
+        $readers{$token[0]} = "read".$token[0];
+        $flags{$token[0]} = [];
+        my $hasReader = 0;
+        foreach $field (@fields)
+        {
+            if ( $field =~ /^reader=(\w+)$/ )
+            {
+                $readers{$token[0]} = $1;
+                $hasReader = 1;
+            }
+            elsif ( $field =~ /^layout=(\S+)$/ )
+            {
+                $layouts{$token[0]} = [ map { parse_step( $token[0], $_ ) } split( /,/, $1 ) ];
+            }
+            elsif ( $field eq "versioned" )
+            {
+                $versioned{$token[0]} = 1;
+            }
+            elsif ( $field =~ /^(drawable|image|page)$/ )
+            {
+                push( @{$flags{$token[0]}}, "RECORD_".uc($1) );
+            }
+            else
+            {
+                $token[1] = $field;
+            }
+        }
+        # a record with a layout and no reader is only skipped
+        $readers{$token[0]} = "" if ( defined $layouts{$token[0]} and not $hasReader );
         if ( not defined ($token[1]) )
         {
             $token[1] = "FH_".$token[0];
@@ -51,31 +122,91 @@ while ( defined ($line = <TOKENS>) )
 }
 close ( TOKENS );
 
+# The hash is FNV-1a started from a seeded basis, folded to the table size.
+# It has to match hashTokenName() in FHParser.cpp, which checks at compile
+# time that every token lands in its slot.
+sub hash_token
+{
+    my ( $name, $seed, $bits ) = @_;
+    my $hash = 2166136261 ^ $seed;
+    foreach my $c ( unpack( "C*", $name ) )
+    {
+        $hash = ( ( $hash ^ $c ) * 16777619 ) & 0xffffffff;
+    }
+    return ( $hash ^ ( $hash >> 16 ) ) & ( ( 1 << $bits ) - 1 );
+}
+
+@names = sort(keys(%tokens));
+
+# find the smallest table with a seed that makes the hash perfect
+$bits = 1;
+$bits++ while ( ( 1 << $bits ) < 8 * scalar(@names) );
+for ( ;; $bits++ )
+{
+    for ( $seed = 0; $seed < 65536; $seed++ )
+    {
+        my %used;
+        my $perfect = 1;
+        foreach ( @names )
+        {
+            my $slot = hash_token( $_, $seed, $bits );
+            if ( exists $used{$slot} )
+            {
+                $perfect = 0;
+                last;
+            }
+            $used{$slot} = 1;
+        }
+        last if ( $perfect );
+    }
+    last if ( $seed < 65536 );
+}
+
 open ( HXX, ">$ARGV1" ) || die "can't open tokens.hxx file: $!";
-open ( GPERF, ">$ARGV2" ) || die "can't open tokens.gperf file: $!";
-
-print ( GPERF "%language=C++\n" );
-print ( GPERF "%global-table\n" );
-print ( GPERF "%null-strings\n" );
-print ( GPERF "%struct-type\n" );
-print ( GPERF "struct fhtoken\n" );
-print ( GPERF "{\n" );
-print ( GPERF "  const char *name;\n  int tokenId;\n" );
-print ( GPERF "};\n" );
-print ( GPERF "%%\n" );
+open ( HASH, ">$ARGV2" ) || die "can't open tokenhash.h file: $!";
+open ( RECORDS, ">$ARGV3" ) || die "can't open recordtypes.h file: $!";
+open ( LAYOUTS, ">$ARGV4" ) || die "can't open recordlayouts.h file: $!";
 
 print ( HXX "#ifndef __FHTOKENS_HXX__\n" );
 print ( HXX "#define __FHTOKENS_HXX__\n" );
 print ( HXX "\n" );
 
+# the entries of FHParser's record type table, indexed by token
+print ( RECORDS "{ nullptr, { ".join( ", ", ("nullptr") x scalar(@families) )." }, 0 },\n" );
+
+print ( HASH "const unsigned FH_TOKEN_HASH_SEED = $seed;\n" );
+print ( HASH "const unsigned FH_TOKEN_HASH_BITS = $bits;\n" );
+print ( HASH "\n" );
+print ( HASH "constexpr const char *tokenNames[] =\n{\n" );
+print ( HASH "  nullptr,\n" );
+
+my @slots = (0) x ( 1 << $bits );
 $i = 1;
-foreach( sort(keys(%tokens)) )
+foreach( @names )
 {
     print( HXX "const int $tokens{$_} = $i;\n" );
-    print( GPERF "$_,$tokens{$_}\n" );
+    print( HASH "  \"$_\",\n" );
+    my @familyReaders;
+    foreach my $family ( @families )
+    {
+        my $reader = $readers{$_};
+        $reader .= "<$family>" if ( $versioned{$_} );
+        push( @familyReaders, $readers{$_} eq "" ? "nullptr" : "&FHParser::$reader" );
+    }
+    my $reader = "{ ".join( ", ", @familyReaders )." }";
+    my $recordFlags = @{$flags{$_}} ? join( " | ", @{$flags{$_}} ) : "0";
+    print( RECORDS "{ \"$_\", $reader, $recordFlags },\n" );
+    $slots[hash_token( $_, $seed, $bits )] = $i;
     $i = $i + 1;
 }
-print ( GPERF "%%\n" );
+print ( HASH "};\n" );
+print ( HASH "\n" );
+print ( HASH "constexpr unsigned char tokenSlots[] =\n{\n" );
+for ( $s = 0; $s < scalar(@slots); $s += 16 )
+{
+    print ( HASH "  ".join( ", ", @slots[$s .. $s + 15] ).",\n" );
+}
+print ( HASH "};\n" );
 print ( HXX "\n" );
 print ( HXX "const int FH_TOKEN_COUNT = $i;\n" );
 print ( HXX "\n" );
@@ -83,4 +214,81 @@ print ( HXX "const int FH_TOKEN_INVALID = -1;\n" );
 print ( HXX "\n" );
 print ( HXX "#endif\n" );
 close ( HXX );
-close ( GPERF );
+close ( HASH );
+close ( RECORDS );
+
+# The layout of each record type in each version, as the steps that are
+# left once the guards are applied. Equal layouts are stored only once.
+my @steps = ( "{ LAYOUT_END, 0, 0 }" );
+my %layoutStarts;
+my @rows;
+for ( $version = $minVersion; $version <= $maxVersion; $version++ )
+{
+    my @row = (0);
+    foreach my $name ( @names )
+    {
+        if ( not defined $layouts{$name} )
+        {
+            push( @row, 0 );
+            next;
+        }
+        my @merged;
+        foreach my $step ( @{$layouts{$name}} )
+        {
+            my ( $guard, $op, $count, $size ) = @$step;
+            # the versions before and after the table have to agree with its ends
+            die "layout of $name differs before version $minVersion"
+                if ( is_guard_met( $guard, $minVersion - 1 ) != is_guard_met( $guard, $minVersion ) );
+            die "layout of $name differs after version $maxVersion"
+                if ( is_guard_met( $guard, $maxVersion + 1 ) != is_guard_met( $guard, $maxVersion ) );
+            next if ( not is_guard_met( $guard, $version ) );
+            next if ( $op eq "LAYOUT_BYTES" and $size == 0 );
+            if ( @merged and $op ne "LAYOUT_COUNT" and $op ne "LAYOUT_XFORM" and $count == 0
+                 and $merged[-1][0] eq $op and $merged[-1][1] == 0 )
+            {
+                $merged[-1][2] += $size;
+            }
+            else
+            {
+                push( @merged, [ $op, $count, $size ] );
+            }
+        }
+        my @code = map { die "layout step of $name is too big" if ( $$_[2] > 0xffff ); "{ $$_[0], $$_[1], $$_[2] }" } @merged;
+        push( @code, "{ LAYOUT_END, 0, 0 }" );
+        my $key = join( ", ", @code );
+        if ( not defined $layoutStarts{$key} )
+        {
+            $layoutStarts{$key} = scalar(@steps);
+            push( @steps, @code );
+        }
+        push( @row, $layoutStarts{$key} );
+    }
+    push( @rows, [ @row ] );
+}
+die "too many layout steps" if ( scalar(@steps) > 0xffff );
+
+print ( LAYOUTS "const int FH_LAYOUT_MIN_VERSION = $minVersion;\n" );
+print ( LAYOUTS "const int FH_LAYOUT_MAX_VERSION = $maxVersion;\n" );
+print ( LAYOUTS "\n" );
+print ( LAYOUTS "static constexpr LayoutStep layoutSteps[] =\n{\n" );
+foreach ( @steps )
+{
+    print ( LAYOUTS "  $_,\n" );
+}
+print ( LAYOUTS "};\n" );
+print ( LAYOUTS "\n" );
+print ( LAYOUTS "// where the layout of each record type starts in layoutSteps, 0 if it has none\n" );
+print ( LAYOUTS "static constexpr unsigned short recordLayouts[][FH_TOKEN_COUNT] =\n{\n" );
+for ( $r = 0; $r < scalar(@rows); $r++ )
+{
+    my @row = @{$rows[$r]};
+    print ( LAYOUTS "  // version ".( $minVersion + $r )."\n  {\n" );
+    for ( $s = 0; $s < scalar(@row); $s += 16 )
+    {
+        my $end = $s + 15 < $#row ? $s + 15 : $#row;
+        print ( LAYOUTS "    ".join( ", ", @row[$s .. $end] ).",\n" );
+    }
+    print ( LAYOUTS "  },\n" );
+}
+print ( LAYOUTS "};\n" );
+close ( LAYOUTS );
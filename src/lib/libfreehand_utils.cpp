@@ -137,8 +137,9 @@ unsigned long libfreehand::getRemainingLength(librevenge::RVNGInputStream *const
   if (input->seek(0, librevenge::RVNG_SEEK_END) != 0)
   {
     // librevenge::RVNG_SEEK_END does not work. Use the harder way.
-    while (!input->isEnd())
-      readU8(input);
+    unsigned long numBytesRead = 0;
+    while (!input->isEnd() && input->read(65536, numBytesRead) && numBytesRead)
+      ;
   }
   const long end = input->tell();
 
@@ -150,6 +151,25 @@ unsigned long libfreehand::getRemainingLength(librevenge::RVNGInputStream *const
   return static_cast<unsigned long>(end - begin);
 }
 
+unsigned long libfreehand::getRemainingLength(librevenge::RVNGInputStream *const input, const unsigned long length)
+{
+  if (!input || input->tell() < 0)
+    throw EndOfStreamException();
+
+  const unsigned long begin = static_cast<unsigned long>(input->tell());
+  if (length < begin)
+    throw EndOfStreamException();
+  return length - begin;
+}
+
+unsigned long libfreehand::getLength(librevenge::RVNGInputStream *const input)
+{
+  if (!input || input->tell() < 0)
+    throw EndOfStreamException();
+
+  return static_cast<unsigned long>(input->tell()) + getRemainingLength(input);
+}
+
 void libfreehand::_appendUTF16(librevenge::RVNGString &text, std::vector<unsigned short> &characters)
 {
   if (characters.empty())
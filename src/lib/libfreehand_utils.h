@@ -62,6 +62,9 @@ int16_t readS16(librevenge::RVNGInputStream *input);
 int32_t readS32(librevenge::RVNGInputStream *input);
 
 unsigned long getRemainingLength(librevenge::RVNGInputStream *input);
+// Like above, for a stream whose length is known already
+unsigned long getRemainingLength(librevenge::RVNGInputStream *input, unsigned long length);
+unsigned long getLength(librevenge::RVNGInputStream *input);
 
 void writeU16(librevenge::RVNGBinaryData &buffer, const int value);
 void writeU32(librevenge::RVNGBinaryData &buffer, const int value);
@@ -0,0 +1,201 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <string>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "FHCollector.h"
+#include "RecordingPainter.h"
+
+namespace test
+{
+
+using libfreehand::FHCollector;
+
+class FHCollectorTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FHCollectorTest);
+  CPPUNIT_TEST(testMergeIntoEmpty);
+  CPPUNIT_TEST(testMergeIntoNonEmpty);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testMergeIntoEmpty();
+  void testMergeIntoNonEmpty();
+};
+
+namespace
+{
+
+/* The records of a small drawing: a block (1) with a layer list (2) of
+ * one visible layer (3), whose elements (4) are two paths (10, 11) and a
+ * group (5) of elements (6) with one path (12), moved by a transform (7).
+ */
+enum
+{
+  BLOCK_ID = 1,
+  LAYER_LIST_ID,
+  LAYER_ID,
+  ELEMENTS_ID,
+  GROUP_ID,
+  GROUP_ELEMENTS_ID,
+  XFORM_ID,
+  PATH_ID = 10
+};
+
+void collectPath(FHCollector &collector, unsigned id)
+{
+  libfreehand::FHPath path;
+  path.appendMoveTo(id, 2 * id);
+  path.appendLineTo(3 * id, id);
+  path.appendLineTo(id, 5 * id);
+  path.appendClosePath();
+  collector.collectPath(id, path);
+}
+
+void collectList(FHCollector &collector, unsigned id, unsigned first, unsigned second = 0, unsigned third = 0)
+{
+  libfreehand::FHList list;
+  list.m_elements.push_back(first);
+  if (second)
+    list.m_elements.push_back(second);
+  if (third)
+    list.m_elements.push_back(third);
+  collector.collectList(id, list);
+}
+
+// What the parser collects itself, in order
+void collectBlock(FHCollector &collector)
+{
+  collector.collectBlock(BLOCK_ID, libfreehand::FHBlock(LAYER_LIST_ID));
+  libfreehand::FHTail tail;
+  tail.m_blockId = BLOCK_ID;
+  tail.m_pageInfo.m_maxX = 8.5;
+  tail.m_pageInfo.m_maxY = 11.0;
+  collector.collectFHTail(0, tail);
+}
+
+void collectLayer(FHCollector &collector)
+{
+  collectList(collector, LAYER_LIST_ID, LAYER_ID);
+  libfreehand::FHLayer layer;
+  layer.m_elementsId = ELEMENTS_ID;
+  layer.m_visibility = 3;
+  collector.collectLayer(LAYER_ID, layer);
+  collectList(collector, ELEMENTS_ID, PATH_ID, GROUP_ID, PATH_ID + 1);
+}
+
+void collectGroup(FHCollector &collector)
+{
+  libfreehand::FHGroup group;
+  group.m_elementsId = GROUP_ELEMENTS_ID;
+  group.m_xFormId = XFORM_ID;
+  collector.collectGroup(GROUP_ID, group);
+  collectList(collector, GROUP_ELEMENTS_ID, PATH_ID + 2);
+  collector.collectXform(XFORM_ID, 1.0, 0.0, 0.0, 1.0, 72.0, 144.0);
+}
+
+unsigned countPaths(const std::string &calls)
+{
+  unsigned count = 0;
+  for (std::string::size_type pos = calls.find("\ndrawPath"); pos != std::string::npos; pos = calls.find("\ndrawPath", pos + 1))
+    ++count;
+  return count;
+}
+
+std::string output(FHCollector &collector)
+{
+  RecordingPainter painter;
+  collector.outputDrawing(&painter);
+  return painter.getCalls();
+}
+
+std::string outputWhole()
+{
+  FHCollector collector;
+  collectBlock(collector);
+  collectLayer(collector);
+  collectGroup(collector);
+  for (unsigned id = PATH_ID; id != PATH_ID + 3; ++id)
+    collectPath(collector, id);
+  return output(collector);
+}
+
+}
+
+void FHCollectorTest::setUp()
+{
+}
+
+void FHCollectorTest::tearDown()
+{
+}
+
+void FHCollectorTest::testMergeIntoEmpty()
+{
+  const std::string whole = outputWhole();
+  CPPUNIT_ASSERT_EQUAL(3U, countPaths(whole));
+
+  // nothing but the block and the tail, which are not merged
+  FHCollector collector;
+  collectBlock(collector);
+  CPPUNIT_ASSERT_EQUAL(0U, countPaths(output(collector)));
+
+  FHCollector shard;
+  collectLayer(shard);
+  collectGroup(shard);
+  for (unsigned id = PATH_ID; id != PATH_ID + 3; ++id)
+    collectPath(shard, id);
+  collector.merge(shard);
+  CPPUNIT_ASSERT_EQUAL(whole, output(collector));
+
+  // the records were moved
+  collector.merge(shard);
+  CPPUNIT_ASSERT_EQUAL(whole, output(collector));
+  FHCollector other;
+  collectBlock(other);
+  other.merge(shard);
+  CPPUNIT_ASSERT_EQUAL(0U, countPaths(output(other)));
+}
+
+void FHCollectorTest::testMergeIntoNonEmpty()
+{
+  const std::string whole = outputWhole();
+
+  FHCollector collector;
+  collectBlock(collector);
+  collectLayer(collector);
+  collectPath(collector, PATH_ID);
+
+  // shards with records of kinds the collector has and has not yet
+  FHCollector first;
+  collectGroup(first);
+  collectPath(first, PATH_ID + 1);
+  FHCollector second;
+  collectPath(second, PATH_ID + 2);
+  FHCollector empty;
+
+  collector.merge(first);
+  collector.merge(empty);
+  collector.merge(second);
+  CPPUNIT_ASSERT_EQUAL(whole, output(collector));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FHCollectorTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
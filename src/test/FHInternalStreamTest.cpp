@@ -8,18 +8,31 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <librevenge/librevenge.h>
 
+#include "FHInflateCache.h"
 #include "FHInternalStream.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <unistd.h>
+#endif
+
 namespace test
 {
 
+using libfreehand::FHInflateCache;
+using libfreehand::FHInflateCacheEntry;
 using libfreehand::FHInternalStream;
+using libfreehand::FHInternalStreamOptions;
 
 class FHInternalStreamTest : public CPPUNIT_NS::TestFixture
 {
@@ -31,13 +44,96 @@ private:
   CPPUNIT_TEST_SUITE(FHInternalStreamTest);
   CPPUNIT_TEST(testRead);
   CPPUNIT_TEST(testSeek);
+  CPPUNIT_TEST(testBorrow);
+  CPPUNIT_TEST(testPiecewiseRead);
+  CPPUNIT_TEST(testInflate);
+  CPPUNIT_TEST(testWindowedInflate);
+  CPPUNIT_TEST(testDamagedWindowedInflate);
+  CPPUNIT_TEST(testInflateCache);
+  CPPUNIT_TEST(testBackgroundInflate);
+  CPPUNIT_TEST(testReadValues);
+  CPPUNIT_TEST(testReadArrays);
   CPPUNIT_TEST_SUITE_END();
 
 private:
   void testRead();
   void testSeek();
+  void testBorrow();
+  void testPiecewiseRead();
+  void testInflate();
+  void testWindowedInflate();
+  void testDamagedWindowedInflate();
+  void testInflateCache();
+  void testBackgroundInflate();
+  void testReadValues();
+  void testReadArrays();
 };
 
+namespace
+{
+
+// A stream that never returns more than 3 bytes at once.
+class PiecewiseStream : public librevenge::RVNGInputStream
+{
+public:
+  PiecewiseStream(const unsigned char *data, unsigned long size)
+    : m_data(data), m_size(size), m_offset(0)
+  {
+  }
+  bool isStructured() override
+  {
+    return false;
+  }
+  unsigned subStreamCount() override
+  {
+    return 0;
+  }
+  const char *subStreamName(unsigned) override
+  {
+    return nullptr;
+  }
+  bool existsSubStream(const char *) override
+  {
+    return false;
+  }
+  librevenge::RVNGInputStream *getSubStreamByName(const char *) override
+  {
+    return nullptr;
+  }
+  librevenge::RVNGInputStream *getSubStreamById(unsigned) override
+  {
+    return nullptr;
+  }
+  const unsigned char *read(unsigned long numBytes, unsigned long &numBytesRead) override
+  {
+    numBytesRead = std::min(std::min(numBytes, 3UL), m_size - m_offset);
+    if (!numBytesRead)
+      return nullptr;
+    const unsigned char *const p = m_data + m_offset;
+    m_offset += numBytesRead;
+    return p;
+  }
+  int seek(long, librevenge::RVNG_SEEK_TYPE) override
+  {
+    return -1;
+  }
+  long tell() override
+  {
+    return long(m_offset);
+  }
+  bool isEnd() override
+  {
+    return m_offset == m_size;
+  }
+
+private:
+  const unsigned char *const m_data;
+  const unsigned long m_size;
+  unsigned long m_offset;
+};
+
+}
+
 void FHInternalStreamTest::setUp()
 {
 }
@@ -101,6 +197,370 @@ void FHInternalStreamTest::testSeek()
   CPPUNIT_ASSERT((sizeof(data) - 1) == strm.tell());
 }
 
+void FHInternalStreamTest::testBorrow()
+{
+  const unsigned char data[] = "abc dee fgh";
+  librevenge::RVNGBinaryData binData(data, sizeof(data));
+  librevenge::RVNGInputStream *const input = binData.getDataStream();
+  input->seek(4, librevenge::RVNG_SEEK_SET);
+  FHInternalStreamOptions options;
+  options.m_borrow = true;
+  FHInternalStream strm(input, 3, options);
+
+  CPPUNIT_ASSERT_EQUAL(3UL, strm.getSize());
+  unsigned long readBytes = 0;
+  const unsigned char *s = strm.read(3, readBytes);
+  CPPUNIT_ASSERT_EQUAL(3UL, readBytes);
+  CPPUNIT_ASSERT_MESSAGE("data were copied", s == binData.getDataBuffer() + 4);
+  CPPUNIT_ASSERT(strm.isEnd());
+}
+
+void FHInternalStreamTest::testPiecewiseRead()
+{
+  const unsigned char data[] = "abc dee fgh";
+  PiecewiseStream input(data, sizeof(data));
+  FHInternalStreamOptions options;
+  options.m_borrow = true;
+  FHInternalStream strm(&input, 10, options);
+
+  CPPUNIT_ASSERT_EQUAL(10UL, strm.getSize());
+  unsigned long readBytes = 0;
+  const unsigned char *s = strm.read(10, readBytes);
+  CPPUNIT_ASSERT_EQUAL(10UL, readBytes);
+  CPPUNIT_ASSERT(std::equal(data, data + 10, s));
+
+  // the input is too short
+  PiecewiseStream shortInput(data, 5);
+  FHInternalStream emptyStrm(&shortInput, 10, options);
+  CPPUNIT_ASSERT_EQUAL(0UL, emptyStrm.getSize());
+  CPPUNIT_ASSERT(emptyStrm.isEnd());
+}
+
+void FHInternalStreamTest::testInflate()
+{
+  std::vector<unsigned char> data(100000);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)(i % 251);
+  std::vector<unsigned char> compressed(compressBound(data.size()));
+  uLongf compressedSize = compressed.size();
+  CPPUNIT_ASSERT(Z_OK == compress(&compressed[0], &compressedSize, &data[0], data.size()));
+
+  librevenge::RVNGBinaryData binData(&compressed[0], compressedSize);
+  FHInternalStreamOptions options;
+  options.m_compressed = true;
+  FHInternalStream strm(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), strm.getSize());
+  unsigned long readBytes = 0;
+  const unsigned char *s = strm.read(data.size(), readBytes);
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), readBytes);
+  CPPUNIT_ASSERT(std::equal(data.begin(), data.end(), s));
+
+  // truncated data are used as far as they go
+  librevenge::RVNGBinaryData truncated(&compressed[0], compressedSize / 2);
+  FHInternalStream truncatedStrm(truncated.getDataStream(), compressedSize / 2, options);
+  CPPUNIT_ASSERT(0 < truncatedStrm.getSize());
+  CPPUNIT_ASSERT(data.size() > truncatedStrm.getSize());
+  s = truncatedStrm.read(data.size(), readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin()));
+
+  // but damaged data are not used at all
+  compressed[0] ^= 0xff;
+  librevenge::RVNGBinaryData damaged(&compressed[0], compressedSize);
+  FHInternalStream damagedStrm(damaged.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT_EQUAL(0UL, damagedStrm.getSize());
+  CPPUNIT_ASSERT(damagedStrm.isEnd());
+}
+
+void FHInternalStreamTest::testWindowedInflate()
+{
+  std::vector<unsigned char> data(200000);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)((i * 7) ^ (i >> 8));
+  std::vector<unsigned char> compressed(compressBound(data.size()));
+  uLongf compressedSize = compressed.size();
+  CPPUNIT_ASSERT(Z_OK == compress(&compressed[0], &compressedSize, &data[0], data.size()));
+  librevenge::RVNGBinaryData binData(&compressed[0], compressedSize);
+
+  FHInternalStreamOptions options;
+  options.m_compressed = true;
+  options.m_borrow = true;
+  options.m_window = 1;
+  FHInternalStream strm(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT(!strm.isEnd());
+  CPPUNIT_ASSERT(!strm.keepsAllData());
+
+  unsigned long readBytes = 0;
+  for (std::size_t i = 0; i < data.size(); i += 1000)
+  {
+    const unsigned char *s = strm.read(1000, readBytes);
+    CPPUNIT_ASSERT_EQUAL(1000UL, readBytes);
+    CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin() + i));
+
+    // short seek back
+    CPPUNIT_ASSERT(0 == strm.seek(-10, librevenge::RVNG_SEEK_CUR));
+    s = strm.read(10, readBytes);
+    CPPUNIT_ASSERT_EQUAL(10UL, readBytes);
+    CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin() + i + 990));
+
+    // what getRemainingLength does
+    const long pos = strm.tell();
+    CPPUNIT_ASSERT(0 == strm.seek(0, librevenge::RVNG_SEEK_END));
+    CPPUNIT_ASSERT_EQUAL(long(data.size()), strm.tell());
+    CPPUNIT_ASSERT(0 == strm.seek(pos, librevenge::RVNG_SEEK_SET));
+    CPPUNIT_ASSERT_EQUAL((unsigned long)(data.size() - pos), libfreehand::getRemainingLength(&strm));
+  }
+  CPPUNIT_ASSERT(strm.isEnd());
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), strm.getSize());
+
+  // long seek forward and back
+  options.m_borrow = false;
+  FHInternalStream strm2(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT(0 == strm2.seek(150000, librevenge::RVNG_SEEK_SET));
+  const unsigned char *s = strm2.read(100, readBytes);
+  CPPUNIT_ASSERT_EQUAL(100UL, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin() + 150000));
+  CPPUNIT_ASSERT(0 == strm2.seek(5, librevenge::RVNG_SEEK_SET));
+  s = strm2.read(data.size(), readBytes);
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size() - 5, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin() + 5));
+  // seeking back inflated all of the data
+  CPPUNIT_ASSERT(strm2.keepsAllData());
+  CPPUNIT_ASSERT(0 != strm2.seek(1, librevenge::RVNG_SEEK_END));
+  CPPUNIT_ASSERT(strm2.isEnd());
+}
+
+void FHInternalStreamTest::testDamagedWindowedInflate()
+{
+  std::vector<unsigned char> data(200000);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)((i * 7) ^ (i >> 8));
+  std::vector<unsigned char> compressed(compressBound(data.size()));
+  uLongf compressedSize = compressed.size();
+  CPPUNIT_ASSERT(Z_OK == compress(&compressed[0], &compressedSize, &data[0], data.size()));
+  // a wrong checksum is only found at the end of the data
+  compressed[compressedSize - 1] ^= 0xff;
+  librevenge::RVNGBinaryData binData(&compressed[0], compressedSize);
+
+  FHInternalStreamOptions options;
+  options.m_compressed = true;
+  options.m_borrow = true;
+  options.m_window = 1;
+  FHInternalStream strm(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT_EQUAL(unsigned(data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3]), unsigned(libfreehand::readU32(&strm)));
+  CPPUNIT_ASSERT(!strm.hasFailed());
+  CPPUNIT_ASSERT(strm.isDamaged());
+  CPPUNIT_ASSERT(strm.hasFailed());
+  CPPUNIT_ASSERT_EQUAL(0UL, strm.getSize());
+  unsigned long readBytes = 0;
+  CPPUNIT_ASSERT(!strm.read(10, readBytes));
+  CPPUNIT_ASSERT_EQUAL(0UL, readBytes);
+  // not even after a seek back
+  CPPUNIT_ASSERT(0 == strm.seek(0, librevenge::RVNG_SEEK_SET));
+  CPPUNIT_ASSERT(!strm.read(10, readBytes));
+
+  // reading on to the damage drops what was inflated before it
+  options.m_borrow = false;
+  FHInternalStream strm2(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT(!strm2.read(data.size(), readBytes));
+  CPPUNIT_ASSERT_EQUAL(0UL, readBytes);
+  CPPUNIT_ASSERT(strm2.hasFailed());
+  CPPUNIT_ASSERT(strm2.isEnd());
+
+  // as without a window
+  options.m_window = 0;
+  FHInternalStream wholeStrm(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT(wholeStrm.isDamaged());
+  CPPUNIT_ASSERT_EQUAL(0UL, wholeStrm.getSize());
+}
+
+void FHInternalStreamTest::testBackgroundInflate()
+{
+  std::vector<unsigned char> data(3000000);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)((i * 7) ^ (i >> 8));
+  std::vector<unsigned char> compressed(compressBound(data.size()));
+  uLongf compressedSize = compressed.size();
+  CPPUNIT_ASSERT(Z_OK == compress(&compressed[0], &compressedSize, &data[0], data.size()));
+  librevenge::RVNGBinaryData binData(&compressed[0], compressedSize);
+
+  FHInternalStreamOptions options;
+  options.m_compressed = true;
+  options.m_borrow = true;
+  options.m_background = true;
+  FHInternalStream strm(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT(strm.keepsAllData());
+  unsigned long readBytes = 0;
+  const unsigned char *s = strm.read(1000, readBytes);
+  CPPUNIT_ASSERT_EQUAL(1000UL, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin()));
+  CPPUNIT_ASSERT_EQUAL(500UL, libfreehand::getRemainingLength(&strm, 500));
+
+  // everything is kept, so seeking back is cheap
+  CPPUNIT_ASSERT(0 == strm.seek(2000000, librevenge::RVNG_SEEK_SET));
+  CPPUNIT_ASSERT(0 == strm.seek(10, librevenge::RVNG_SEEK_SET));
+  s = strm.read(data.size(), readBytes);
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size() - 10, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin() + 10));
+  CPPUNIT_ASSERT(strm.isEnd());
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), strm.getSize());
+  CPPUNIT_ASSERT_EQUAL(0UL, libfreehand::getRemainingLength(&strm, 500));
+
+  // the same through a window
+  FHInternalStreamOptions windowedOptions(options);
+  windowedOptions.m_window = 1;
+  FHInternalStream windowedStrm(binData.getDataStream(), compressedSize, windowedOptions);
+  for (std::size_t i = 0; i < data.size(); i += 4)
+    CPPUNIT_ASSERT_EQUAL(unsigned(data[i] << 24 | data[i + 1] << 16 | data[i + 2] << 8 | data[i + 3]), unsigned(windowedStrm.readU32()));
+  CPPUNIT_ASSERT(windowedStrm.isEnd());
+  CPPUNIT_ASSERT(!windowedStrm.hasFailed());
+
+  // damaged data are not used at all, as without the thread
+  std::vector<unsigned char> damaged(compressed.begin(), compressed.begin() + compressedSize);
+  damaged[damaged.size() / 2] ^= 0xff;
+  damaged[damaged.size() - 1] ^= 0xff;
+  librevenge::RVNGBinaryData damagedData(&damaged[0], damaged.size());
+  FHInternalStream damagedStrm(damagedData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT(damagedStrm.isDamaged());
+  CPPUNIT_ASSERT(damagedStrm.hasFailed());
+  CPPUNIT_ASSERT_EQUAL(0UL, damagedStrm.getSize());
+  CPPUNIT_ASSERT(!damagedStrm.read(10, readBytes));
+  unsigned long size = 0;
+  CPPUNIT_ASSERT(!damagedStrm.getData(size));
+  FHInternalStream damagedWindowedStrm(damagedData.getDataStream(), compressedSize, windowedOptions);
+  CPPUNIT_ASSERT(!damagedWindowedStrm.read(data.size(), readBytes));
+  CPPUNIT_ASSERT(damagedWindowedStrm.hasFailed());
+  CPPUNIT_ASSERT(damagedWindowedStrm.isDamaged());
+
+  // the thread stops if the stream goes away early
+  FHInternalStream unreadStrm(binData.getDataStream(), compressedSize, options);
+  CPPUNIT_ASSERT_EQUAL(data[0], libfreehand::readU8(&unreadStrm));
+}
+
+void FHInternalStreamTest::testReadValues()
+{
+  const unsigned char data[] = { 0x12, 0x34, 0x56, 0x78, 0xff, 0xff, 0xff, 0x00, 0x00, 0x01, 0xff, 0xfe, 0x80, 0x00, 0xab, 0xcd };
+  librevenge::RVNGBinaryData binData(data, sizeof(data));
+  FHInternalStream strm(binData.getDataStream(), binData.size());
+
+  CPPUNIT_ASSERT_EQUAL(0x12345678U, unsigned(libfreehand::readU32(&strm)));
+  CPPUNIT_ASSERT_EQUAL(0x1ff00U - 0xff00, strm.readRecordId());
+  CPPUNIT_ASSERT_EQUAL(1U, strm.readRecordId());
+  CPPUNIT_ASSERT_EQUAL(-1.5, strm.readCoordinate());
+  CPPUNIT_ASSERT_EQUAL(long(sizeof(data) - 2), strm.tell());
+  CPPUNIT_ASSERT_EQUAL(2UL, libfreehand::getRemainingLength(&strm));
+  CPPUNIT_ASSERT_EQUAL(0xabU, unsigned(libfreehand::readU8(&strm)));
+
+  CPPUNIT_ASSERT(!strm.hasFailed());
+
+  // a value that is cut off is skipped
+  CPPUNIT_ASSERT_EQUAL(0U, unsigned(libfreehand::readU16(&strm)));
+  CPPUNIT_ASSERT(strm.hasFailed());
+  CPPUNIT_ASSERT(strm.isEnd());
+
+  // the failure is remembered
+  strm.seek(0, librevenge::RVNG_SEEK_SET);
+  CPPUNIT_ASSERT_EQUAL(0x12U, unsigned(libfreehand::readU8(&strm)));
+  CPPUNIT_ASSERT(strm.hasFailed());
+  strm.clearFailure();
+  CPPUNIT_ASSERT(!strm.hasFailed());
+}
+
+void FHInternalStreamTest::testInflateCache()
+{
+#ifdef HAVE_SYS_MMAN_H
+  std::vector<unsigned char> data(100000);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)(i % 253);
+  std::vector<unsigned char> compressed(compressBound(data.size()));
+  uLongf compressedSize = compressed.size();
+  CPPUNIT_ASSERT(Z_OK == compress(&compressed[0], &compressedSize, &data[0], data.size()));
+
+  char dirTemplate[] = "/tmp/fhinflatecacheXXXXXX";
+  const char *const dir = mkdtemp(dirTemplate);
+  CPPUNIT_ASSERT(dir);
+
+  FHInflateCache cache(dir, 1024 * 1024);
+  const std::string name = cache.getEntryName(&compressed[0], compressedSize);
+  CPPUNIT_ASSERT_EQUAL(std::string::size_type(32), name.size());
+  CPPUNIT_ASSERT(!cache.find(name));
+
+  // the first stream stores the inflated data, the second one uses them
+  for (int i = 0; i != 2; ++i)
+  {
+    librevenge::RVNGBinaryData binData(&compressed[0], compressedSize);
+    FHInternalStreamOptions options;
+    options.m_compressed = true;
+    options.m_cache = &cache;
+    FHInternalStream strm(binData.getDataStream(), compressedSize, options);
+    CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), strm.getSize());
+    unsigned long readBytes = 0;
+    const unsigned char *s = strm.read(data.size(), readBytes);
+    CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), readBytes);
+    CPPUNIT_ASSERT(std::equal(data.begin(), data.end(), s));
+
+    std::unique_ptr<FHInflateCacheEntry> entry = cache.find(name);
+    CPPUNIT_ASSERT(bool(entry));
+    CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), entry->getSize());
+  }
+
+  // entries beyond the size limit are removed
+  FHInflateCache smallCache(dir, 1000);
+  smallCache.store(smallCache.getEntryName(&data[0], 100), &data[0], 500);
+  CPPUNIT_ASSERT(!smallCache.find(name));
+
+  unlink((std::string(dir) + "/" + smallCache.getEntryName(&data[0], 100)).c_str());
+  unlink((std::string(dir) + "/key").c_str());
+  CPPUNIT_ASSERT_EQUAL(0, rmdir(dir));
+#endif
+}
+
+void FHInternalStreamTest::testReadArrays()
+{
+  std::vector<unsigned char> data(1001);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)(i * 37 + (i >> 3));
+  // some escaped record ids
+  data[100] = data[101] = data[306] = data[307] = data[400] = data[401] = 0xff;
+  librevenge::RVNGBinaryData binData(&data[0], data.size());
+
+  // bulk reads give the same as reading values one by one, even at the end
+  for (unsigned long offset = 0; offset < 40; offset += 13)
+  {
+    for (unsigned long count = 1; count < 600; count += 37)
+    {
+      FHInternalStream values(binData.getDataStream(), binData.size());
+      FHInternalStream arrays(binData.getDataStream(), binData.size());
+
+      values.seek(long(offset), librevenge::RVNG_SEEK_SET);
+      arrays.seek(long(offset), librevenge::RVNG_SEEK_SET);
+      std::vector<uint16_t> u16(count);
+      arrays.readU16Array(&u16[0], count);
+      for (unsigned long i = 0; i < count; ++i)
+        CPPUNIT_ASSERT_EQUAL(values.readU16(), u16[i]);
+      CPPUNIT_ASSERT_EQUAL(values.tell(), arrays.tell());
+      CPPUNIT_ASSERT_EQUAL(values.hasFailed(), arrays.hasFailed());
+
+      values.seek(long(offset), librevenge::RVNG_SEEK_SET);
+      arrays.seek(long(offset), librevenge::RVNG_SEEK_SET);
+      std::vector<double> coords(count);
+      arrays.readS32FixedArray(&coords[0], count);
+      for (unsigned long i = 0; i < count; ++i)
+        CPPUNIT_ASSERT_EQUAL(values.readCoordinate(), coords[i]);
+      CPPUNIT_ASSERT_EQUAL(values.tell(), arrays.tell());
+      CPPUNIT_ASSERT_EQUAL(values.hasFailed(), arrays.hasFailed());
+
+      values.seek(long(offset), librevenge::RVNG_SEEK_SET);
+      arrays.seek(long(offset), librevenge::RVNG_SEEK_SET);
+      std::vector<unsigned> ids(count);
+      arrays.readRecordIdArray(&ids[0], count);
+      for (unsigned long i = 0; i < count; ++i)
+        CPPUNIT_ASSERT_EQUAL(values.readRecordId(), ids[i]);
+      CPPUNIT_ASSERT_EQUAL(values.tell(), arrays.tell());
+      CPPUNIT_ASSERT_EQUAL(values.hasFailed(), arrays.hasFailed());
+    }
+  }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(FHInternalStreamTest);
 
 }
@@ -0,0 +1,93 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+
+#include "FHParser.h"
+#include "FHRecordIndex.h"
+
+namespace test
+{
+
+using libfreehand::FHParser;
+using libfreehand::FHRecordIndex;
+
+class FHParserTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FHParserTest);
+  CPPUNIT_TEST(testRecordLayouts);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testRecordLayouts();
+};
+
+void FHParserTest::setUp()
+{
+}
+
+void FHParserTest::tearDown()
+{
+}
+
+void FHParserTest::testRecordLayouts()
+{
+  // The documents have records that are only skipped, by their layouts
+  // in tokens.txt, between records that are decoded by their readers.
+  // Both walks must find the records at the same offsets, one after the
+  // other, and the tail after the last.
+  const char *const names[] = { "page.fh3", "page.fh5", "page.fh9", "page.fh11", "many.fh11" };
+  for (unsigned i = 0; i != sizeof(names) / sizeof(names[0]); ++i)
+  {
+    std::ifstream file((std::string(TDOC) + "/" + names[i]).c_str(), std::ios::binary);
+    CPPUNIT_ASSERT_MESSAGE(names[i], file.is_open());
+    const std::vector<unsigned char> document((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    librevenge::RVNGBinaryData data(&document[0], document.size());
+
+    FHRecordIndex skipped;
+    FHParser skippingParser;
+    CPPUNIT_ASSERT_MESSAGE(names[i], skippingParser.buildRecordIndex(data.getDataStream(), skipped));
+    FHRecordIndex decoded;
+    FHParser decodingParser;
+    CPPUNIT_ASSERT_MESSAGE(names[i], decodingParser.buildDecodedRecordIndex(data.getDataStream(), decoded));
+
+    CPPUNIT_ASSERT_MESSAGE(names[i], skipped.size() > 0);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], decoded.size(), skipped.size());
+    unsigned long offset = skipped.begin()->m_offset;
+    for (FHRecordIndex::const_iterator it = skipped.begin(), jt = decoded.begin(); it != skipped.end(); ++it, ++jt)
+    {
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], jt->m_record, it->m_record);
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], offset, (unsigned long)it->m_offset);
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], jt->m_offset, it->m_offset);
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], jt->m_length, it->m_length);
+      offset += it->m_length;
+    }
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], offset, skipped.getTailOffset());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], decoded.getTailOffset(), skipped.getTailOffset());
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FHParserTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
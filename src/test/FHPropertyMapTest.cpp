@@ -0,0 +1,108 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "FHTypes.h"
+
+namespace test
+{
+
+typedef libfreehand::FHPropertyMap<double, 3> FHDoubleMap;
+
+class FHPropertyMapTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FHPropertyMapTest);
+  CPPUNIT_TEST(testSet);
+  CPPUNIT_TEST(testFind);
+  CPPUNIT_TEST(testFull);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testSet();
+  void testFind();
+  void testFull();
+};
+
+void FHPropertyMapTest::setUp()
+{
+}
+
+void FHPropertyMapTest::tearDown()
+{
+}
+
+void FHPropertyMapTest::testSet()
+{
+  FHDoubleMap map;
+  CPPUNIT_ASSERT(map.empty());
+  CPPUNIT_ASSERT(map.begin() == map.end());
+
+  CPPUNIT_ASSERT(map.set(30, 3.0));
+  CPPUNIT_ASSERT(map.set(10, 1.0));
+  CPPUNIT_ASSERT(map.set(20, 2.0));
+  CPPUNIT_ASSERT(!map.empty());
+  CPPUNIT_ASSERT_EQUAL(3u, map.size());
+
+  // iterated by id, as a std::map would be
+  FHDoubleMap::const_iterator it = map.begin();
+  CPPUNIT_ASSERT_EQUAL(10u, it->first);
+  CPPUNIT_ASSERT_EQUAL(1.0, it->second);
+  ++it;
+  CPPUNIT_ASSERT_EQUAL(20u, it->first);
+  ++it;
+  CPPUNIT_ASSERT_EQUAL(30u, it->first);
+  CPPUNIT_ASSERT_EQUAL(3.0, it->second);
+  ++it;
+  CPPUNIT_ASSERT(it == map.end());
+
+  CPPUNIT_ASSERT(map.set(20, 4.0));
+  CPPUNIT_ASSERT_EQUAL(3u, map.size());
+  CPPUNIT_ASSERT_EQUAL(4.0, map.find(20)->second);
+}
+
+void FHPropertyMapTest::testFind()
+{
+  FHDoubleMap map;
+  CPPUNIT_ASSERT(map.find(10) == map.end());
+  map.set(20, 2.0);
+  map.set(10, 1.0);
+  CPPUNIT_ASSERT(map.find(10) != map.end());
+  CPPUNIT_ASSERT_EQUAL(1.0, map.find(10)->second);
+  CPPUNIT_ASSERT_EQUAL(2.0, map.find(20)->second);
+  CPPUNIT_ASSERT(map.find(5) == map.end());
+  CPPUNIT_ASSERT(map.find(15) == map.end());
+  CPPUNIT_ASSERT(map.find(25) == map.end());
+}
+
+void FHPropertyMapTest::testFull()
+{
+  FHDoubleMap map;
+  map.set(1, 1.0);
+  map.set(2, 2.0);
+  map.set(3, 3.0);
+  CPPUNIT_ASSERT(!map.set(4, 4.0));
+  CPPUNIT_ASSERT(map.find(4) == map.end());
+  CPPUNIT_ASSERT_EQUAL(3u, map.size());
+  // a value that is already there can still be changed
+  CPPUNIT_ASSERT(map.set(2, 5.0));
+  CPPUNIT_ASSERT_EQUAL(5.0, map.find(2)->second);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FHPropertyMapTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,177 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <string>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "FHRecordGraph.h"
+
+namespace test
+{
+
+using libfreehand::FHRecordGraph;
+
+class FHRecordGraphTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FHRecordGraphTest);
+  CPPUNIT_TEST(testReferences);
+  CPPUNIT_TEST(testReachable);
+  CPPUNIT_TEST(testStartAgain);
+  CPPUNIT_TEST(testEmpty);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testReferences();
+  void testReachable();
+  void testStartAgain();
+  void testEmpty();
+};
+
+namespace
+{
+
+// The tail refers to 1, which refers to 2 and 3; 4 refers to 3 and to
+// itself; 5 refers to nothing.
+void createGraph(FHRecordGraph &graph)
+{
+  graph.reset(5);
+  graph.startRecord(1, "Group");
+  graph.addReference(2);
+  graph.addReference(0);
+  graph.addReference(3);
+  graph.setRecordSize(1, 12);
+  graph.startRecord(2, "Path");
+  graph.startRecord(4, "List");
+  graph.addReference(3);
+  graph.addReference(4);
+  graph.addReference(6);
+  graph.startRecord(5, "Color");
+  graph.startTail();
+  graph.addReference(1);
+  graph.finish();
+}
+
+}
+
+void FHRecordGraphTest::setUp()
+{
+}
+
+void FHRecordGraphTest::tearDown()
+{
+}
+
+void FHRecordGraphTest::testReferences()
+{
+  FHRecordGraph graph;
+  createGraph(graph);
+  CPPUNIT_ASSERT_EQUAL(5u, graph.getRecordCount());
+
+  unsigned count = 0;
+  const unsigned *references = graph.getReferences(0, count);
+  CPPUNIT_ASSERT_EQUAL(1u, count);
+  CPPUNIT_ASSERT_EQUAL(1u, references[0]);
+  references = graph.getReferences(1, count);
+  CPPUNIT_ASSERT_EQUAL(2u, count);
+  CPPUNIT_ASSERT_EQUAL(2u, references[0]);
+  CPPUNIT_ASSERT_EQUAL(3u, references[1]);
+  CPPUNIT_ASSERT(!graph.getReferences(2, count));
+  CPPUNIT_ASSERT_EQUAL(0u, count);
+  CPPUNIT_ASSERT(!graph.getReferences(3, count));
+  references = graph.getReferences(4, count);
+  CPPUNIT_ASSERT_EQUAL(2u, count);
+  CPPUNIT_ASSERT_EQUAL(3u, references[0]);
+  CPPUNIT_ASSERT_EQUAL(4u, references[1]);
+  CPPUNIT_ASSERT(!graph.getReferences(6, count));
+  CPPUNIT_ASSERT_EQUAL(0u, count);
+
+  const unsigned *offsets = graph.getOffsets();
+  CPPUNIT_ASSERT_EQUAL(0u, offsets[0]);
+  CPPUNIT_ASSERT_EQUAL(1u, offsets[1]);
+  CPPUNIT_ASSERT_EQUAL(3u, offsets[2]);
+  CPPUNIT_ASSERT_EQUAL(5u, offsets[6]);
+  CPPUNIT_ASSERT_EQUAL(2u, graph.getTargets()[1]);
+
+  CPPUNIT_ASSERT_EQUAL(std::string("List"), std::string(graph.getRecordType(4)));
+  CPPUNIT_ASSERT(!graph.getRecordType(3));
+  CPPUNIT_ASSERT_EQUAL(12ul, graph.getRecordSize(1));
+  CPPUNIT_ASSERT_EQUAL(0ul, graph.getRecordSize(2));
+}
+
+void FHRecordGraphTest::testReachable()
+{
+  FHRecordGraph graph;
+  createGraph(graph);
+  CPPUNIT_ASSERT(graph.isReachable(0));
+  CPPUNIT_ASSERT(graph.isReachable(1));
+  CPPUNIT_ASSERT(graph.isReachable(2));
+  CPPUNIT_ASSERT(graph.isReachable(3));
+  CPPUNIT_ASSERT(!graph.isReachable(4));
+  CPPUNIT_ASSERT(!graph.isReachable(5));
+  CPPUNIT_ASSERT(!graph.isReachable(6));
+}
+
+void FHRecordGraphTest::testStartAgain()
+{
+  FHRecordGraph graph;
+  graph.reset(4);
+  graph.startRecord(1, "Group");
+  graph.addReference(4);
+  graph.startRecord(2, "List");
+  graph.addReference(1);
+  graph.startRecord(3, "List");
+  graph.addReference(1);
+  // records 2 and 3 were misread
+  graph.startRecord(2, "Path");
+  graph.startRecord(4, "Path");
+  graph.addReference(2);
+  graph.finish();
+
+  unsigned count = 0;
+  const unsigned *references = graph.getReferences(1, count);
+  CPPUNIT_ASSERT_EQUAL(1u, count);
+  CPPUNIT_ASSERT_EQUAL(4u, references[0]);
+  CPPUNIT_ASSERT(!graph.getReferences(2, count));
+  CPPUNIT_ASSERT(!graph.getReferences(3, count));
+  CPPUNIT_ASSERT(!graph.getRecordType(3));
+  references = graph.getReferences(4, count);
+  CPPUNIT_ASSERT_EQUAL(1u, count);
+  CPPUNIT_ASSERT_EQUAL(2u, references[0]);
+  // there is no tail
+  CPPUNIT_ASSERT(!graph.isReachable(1));
+}
+
+void FHRecordGraphTest::testEmpty()
+{
+  FHRecordGraph graph;
+  CPPUNIT_ASSERT_EQUAL(0u, graph.getRecordCount());
+  CPPUNIT_ASSERT_EQUAL(0u, graph.getOffsets()[1]);
+  CPPUNIT_ASSERT(!graph.getTargets());
+
+  createGraph(graph);
+  graph.clear();
+  CPPUNIT_ASSERT_EQUAL(0u, graph.getRecordCount());
+  unsigned count = 1;
+  CPPUNIT_ASSERT(!graph.getReferences(0, count));
+  CPPUNIT_ASSERT_EQUAL(0u, count);
+  CPPUNIT_ASSERT(graph.isReachable(0));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FHRecordGraphTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,159 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "FHRecordIndex.h"
+
+namespace test
+{
+
+using libfreehand::FHRecordIndex;
+using libfreehand::FHRecordIndexEntry;
+
+class FHRecordIndexTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FHRecordIndexTest);
+  CPPUNIT_TEST(testFind);
+  CPPUNIT_TEST(testRemoveAfter);
+  CPPUNIT_TEST(testReadWrite);
+  CPPUNIT_TEST(testReadInvalid);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testFind();
+  void testRemoveAfter();
+  void testReadWrite();
+  void testReadInvalid();
+};
+
+namespace
+{
+
+void createIndex(FHRecordIndex &index)
+{
+  index.append(1, 10, 0, 20);
+  index.append(2, 11, 20, 4);
+  index.append(4, 10, 24, 100000);
+  index.append(70000, 12, 100024, 6);
+  index.setTailOffset(100030);
+}
+
+}
+
+void FHRecordIndexTest::setUp()
+{
+}
+
+void FHRecordIndexTest::tearDown()
+{
+}
+
+void FHRecordIndexTest::testFind()
+{
+  FHRecordIndex index;
+  CPPUNIT_ASSERT(!index.find(1));
+
+  createIndex(index);
+  CPPUNIT_ASSERT_EQUAL(4ul, index.size());
+  const FHRecordIndexEntry *entry = index.find(4);
+  CPPUNIT_ASSERT(entry);
+  CPPUNIT_ASSERT_EQUAL(4u, unsigned(entry->m_record));
+  CPPUNIT_ASSERT_EQUAL(10u, unsigned(entry->m_token));
+  CPPUNIT_ASSERT_EQUAL(24u, unsigned(entry->m_offset));
+  CPPUNIT_ASSERT_EQUAL(100000u, unsigned(entry->m_length));
+  entry = index.find(70000);
+  CPPUNIT_ASSERT(entry);
+  CPPUNIT_ASSERT_EQUAL(100024u, unsigned(entry->m_offset));
+  CPPUNIT_ASSERT(!index.find(0));
+  CPPUNIT_ASSERT(!index.find(3));
+  CPPUNIT_ASSERT(!index.find(70001));
+}
+
+void FHRecordIndexTest::testRemoveAfter()
+{
+  FHRecordIndex index;
+  createIndex(index);
+  index.removeAfter(70000);
+  CPPUNIT_ASSERT_EQUAL(4ul, index.size());
+  index.removeAfter(3);
+  CPPUNIT_ASSERT_EQUAL(2ul, index.size());
+  CPPUNIT_ASSERT(index.find(2));
+  CPPUNIT_ASSERT(!index.find(4));
+
+  // records can be appended again
+  index.append(3, 10, 24, 8);
+  CPPUNIT_ASSERT(index.find(3));
+  index.removeAfter(0);
+  CPPUNIT_ASSERT(index.empty());
+}
+
+void FHRecordIndexTest::testReadWrite()
+{
+  FHRecordIndex index;
+  createIndex(index);
+  std::vector<unsigned char> data;
+  index.write(data);
+
+  FHRecordIndex copy;
+  CPPUNIT_ASSERT(copy.read(&data[0], data.size()));
+  CPPUNIT_ASSERT_EQUAL(index.size(), copy.size());
+  CPPUNIT_ASSERT_EQUAL(100030ul, copy.getTailOffset());
+  for (FHRecordIndex::const_iterator it = index.begin(), copyIt = copy.begin(); it != index.end(); ++it, ++copyIt)
+  {
+    CPPUNIT_ASSERT_EQUAL(it->m_record, copyIt->m_record);
+    CPPUNIT_ASSERT_EQUAL(it->m_token, copyIt->m_token);
+    CPPUNIT_ASSERT_EQUAL(it->m_offset, copyIt->m_offset);
+    CPPUNIT_ASSERT_EQUAL(it->m_length, copyIt->m_length);
+  }
+
+  FHRecordIndex empty;
+  empty.write(data);
+  CPPUNIT_ASSERT(copy.read(&data[0], data.size()));
+  CPPUNIT_ASSERT(copy.empty());
+}
+
+void FHRecordIndexTest::testReadInvalid()
+{
+  FHRecordIndex index;
+  createIndex(index);
+  std::vector<unsigned char> data;
+  index.write(data);
+
+  FHRecordIndex copy;
+  // truncated
+  CPPUNIT_ASSERT(!copy.read(&data[0], data.size() - 1));
+  CPPUNIT_ASSERT(copy.empty());
+  CPPUNIT_ASSERT(!copy.read(&data[0], 3));
+
+  // not an index
+  std::vector<unsigned char> broken(data);
+  broken[0] = 'X';
+  CPPUNIT_ASSERT(!copy.read(&broken[0], broken.size()));
+
+  // records out of order
+  broken = data;
+  broken[16 + 3] = 5;
+  CPPUNIT_ASSERT(!copy.read(&broken[0], broken.size()));
+  CPPUNIT_ASSERT(copy.empty());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FHRecordIndexTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
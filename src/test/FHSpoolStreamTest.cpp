@@ -0,0 +1,169 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+
+#include "FHSpoolStream.h"
+
+namespace test
+{
+
+using libfreehand::FHSpoolStream;
+
+class FHSpoolStreamTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FHSpoolStreamTest);
+  CPPUNIT_TEST(testMemory);
+  CPPUNIT_TEST(testFile);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testMemory();
+  void testFile();
+};
+
+namespace
+{
+
+// A stream that cannot seek, like a pipe
+class PipeStream : public librevenge::RVNGInputStream
+{
+public:
+  PipeStream(const unsigned char *data, unsigned long size)
+    : m_data(data), m_size(size), m_offset(0)
+  {
+  }
+  bool isStructured() override
+  {
+    return false;
+  }
+  unsigned subStreamCount() override
+  {
+    return 0;
+  }
+  const char *subStreamName(unsigned) override
+  {
+    return nullptr;
+  }
+  bool existsSubStream(const char *) override
+  {
+    return false;
+  }
+  librevenge::RVNGInputStream *getSubStreamByName(const char *) override
+  {
+    return nullptr;
+  }
+  librevenge::RVNGInputStream *getSubStreamById(unsigned) override
+  {
+    return nullptr;
+  }
+  const unsigned char *read(unsigned long numBytes, unsigned long &numBytesRead) override
+  {
+    numBytesRead = std::min(std::min(numBytes, 1000UL), m_size - m_offset);
+    if (!numBytesRead)
+      return nullptr;
+    const unsigned char *const p = m_data + m_offset;
+    m_offset += numBytesRead;
+    return p;
+  }
+  int seek(long, librevenge::RVNG_SEEK_TYPE) override
+  {
+    return -1;
+  }
+  long tell() override
+  {
+    return long(m_offset);
+  }
+  bool isEnd() override
+  {
+    return m_offset == m_size;
+  }
+
+private:
+  const unsigned char *const m_data;
+  const unsigned long m_size;
+  unsigned long m_offset;
+};
+
+std::vector<unsigned char> createData()
+{
+  std::vector<unsigned char> data(100000);
+  for (std::size_t i = 0; i != data.size(); ++i)
+    data[i] = (unsigned char)(i % 253);
+  return data;
+}
+
+void checkStream(FHSpoolStream &strm, const std::vector<unsigned char> &data)
+{
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size(), strm.getSize());
+  CPPUNIT_ASSERT(FHSpoolStream::isSeekable(&strm));
+
+  CPPUNIT_ASSERT(0 == strm.seek(-10, librevenge::RVNG_SEEK_END));
+  unsigned long readBytes = 0;
+  const unsigned char *s = strm.read(100, readBytes);
+  CPPUNIT_ASSERT_EQUAL(10UL, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.end() - 10));
+  CPPUNIT_ASSERT(strm.isEnd());
+
+  CPPUNIT_ASSERT(0 == strm.seek(5, librevenge::RVNG_SEEK_SET));
+  s = strm.read(data.size(), readBytes);
+  CPPUNIT_ASSERT_EQUAL((unsigned long)data.size() - 5, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin() + 5));
+
+  CPPUNIT_ASSERT(0 != strm.seek(1, librevenge::RVNG_SEEK_END));
+  CPPUNIT_ASSERT(strm.isEnd());
+}
+
+}
+
+void FHSpoolStreamTest::setUp()
+{
+}
+
+void FHSpoolStreamTest::tearDown()
+{
+}
+
+void FHSpoolStreamTest::testMemory()
+{
+  const std::vector<unsigned char> data = createData();
+  PipeStream input(&data[0], data.size());
+  CPPUNIT_ASSERT(!FHSpoolStream::isSeekable(&input));
+
+  FHSpoolStream strm(&input);
+  CPPUNIT_ASSERT(strm.isInMemory());
+  checkStream(strm, data);
+}
+
+void FHSpoolStreamTest::testFile()
+{
+  const std::vector<unsigned char> data = createData();
+  PipeStream input(&data[0], data.size());
+
+  FHSpoolStream strm(&input, 10000);
+  // tmpfile() might not be usable here, then everything stays in memory
+  checkStream(strm, data);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FHSpoolStreamTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,202 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+#include <libfreehand/libfreehand.h>
+
+namespace test
+{
+
+using libfreehand::FreeHandDocument;
+
+class FreeHandDocumentTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FreeHandDocumentTest);
+  CPPUNIT_TEST(testSniffSupported);
+  CPPUNIT_TEST(testSniffUnsupported);
+  CPPUNIT_TEST(testSniffNeedMoreData);
+  CPPUNIT_TEST(testSniffWrapped);
+  CPPUNIT_TEST(testSniffPrefix);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testSniffSupported();
+  void testSniffUnsupported();
+  void testSniffNeedMoreData();
+  void testSniffWrapped();
+  void testSniffPrefix();
+};
+
+namespace
+{
+
+void appendU32(std::vector<unsigned char> &data, unsigned value)
+{
+  data.push_back((unsigned char)(value >> 24));
+  data.push_back((unsigned char)(value >> 16));
+  data.push_back((unsigned char)(value >> 8));
+  data.push_back((unsigned char)value);
+}
+
+void appendString(std::vector<unsigned char> &data, const char *str)
+{
+  for (; *str; ++str)
+    data.push_back((unsigned char)*str);
+}
+
+/* A document wrapped in records, as FreeHand stores it in some files:
+ * a short record, a long 0x080a record with something else than a
+ * document, and a long 0x080a record with the document. Returns the
+ * offset of the document.
+ */
+unsigned long createWrappedDocument(std::vector<unsigned char> &data)
+{
+  data.clear();
+  const unsigned char shortRecord[] = { 0x1c, 0x01, 0x02, 0x00, 0x03, 'a', 'b', 'c' };
+  data.insert(data.end(), shortRecord, shortRecord + sizeof(shortRecord));
+  const unsigned char longRecord[] = { 0x1c, 0x08, 0x0a, 0x80, 0x04 };
+  data.insert(data.end(), longRecord, longRecord + sizeof(longRecord));
+  appendU32(data, 6);
+  appendString(data, "PICT01");
+  data.insert(data.end(), longRecord, longRecord + sizeof(longRecord));
+  appendU32(data, 12);
+  const unsigned long offset = data.size();
+  appendString(data, "AGD4");
+  appendU32(data, 0);
+  appendU32(data, 0);
+  return offset;
+}
+
+FreeHandDocument::SniffResult sniff(const std::vector<unsigned char> &data, unsigned long size)
+{
+  return FreeHandDocument::sniff(size ? &data[0] : nullptr, size);
+}
+
+}
+
+void FreeHandDocumentTest::setUp()
+{
+}
+
+void FreeHandDocumentTest::tearDown()
+{
+}
+
+void FreeHandDocumentTest::testSniffSupported()
+{
+  const unsigned char fh11[] = { 'A', 'G', 'D', '6', 0, 0, 0, 0 };
+  int version = 0;
+  unsigned long agdOffset = 1;
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_SUPPORTED, FreeHandDocument::sniff(fh11, sizeof(fh11), &version, &agdOffset));
+  CPPUNIT_ASSERT_EQUAL(11, version);
+  CPPUNIT_ASSERT_EQUAL(0UL, agdOffset);
+
+  const unsigned char fh8[] = { 'A', 'G', 'D', '3' };
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_SUPPORTED, FreeHandDocument::sniff(fh8, sizeof(fh8), &version));
+  CPPUNIT_ASSERT_EQUAL(8, version);
+
+  const unsigned char fh3[] = { 'F', 'H', '3', 0x01, 0, 0 };
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_SUPPORTED, FreeHandDocument::sniff(fh3, sizeof(fh3), &version, &agdOffset));
+  CPPUNIT_ASSERT_EQUAL(3, version);
+  CPPUNIT_ASSERT_EQUAL(0UL, agdOffset);
+
+  // the results are optional
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_SUPPORTED, FreeHandDocument::sniff(fh11, sizeof(fh11)));
+}
+
+void FreeHandDocumentTest::testSniffUnsupported()
+{
+  const unsigned char pdf[] = { '%', 'P', 'D', 'F', '-', '1', '.', '4' };
+  int version = 0;
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_UNSUPPORTED, FreeHandDocument::sniff(pdf, sizeof(pdf), &version));
+  CPPUNIT_ASSERT_EQUAL(0, version);
+
+  // not a record
+  std::vector<unsigned char> data;
+  createWrappedDocument(data);
+  data[8] = 0x1d;
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_UNSUPPORTED, sniff(data, data.size()));
+
+  // a long record must give its length in 4 bytes
+  createWrappedDocument(data);
+  data[12] = 0x02;
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_UNSUPPORTED, sniff(data, data.size()));
+
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_UNSUPPORTED, FreeHandDocument::sniff(nullptr, 4));
+}
+
+void FreeHandDocumentTest::testSniffNeedMoreData()
+{
+  const unsigned char agd[] = { 'A', 'G', 'D' };
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, FreeHandDocument::sniff(agd, sizeof(agd)));
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, FreeHandDocument::sniff(agd, 0));
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, FreeHandDocument::sniff(nullptr, 0));
+
+  // whole records, but no document in them yet
+  std::vector<unsigned char> data;
+  createWrappedDocument(data);
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, sniff(data, 8));
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, sniff(data, 23));
+}
+
+void FreeHandDocumentTest::testSniffWrapped()
+{
+  std::vector<unsigned char> data;
+  const unsigned long offset = createWrappedDocument(data);
+  int version = 0;
+  unsigned long agdOffset = 0;
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_SUPPORTED, FreeHandDocument::sniff(&data[0], data.size(), &version, &agdOffset));
+  CPPUNIT_ASSERT_EQUAL(9, version);
+  CPPUNIT_ASSERT_EQUAL(offset, agdOffset);
+
+  // isSupported walks the records the same way
+  librevenge::RVNGBinaryData binData(&data[0], data.size());
+  CPPUNIT_ASSERT(FreeHandDocument::isSupported(binData.getDataStream()));
+
+  // a record that is not 0x080a is skipped, even if it holds a document
+  data[offset - 7] = 0x09;
+  CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, sniff(data, data.size()));
+}
+
+void FreeHandDocumentTest::testSniffPrefix()
+{
+  std::vector<unsigned char> data;
+  const unsigned long offset = createWrappedDocument(data);
+
+  // cut anywhere before the end of the AGD signature, inside a record
+  // header, a length or a payload
+  for (unsigned long size = 0; size < offset + 4; ++size)
+    CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, sniff(data, size));
+  for (unsigned long size = offset + 4; size <= data.size(); ++size)
+  {
+    unsigned long agdOffset = 0;
+    CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_SUPPORTED, FreeHandDocument::sniff(&data[0], size, nullptr, &agdOffset));
+    CPPUNIT_ASSERT_EQUAL(offset, agdOffset);
+  }
+
+  const unsigned char agd[] = { 'A', 'G', 'D', '4', 0, 0 };
+  for (unsigned long size = 0; size < 4; ++size)
+    CPPUNIT_ASSERT_EQUAL(FreeHandDocument::SNIFF_NEED_MORE_DATA, FreeHandDocument::sniff(agd, size));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FreeHandDocumentTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,130 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+#include <libfreehand/FreeHandMappedStream.h>
+
+#include "libfreehand_utils.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <unistd.h>
+#endif
+
+namespace test
+{
+
+using libfreehand::FreeHandMappedStream;
+
+class FreeHandMappedStreamTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FreeHandMappedStreamTest);
+  CPPUNIT_TEST(testRead);
+  CPPUNIT_TEST(testNotMapped);
+  CPPUNIT_TEST(testMissing);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testRead();
+  void testNotMapped();
+  void testMissing();
+};
+
+void FreeHandMappedStreamTest::setUp()
+{
+}
+
+void FreeHandMappedStreamTest::tearDown()
+{
+}
+
+void FreeHandMappedStreamTest::testRead()
+{
+  // the file is mapped if there is mmap, and read into memory otherwise
+  const std::string name = std::string(TDOC) + "/many.fh11";
+  std::ifstream file(name.c_str(), std::ios::binary);
+  CPPUNIT_ASSERT(file.is_open());
+  const std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  CPPUNIT_ASSERT(data.size() > 1000);
+
+  FreeHandMappedStream strm(name.c_str());
+  CPPUNIT_ASSERT(strm.isOpen());
+  CPPUNIT_ASSERT(!strm.isStructured());
+
+  unsigned long readBytes = 0;
+  const unsigned char *s = strm.read(1000, readBytes);
+  CPPUNIT_ASSERT_EQUAL(1000UL, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.begin()));
+
+  // the data are not copied, so reading again gives the same pointer
+  CPPUNIT_ASSERT(0 == strm.seek(0, librevenge::RVNG_SEEK_SET));
+  CPPUNIT_ASSERT(s == strm.read(1000, readBytes));
+
+  CPPUNIT_ASSERT(0 == strm.seek(-10, librevenge::RVNG_SEEK_END));
+  s = strm.read(100, readBytes);
+  CPPUNIT_ASSERT_EQUAL(10UL, readBytes);
+  CPPUNIT_ASSERT(std::equal(s, s + readBytes, data.end() - 10));
+  CPPUNIT_ASSERT(strm.isEnd());
+  CPPUNIT_ASSERT(!strm.read(1, readBytes));
+  CPPUNIT_ASSERT_EQUAL(0UL, readBytes);
+
+  CPPUNIT_ASSERT(0 != strm.seek(-1, librevenge::RVNG_SEEK_SET));
+  CPPUNIT_ASSERT_EQUAL(0L, strm.tell());
+}
+
+void FreeHandMappedStreamTest::testNotMapped()
+{
+#ifdef HAVE_SYS_MMAN_H
+  // an empty file cannot be mapped, so it is read instead
+  char name[] = "/tmp/fhmappedXXXXXX";
+  const int fd = mkstemp(name);
+  CPPUNIT_ASSERT(fd >= 0);
+  close(fd);
+
+  {
+    FreeHandMappedStream strm(name);
+    CPPUNIT_ASSERT(strm.isOpen());
+    CPPUNIT_ASSERT(strm.isEnd());
+    unsigned long readBytes = 1;
+    CPPUNIT_ASSERT(!strm.read(1, readBytes));
+    CPPUNIT_ASSERT_EQUAL(0UL, readBytes);
+  }
+
+  unlink(name);
+#endif
+}
+
+void FreeHandMappedStreamTest::testMissing()
+{
+  FreeHandMappedStream strm("/nonexistent/file.fh11");
+  CPPUNIT_ASSERT(!strm.isOpen());
+  CPPUNIT_ASSERT(strm.isEnd());
+  unsigned long readBytes = 1;
+  CPPUNIT_ASSERT(!strm.read(1, readBytes));
+  CPPUNIT_ASSERT_EQUAL(0UL, readBytes);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FreeHandMappedStreamTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
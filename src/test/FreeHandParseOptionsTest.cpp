@@ -0,0 +1,165 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+#include <libfreehand/libfreehand.h>
+
+#include "RecordingPainter.h"
+
+namespace test
+{
+
+using libfreehand::FreeHandDocument;
+using libfreehand::FreeHandParseOptions;
+
+class FreeHandParseOptionsTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(FreeHandParseOptionsTest);
+  CPPUNIT_TEST(testLazyDecoding);
+  CPPUNIT_TEST(testDecodeThreads);
+  CPPUNIT_TEST(testContentNoImages);
+  CPPUNIT_TEST(testContentPages);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testLazyDecoding();
+  void testDecodeThreads();
+  void testContentNoImages();
+  void testContentPages();
+};
+
+namespace
+{
+
+std::vector<unsigned char> readDocument(const char *name)
+{
+  std::ifstream file((std::string(TDOC) + "/" + name).c_str(), std::ios::binary);
+  CPPUNIT_ASSERT(file.is_open());
+  return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+std::string parse(const std::vector<unsigned char> &document, const FreeHandParseOptions &options)
+{
+  librevenge::RVNGBinaryData data(&document[0], document.size());
+  RecordingPainter painter;
+  CPPUNIT_ASSERT(FreeHandDocument::parse(data.getDataStream(), &painter, options));
+  return painter.getCalls();
+}
+
+}
+
+void FreeHandParseOptionsTest::setUp()
+{
+}
+
+void FreeHandParseOptionsTest::tearDown()
+{
+}
+
+void FreeHandParseOptionsTest::testLazyDecoding()
+{
+  // one document for each family of versions the records are decoded
+  // for. The page size is set by a VMpObj record, which nothing refers to.
+  const char *const names[] = { "page.fh3", "page.fh5", "page.fh9", "page.fh11" };
+  for (unsigned i = 0; i != sizeof(names) / sizeof(names[0]); ++i)
+  {
+    const std::vector<unsigned char> document = readDocument(names[i]);
+    const std::string eager = parse(document, FreeHandParseOptions());
+    CPPUNIT_ASSERT_MESSAGE(names[i], eager.find("\nstartPage") != std::string::npos);
+    CPPUNIT_ASSERT_MESSAGE(names[i], eager.find("svg:width=13.8889") != std::string::npos);
+    CPPUNIT_ASSERT_MESSAGE(names[i], eager.find("\ndrawPath") != std::string::npos);
+
+    FreeHandParseOptions options;
+    options.setLazyDecoding(true);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], eager, parse(document, options));
+
+    // the records are decoded from the inflated data in pieces
+    options.setInflateWindowSize(256);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], eager, parse(document, options));
+  }
+}
+
+void FreeHandParseOptionsTest::testDecodeThreads()
+{
+  // enough records to be decoded in two threads, if there is thread
+  // support. The page size is set by a VMpObj record in the second half.
+  const std::vector<unsigned char> document = readDocument("many.fh11");
+  FreeHandParseOptions options;
+  options.setDecodeThreads(1);
+  const std::string sequential = parse(document, options);
+  CPPUNIT_ASSERT(sequential.find("svg:width=13.8889") != std::string::npos);
+
+  // 0 is one thread for each core
+  const unsigned threads[] = { 0, 2, 3, 4, 16 };
+  for (unsigned i = 0; i != sizeof(threads) / sizeof(threads[0]); ++i)
+  {
+    options.setDecodeThreads(threads[i]);
+    CPPUNIT_ASSERT_EQUAL(sequential, parse(document, options));
+  }
+}
+
+void FreeHandParseOptionsTest::testContentNoImages()
+{
+  const char *const names[] = { "page.fh5", "page.fh11" };
+  for (unsigned i = 0; i != sizeof(names) / sizeof(names[0]); ++i)
+  {
+    const std::vector<unsigned char> document = readDocument(names[i]);
+    std::string expected = parse(document, FreeHandParseOptions());
+
+    // the image is output with its own style
+    const std::string::size_type image = expected.find("\ndrawGraphicObject");
+    CPPUNIT_ASSERT_MESSAGE(names[i], image != std::string::npos);
+    const std::string::size_type style = expected.rfind("\nsetStyle", image);
+    CPPUNIT_ASSERT_MESSAGE(names[i], style != std::string::npos);
+    expected.erase(style, expected.find('\n', image + 1) - style);
+    CPPUNIT_ASSERT_MESSAGE(names[i], expected.find("\ndrawPath") != std::string::npos);
+
+    FreeHandParseOptions options;
+    options.setContent(FreeHandParseOptions::CONTENT_NO_IMAGES);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], expected, parse(document, options));
+  }
+}
+
+void FreeHandParseOptionsTest::testContentPages()
+{
+  const char *const names[] = { "page.fh5", "page.fh11" };
+  for (unsigned i = 0; i != sizeof(names) / sizeof(names[0]); ++i)
+  {
+    const std::vector<unsigned char> document = readDocument(names[i]);
+    const std::string all = parse(document, FreeHandParseOptions());
+
+    // the page, of the same size, with nothing on it
+    const std::string::size_type page = all.find("\nstartPage");
+    CPPUNIT_ASSERT_MESSAGE(names[i], page != std::string::npos);
+    const std::string expected = "\nstartDocument" + all.substr(page, all.find('\n', page + 1) - page) + "\nendPage\nendDocument";
+
+    FreeHandParseOptions options;
+    options.setContent(FreeHandParseOptions::CONTENT_PAGES);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(names[i], expected, parse(document, options));
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FreeHandParseOptionsTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
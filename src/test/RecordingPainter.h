@@ -0,0 +1,276 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libfreehand project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __RECORDINGPAINTER_H__
+#define __RECORDINGPAINTER_H__
+
+#include <string>
+
+#include <librevenge/librevenge.h>
+
+namespace test
+{
+
+inline void appendProperties(std::string &out, const librevenge::RVNGPropertyList &propList)
+{
+  librevenge::RVNGPropertyList::Iter i(propList);
+  for (i.rewind(); i.next();)
+  {
+    out += ' ';
+    out += i.key();
+    out += '=';
+    if (i.child())
+    {
+      out += '[';
+      for (unsigned long j = 0; j < i.child()->count(); ++j)
+      {
+        out += '(';
+        appendProperties(out, (*i.child())[j]);
+        out += ')';
+      }
+      out += ']';
+    }
+    else if (i())
+      out += i()->getStr().cstr();
+  }
+}
+
+// Writes down everything it is given, so outputs can be compared.
+class RecordingPainter : public librevenge::RVNGDrawingInterface
+{
+public:
+  RecordingPainter() : m_calls() {}
+
+  const std::string &getCalls() const
+  {
+    return m_calls;
+  }
+
+  void startDocument(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startDocument", propList);
+  }
+  void endDocument() override
+  {
+    record("endDocument");
+  }
+  void setDocumentMetaData(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("setDocumentMetaData", propList);
+  }
+  void defineEmbeddedFont(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("defineEmbeddedFont", propList);
+  }
+  void startPage(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startPage", propList);
+  }
+  void endPage() override
+  {
+    record("endPage");
+  }
+  void startMasterPage(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startMasterPage", propList);
+  }
+  void endMasterPage() override
+  {
+    record("endMasterPage");
+  }
+  void startLayer(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startLayer", propList);
+  }
+  void endLayer() override
+  {
+    record("endLayer");
+  }
+  void startEmbeddedGraphics(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startEmbeddedGraphics", propList);
+  }
+  void endEmbeddedGraphics() override
+  {
+    record("endEmbeddedGraphics");
+  }
+  void openGroup(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openGroup", propList);
+  }
+  void closeGroup() override
+  {
+    record("closeGroup");
+  }
+  void setStyle(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("setStyle", propList);
+  }
+  void drawRectangle(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawRectangle", propList);
+  }
+  void drawEllipse(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawEllipse", propList);
+  }
+  void drawPolyline(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawPolyline", propList);
+  }
+  void drawPolygon(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawPolygon", propList);
+  }
+  void drawPath(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawPath", propList);
+  }
+  void drawGraphicObject(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawGraphicObject", propList);
+  }
+  void drawConnector(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("drawConnector", propList);
+  }
+  void startTextObject(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startTextObject", propList);
+  }
+  void endTextObject() override
+  {
+    record("endTextObject");
+  }
+  void startTableObject(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("startTableObject", propList);
+  }
+  void openTableRow(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openTableRow", propList);
+  }
+  void closeTableRow() override
+  {
+    record("closeTableRow");
+  }
+  void openTableCell(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openTableCell", propList);
+  }
+  void closeTableCell() override
+  {
+    record("closeTableCell");
+  }
+  void insertCoveredTableCell(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("insertCoveredTableCell", propList);
+  }
+  void endTableObject() override
+  {
+    record("endTableObject");
+  }
+  void openOrderedListLevel(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openOrderedListLevel", propList);
+  }
+  void closeOrderedListLevel() override
+  {
+    record("closeOrderedListLevel");
+  }
+  void openUnorderedListLevel(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openUnorderedListLevel", propList);
+  }
+  void closeUnorderedListLevel() override
+  {
+    record("closeUnorderedListLevel");
+  }
+  void openListElement(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openListElement", propList);
+  }
+  void closeListElement() override
+  {
+    record("closeListElement");
+  }
+  void defineParagraphStyle(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("defineParagraphStyle", propList);
+  }
+  void openParagraph(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openParagraph", propList);
+  }
+  void closeParagraph() override
+  {
+    record("closeParagraph");
+  }
+  void defineCharacterStyle(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("defineCharacterStyle", propList);
+  }
+  void openSpan(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openSpan", propList);
+  }
+  void closeSpan() override
+  {
+    record("closeSpan");
+  }
+  void openLink(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("openLink", propList);
+  }
+  void closeLink() override
+  {
+    record("closeLink");
+  }
+  void insertTab() override
+  {
+    record("insertTab");
+  }
+  void insertSpace() override
+  {
+    record("insertSpace");
+  }
+  void insertText(const librevenge::RVNGString &text) override
+  {
+    record("insertText");
+    m_calls += ' ';
+    m_calls += text.cstr();
+  }
+  void insertLineBreak() override
+  {
+    record("insertLineBreak");
+  }
+  void insertField(const librevenge::RVNGPropertyList &propList) override
+  {
+    record("insertField", propList);
+  }
+
+private:
+  void record(const char *call)
+  {
+    m_calls += '\n';
+    m_calls += call;
+  }
+  void record(const char *call, const librevenge::RVNGPropertyList &propList)
+  {
+    record(call);
+    appendProperties(m_calls, propList);
+  }
+
+  std::string m_calls;
+};
+
+}
+
+#endif // __RECORDINGPAINTER_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */